@@ -0,0 +1,73 @@
+--
+-- benchmark of llsocket.addrinfo
+--
+--  usage: lua bench/addrinfo_bench.lua [N]
+--
+local llsocket = require('llsocket')
+local addrinfo = llsocket.addrinfo
+local socket = llsocket.socket
+local N = tonumber(arg[1]) or 100000
+
+local function measure(name, n, fn)
+    local objs = {}
+    -- preallocate the array part to exclude it from the result
+    for i = 1, n do
+        objs[i] = false
+    end
+
+    collectgarbage('collect')
+    collectgarbage('stop')
+    local kb = collectgarbage('count')
+    local t = os.clock()
+    for i = 1, n do
+        objs[i] = fn(i)
+    end
+    t = os.clock() - t
+    kb = collectgarbage('count') - kb
+    collectgarbage('restart')
+
+    print(string.format('%-24s %8.1f bytes/op %10.1f ns/op', name,
+                        kb * 1024 / n, t * 1e9 / n))
+    return objs
+end
+
+-- bytes per object
+measure('addrinfo.inet', N, function()
+    return addrinfo.inet('127.0.0.1', 8080)
+end)
+measure('addrinfo.inet6', N, function()
+    return addrinfo.inet6('::1', 8080)
+end)
+measure('addrinfo.parse', N, function()
+    return addrinfo.parse('2001:db8::1', 8080)
+end)
+measure('addrinfo.getaddrinfo', N, function()
+    return addrinfo.getaddrinfo('2001:db8::1', '8080', nil, nil, nil,
+                                llsocket.AI_NUMERICHOST)[1]
+end)
+
+-- memoized addr()
+local ai = assert(addrinfo.inet6('2001:db8::1', 8080))
+measure('addrinfo:addr()', N, function()
+    return ai:addr()
+end)
+measure('addrinfo:port()', N, function()
+    return ai:port()
+end)
+
+-- bytes per recvfrom
+local srv = assert(socket.new(llsocket.AF_INET, llsocket.SOCK_DGRAM, nil, true))
+assert(srv:bind(assert(addrinfo.inet('127.0.0.1', 0))))
+local dst = assert(srv:getsockname())
+local cli = assert(socket.new(llsocket.AF_INET, llsocket.SOCK_DGRAM, nil, true))
+local NPKT = math.min(N, 1000)
+for _ = 1, NPKT do
+    assert(cli:sendto('x', dst))
+end
+measure('socket:recvfrom()', NPKT, function()
+    local msg, err, _, from = srv:recvfrom()
+    assert(msg, err)
+    return from
+end)
+srv:close()
+cli:close()
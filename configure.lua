@@ -8,6 +8,7 @@ do
         'sys/types.h',
         'sys/socket.h',
         'sys/sendfile.h',
+        'fcntl.h',
     }) do
         if cfgh:check_header(header) then
             headers[#headers + 1] = header
@@ -17,6 +18,10 @@ do
     for _, func in ipairs({
         'sendfile',
         'accept4',
+        'vmsplice',
+        'splice',
+        'recvmmsg',
+        'sendmmsg',
     }) do
         cfgh:check_func(headers, func)
     end
@@ -0,0 +1,154 @@
+/**
+ *  Copyright (C) 2026 Masatoshi Fukunaga
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ *  lls_socket.h
+ *  lua-llsocket
+ */
+
+#ifndef lls_socket_h
+#define lls_socket_h
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+/**
+ * @brief LLS_ABI_VERSION
+ * the version of the stable C ABI. it is incremented when the signature of
+ * the lls_socket_* functions or the layout of lls_capi_t are changed.
+ */
+#define LLS_ABI_VERSION 2
+
+#define LLS_STRINGIFY(...) #__VA_ARGS__
+#define LLS_TOSTRING(...)  LLS_STRINGIFY(__VA_ARGS__)
+
+/**
+ * @brief LLS_SOCKET_DECL
+ * the opaque handle of the llsocket.socket userdata. the members are private
+ * to the llsocket module and can be changed without breaking the ABI, so use
+ * the lls_socket_fd/family/socktype/protocol functions to access them.
+ */
+#define LLS_SOCKET_DECL typedef struct lls_socket_st lls_socket_t;
+
+/**
+ * @brief LLS_MMSGHDR_DECL
+ * the message header for lls_socket_recvmmsg. it has the same layout as the
+ * struct mmsghdr of linux.
+ */
+#define LLS_MMSGHDR_DECL                                                       \
+    typedef struct {                                                           \
+        struct msghdr msg_hdr;                                                 \
+        unsigned int msg_len;                                                  \
+    } lls_mmsghdr_t;
+
+/**
+ * @brief LLS_ABI_DECL
+ * the plain C functions that operate on the socket without the Lua C API.
+ * the I/O functions return the number of bytes or messages on success, or
+ * -errno on failure.
+ */
+#define LLS_ABI_DECL                                                           \
+    int lls_socket_fd(const lls_socket_t *s);                                  \
+    int lls_socket_family(const lls_socket_t *s);                              \
+    int lls_socket_socktype(const lls_socket_t *s);                            \
+    int lls_socket_protocol(const lls_socket_t *s);                            \
+    ssize_t lls_socket_send(lls_socket_t *s, const void *buf, size_t len,      \
+                            int flags);                                        \
+    ssize_t lls_socket_recv(lls_socket_t *s, void *buf, size_t len,            \
+                            int flags);                                        \
+    ssize_t lls_socket_sendmsg(lls_socket_t *s, const struct msghdr *msg,      \
+                               int flags);                                     \
+    int lls_socket_recvmmsg(lls_socket_t *s, lls_mmsghdr_t *msgs,              \
+                            unsigned int vlen, int flags);                     \
+    typedef int (*lls_socket_attr_t)(const lls_socket_t *);                    \
+    typedef ssize_t (*lls_socket_send_t)(lls_socket_t *, const void *, size_t, \
+                                         int);                                 \
+    typedef ssize_t (*lls_socket_recv_t)(lls_socket_t *, void *, size_t, int); \
+    typedef ssize_t (*lls_socket_sendmsg_t)(lls_socket_t *,                    \
+                                            const struct msghdr *, int);       \
+    typedef int (*lls_socket_recvmmsg_t)(lls_socket_t *, lls_mmsghdr_t *,      \
+                                         unsigned int, int);
+
+/**
+ * @brief LLS_CAPI_DECL
+ * the capsule of the C API that published in the registry by the llsocket
+ * module. the functions are the same as the stable C ABI.
+ */
+#define LLS_CAPI_DECL                                                          \
+    typedef struct {                                                           \
+        /* LLS_ABI_VERSION of the llsocket module */                           \
+        int version;                                                           \
+        lls_socket_attr_t fd;                                                  \
+        lls_socket_attr_t family;                                              \
+        lls_socket_attr_t socktype;                                            \
+        lls_socket_attr_t protocol;                                            \
+        lls_socket_send_t send;                                                \
+        lls_socket_recv_t recv;                                                \
+        lls_socket_sendmsg_t sendmsg;                                          \
+        lls_socket_recvmmsg_t recvmmsg;                                        \
+    } lls_capi_t;
+
+LLS_SOCKET_DECL
+LLS_MMSGHDR_DECL
+LLS_ABI_DECL
+LLS_CAPI_DECL
+
+// C API for the other native extensions
+#if defined(LUA_VERSION_NUM)
+# include <lauxlib.h>
+
+# define LLS_SOCKET_MT "llsocket.socket"
+// registry key of the C API capsule
+# define LLS_CAPI_KEY  "llsocket.capi"
+
+/**
+ * @brief lls_capi_get get the C API capsule from the registry.
+ * @param L Lua state
+ * @return const lls_capi_t* NULL if the llsocket module is not loaded or its
+ * ABI version does not match.
+ */
+static inline const lls_capi_t *lls_capi_get(lua_State *L)
+{
+    const lls_capi_t *api = NULL;
+
+    lua_getfield(L, LUA_REGISTRYINDEX, LLS_CAPI_KEY);
+    api = (const lls_capi_t *)lua_touserdata(L, -1);
+    lua_pop(L, 1);
+    if (api && api->version != LLS_ABI_VERSION) {
+        return NULL;
+    }
+    return api;
+}
+
+/**
+ * @brief lls_checksocket check whether the argument is llsocket.socket.
+ * @param L Lua state
+ * @param idx index of argument
+ * @return lls_socket_t*
+ */
+static inline lls_socket_t *lls_checksocket(lua_State *L, int idx)
+{
+    return (lls_socket_t *)luaL_checkudata(L, idx, LLS_SOCKET_MT);
+}
+
+#endif
+
+#endif
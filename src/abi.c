@@ -0,0 +1,137 @@
+/**
+ *  Copyright (C) 2026 Masatoshi Fukunaga
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ *  abi.c
+ *  lua-llsocket
+ */
+
+#include "llsocket.h"
+
+int lls_socket_fd(const lls_socket_t *s)
+{
+    return s->fd;
+}
+
+int lls_socket_family(const lls_socket_t *s)
+{
+    return s->family;
+}
+
+int lls_socket_socktype(const lls_socket_t *s)
+{
+    return s->socktype;
+}
+
+int lls_socket_protocol(const lls_socket_t *s)
+{
+    return s->protocol;
+}
+
+ssize_t lls_socket_send(lls_socket_t *s, const void *buf, size_t len, int flags)
+{
+    ssize_t rv = send(s->fd, buf, len, flags);
+
+    if (rv == -1) {
+        return -errno;
+    }
+    lls_timer_touch(s, LLS_TOUCH_WRITE);
+    return rv;
+}
+
+ssize_t lls_socket_recv(lls_socket_t *s, void *buf, size_t len, int flags)
+{
+    ssize_t rv = recv(s->fd, buf, len, flags);
+
+    if (rv == -1) {
+        return -errno;
+    } else if (rv > 0) {
+        lls_timer_touch(s, LLS_TOUCH_READ);
+    }
+    return rv;
+}
+
+ssize_t lls_socket_sendmsg(lls_socket_t *s, const struct msghdr *msg,
+                           int flags)
+{
+    ssize_t rv = sendmsg(s->fd, msg, flags);
+
+    if (rv == -1) {
+        return -errno;
+    }
+    lls_timer_touch(s, LLS_TOUCH_WRITE);
+    return rv;
+}
+
+int lls_socket_recvmmsg(lls_socket_t *s, lls_mmsghdr_t *msgs,
+                        unsigned int vlen, int flags)
+{
+#if defined(HAVE_RECVMMSG)
+    // lls_mmsghdr_t has the same layout as struct mmsghdr
+    int rv = recvmmsg(s->fd, (struct mmsghdr *)msgs, vlen, flags, NULL);
+
+    if (rv == -1) {
+        return -errno;
+    } else if (rv > 0) {
+        lls_timer_touch(s, LLS_TOUCH_READ);
+    }
+    return rv;
+
+#else
+    int n = 0;
+
+    // receive the messages one by one
+    for (; (unsigned int)n < vlen; n++) {
+        ssize_t rv = recvmsg(s->fd, &msgs[n].msg_hdr, flags);
+
+        if (rv == -1) {
+            if (!n) {
+                return -errno;
+            }
+            break;
+        }
+        msgs[n].msg_len = (unsigned int)rv;
+        // do not block after the first message
+        flags |= MSG_DONTWAIT;
+    }
+    if (n) {
+        lls_timer_touch(s, LLS_TOUCH_READ);
+    }
+    return n;
+#endif
+}
+
+static const lls_capi_t CAPI = {
+    .version  = LLS_ABI_VERSION,
+    .fd       = lls_socket_fd,
+    .family   = lls_socket_family,
+    .socktype = lls_socket_socktype,
+    .protocol = lls_socket_protocol,
+    .send     = lls_socket_send,
+    .recv     = lls_socket_recv,
+    .sendmsg  = lls_socket_sendmsg,
+    .recvmmsg = lls_socket_recvmmsg,
+};
+
+void lls_capi_init(lua_State *L)
+{
+    lua_pushlightuserdata(L, (void *)&CAPI);
+    lua_setfield(L, LUA_REGISTRYINDEX, LLS_CAPI_KEY);
+}
@@ -32,52 +32,49 @@ static int getnameinfo_lua(lua_State *L)
 {
     lls_addrinfo_t *info = lauxh_checkudata(L, 1, ADDRINFO_MT);
     int flag             = lauxh_optflags(L, 2);
-    char host[NI_MAXHOST];
-    char serv[NI_MAXSERV];
-    int rc = getnameinfo(info->ai.ai_addr, info->ai.ai_addrlen, host,
-                         NI_MAXHOST, serv, NI_MAXSERV, flag);
 
-    // got error
-    if (rc != 0) {
-        lua_pushnil(L);
-        lua_errno_eai_new(L, rc, "getnameinfo");
-        return 2;
-    }
-
-    lua_createtable(L, 0, 2);
-    lauxh_pushstr2tbl(L, "host", host);
-    lauxh_pushstr2tbl(L, "service", serv);
-
-    return 1;
+    return lls_aicache_getnameinfo(L, info->ai.ai_addr, info->ai.ai_addrlen,
+                                   flag);
 }
 
 static int addr_lua(lua_State *L)
 {
-    lls_addrinfo_t *info       = lauxh_checkudata(L, 1, ADDRINFO_MT);
-    char buf[INET6_ADDRSTRLEN] = {0};
+    lls_addrinfo_t *info = lauxh_checkudata(L, 1, ADDRINFO_MT);
+    const char *str      = NULL;
+
+    // return the memoized result
+    if (info->straddr[0]) {
+        lua_pushstring(L, info->straddr);
+        return 1;
+    }
 
     switch (info->ai.ai_family) {
     case AF_INET: {
         struct sockaddr_in *addr = (struct sockaddr_in *)info->ai.ai_addr;
-        lua_pushstring(L, inet_ntop(AF_INET, (const void *)&addr->sin_addr, buf,
-                                    INET6_ADDRSTRLEN));
+        str = inet_ntop(AF_INET, (const void *)&addr->sin_addr, info->straddr,
+                        INET6_ADDRSTRLEN);
     } break;
 
     case AF_INET6: {
         struct sockaddr_in6 *addr = (struct sockaddr_in6 *)info->ai.ai_addr;
-        lua_pushstring(L, inet_ntop(AF_INET6, (const void *)&addr->sin6_addr,
-                                    buf, INET6_ADDRSTRLEN));
+        str = inet_ntop(AF_INET6, (const void *)&addr->sin6_addr,
+                        info->straddr, INET6_ADDRSTRLEN);
     } break;
 
     case AF_UNIX: {
+        // sun_path is already a string
         struct sockaddr_un *addr = (struct sockaddr_un *)info->ai.ai_addr;
-        lua_pushstring(L, addr->sun_path);
+        str                      = addr->sun_path;
     } break;
+    }
 
     // unsupported family
-    default:
+    if (!str) {
+        info->straddr[0] = 0;
         lua_pushnil(L);
+        return 1;
     }
+    lua_pushstring(L, str);
 
     return 1;
 }
@@ -144,20 +141,63 @@ static int family_lua(lua_State *L)
     return 1;
 }
 
-static int tostring_lua(lua_State *L)
+static int hash_lua(lua_State *L)
 {
-    lua_pushfstring(L, ADDRINFO_MT ": %p", lua_touserdata(L, 1));
+    lls_addrinfo_t *info = lauxh_checkudata(L, 1, ADDRINFO_MT);
+    lls_peerkey_t key;
+
+    if (lls_peerkey_init(&key, info->ai.ai_addr, info->ai.ai_addrlen) == 0) {
+        lua_pushinteger(L, lls_hash(&key, sizeof(lls_peerkey_t), 0));
+    } else {
+        lua_pushinteger(L,
+                        lls_hash(info->ai.ai_addr, info->ai.ai_addrlen, 0));
+    }
+
     return 1;
 }
 
-static int gc_lua(lua_State *L)
+static int pack_lua(lua_State *L)
 {
-    lls_addrinfo_t *info = lauxh_checkudata(L, 1, ADDRINFO_MT);
+    lls_addrinfo_t *info              = lauxh_checkudata(L, 1, ADDRINFO_MT);
+    uint8_t buf[LLS_PACKED_INET6_LEN] = {0};
+    size_t len                        = 0;
 
-    info->ai_addr_ref      = lauxh_unref(L, info->ai_addr_ref);
-    info->ai_canonname_ref = lauxh_unref(L, info->ai_canonname_ref);
+    len = lls_addr_pack(buf, info->ai.ai_addr, info->ai.ai_addrlen);
+    if (!len) {
+        lua_pushnil(L);
+        errno = EAFNOSUPPORT;
+        lua_errno_new(L, errno, "pack");
+        return 2;
+    }
+    lua_pushlstring(L, (const char *)buf, len);
 
-    return 0;
+    return 1;
+}
+
+static int eq_lua(lua_State *L)
+{
+    lls_addrinfo_t *a = lauxh_checkudata(L, 1, ADDRINFO_MT);
+    lls_addrinfo_t *b = lauxh_checkudata(L, 2, ADDRINFO_MT);
+    lls_peerkey_t ka;
+    lls_peerkey_t kb;
+
+    if (lls_peerkey_init(&ka, a->ai.ai_addr, a->ai.ai_addrlen) == 0 &&
+        lls_peerkey_init(&kb, b->ai.ai_addr, b->ai.ai_addrlen) == 0) {
+        // compare the normalized inet/inet6 addresses
+        lua_pushboolean(L, memcmp(&ka, &kb, sizeof(lls_peerkey_t)) == 0);
+    } else {
+        lua_pushboolean(L, a->ai.ai_addrlen == b->ai.ai_addrlen &&
+                               memcmp(a->ai.ai_addr, b->ai.ai_addr,
+                                      a->ai.ai_addrlen) == 0);
+    }
+
+    return 1;
+}
+
+static int tostring_lua(lua_State *L)
+{
+    lua_pushfstring(L, ADDRINFO_MT ": %p", lua_touserdata(L, 1));
+    return 1;
 }
 
 static int getaddrinfo_lua(lua_State *L)
@@ -166,38 +206,128 @@ static int getaddrinfo_lua(lua_State *L)
     const char *node      = lauxh_optlstring(L, 1, NULL, &nodelen);
     size_t servicelen     = 0;
     const char *service   = lauxh_optlstring(L, 2, NULL, &servicelen);
-    int family            = (int)lauxh_optinteger(L, 3, AF_UNSPEC);
-    // SOCK_STREAM:tcp | SOCK_DGRAM:udp | SOCK_SEQPACKET
-    int socktype          = (int)lauxh_optinteger(L, 4, 0);
-    // IPPROTO_TCP:tcp | IPPROTO_UDP:udp | 0:automatic
-    int protocol          = (int)lauxh_optinteger(L, 5, 0);
-    // AI_PASSIVE:bind socket if node is null
-    int flags             = lauxh_optflags(L, 6);
-    struct addrinfo *list = NULL;
-    struct addrinfo *ptr  = NULL;
-    int idx               = 1;
-    int rc                = lls_getaddrinfo(&list, (nodelen) ? node : NULL,
-                             (servicelen) ? service : NULL, family, socktype,
-                                            protocol, flags);
-
-    if (rc != 0) {
+    struct addrinfo hints = {
+        .ai_family    = (int)lauxh_optinteger(L, 3, AF_UNSPEC),
+        // SOCK_STREAM:tcp | SOCK_DGRAM:udp | SOCK_SEQPACKET
+        .ai_socktype  = (int)lauxh_optinteger(L, 4, 0),
+        // IPPROTO_TCP:tcp | IPPROTO_UDP:udp | 0:automatic
+        .ai_protocol  = (int)lauxh_optinteger(L, 5, 0),
+        // AI_PASSIVE:bind socket if node is null
+        .ai_flags     = lauxh_optflags(L, 6),
+        // initialize
+        .ai_addrlen   = 0,
+        .ai_addr      = NULL,
+        .ai_canonname = NULL,
+        .ai_next      = NULL};
+
+    return lls_aicache_getaddrinfo(L, (nodelen) ? node : NULL,
+                                   (servicelen) ? service : NULL, &hints);
+}
+
+static inline void unpack_alloc(lua_State *L, struct sockaddr_storage *addr,
+                                socklen_t addrlen, int socktype, int protocol)
+{
+    struct addrinfo ai = {.ai_family    = addr->ss_family,
+                          .ai_socktype  = socktype,
+                          .ai_protocol  = protocol,
+                          .ai_flags     = 0,
+                          .ai_addrlen   = addrlen,
+                          .ai_addr      = (struct sockaddr *)addr,
+                          .ai_canonname = NULL,
+                          .ai_next      = NULL};
+
+    lls_addrinfo_alloc(L, &ai);
+}
+
+static int unpackmany_lua(lua_State *L)
+{
+    size_t len         = 0;
+    const uint8_t *buf = (const uint8_t *)lauxh_checklstring(L, 1, &len);
+    int socktype       = (int)lauxh_optinteger(L, 2, 0);
+    int protocol       = (int)lauxh_optinteger(L, 3, 0);
+    struct sockaddr_storage addr;
+    socklen_t addrlen = 0;
+    int n             = 0;
+
+    // count the addresses to preallocate the list
+    for (size_t pos = 0; pos < len; n++) {
+        size_t rv = (buf[pos] == 4) ? LLS_PACKED_INET_LEN :
+                    (buf[pos] == 6) ? LLS_PACKED_INET6_LEN :
+                                      0;
+
+        if (!rv || rv > len - pos) {
+            lua_pushnil(L);
+            errno = EINVAL;
+            lua_errno_new(L, errno, "unpackmany");
+            return 2;
+        }
+        pos += rv;
+    }
+
+    lua_settop(L, 1);
+    lua_createtable(L, n, 0);
+    for (int i = 1; i <= n; i++) {
+        size_t rv = lls_addr_unpack(buf, len, &addr, &addrlen);
+
+        buf += rv;
+        len -= rv;
+        unpack_alloc(L, &addr, addrlen, socktype, protocol);
+        lua_rawseti(L, -2, i);
+    }
+
+    return 1;
+}
+
+static int unpack_lua(lua_State *L)
+{
+    size_t len         = 0;
+    const uint8_t *buf = (const uint8_t *)lauxh_checklstring(L, 1, &len);
+    int socktype       = (int)lauxh_optinteger(L, 2, 0);
+    int protocol       = (int)lauxh_optinteger(L, 3, 0);
+    struct sockaddr_storage addr;
+    socklen_t addrlen = 0;
+
+    if (lls_addr_unpack(buf, len, &addr, &addrlen) != len) {
+        // buf is not a packed address
         lua_pushnil(L);
-        lua_errno_eai_new(L, rc, "getaddrinfo");
+        errno = EINVAL;
+        lua_errno_new(L, errno, "unpack");
         return 2;
     }
+    unpack_alloc(L, &addr, addrlen, socktype, protocol);
 
-    // create address table
-    lua_newtable(L);
-    ptr = list;
-    while (ptr) {
-        lls_addrinfo_alloc(L, ptr);
-        lua_rawseti(L, -2, idx++);
-        // check next
-        ptr = ptr->ai_next;
-    }
+    return 1;
+}
 
-    // remove address-list
-    freeaddrinfo(list);
+static int parse_lua(lua_State *L)
+{
+    size_t len                    = 0;
+    const char *addr              = lauxh_checklstring(L, 1, &len);
+    uint16_t port                 = lauxh_optuint16(L, 2, 0);
+    struct sockaddr_storage saddr = {0};
+    struct addrinfo ai            = {.ai_family    = AF_UNSPEC,
+                                     // SOCK_STREAM:tcp | SOCK_DGRAM:udp | SOCK_SEQPACKET
+                                     .ai_socktype  = (int)lauxh_optinteger(L, 3, 0),
+                                     // IPPROTO_TCP:tcp | IPPROTO_UDP:udp | 0:automatic
+                                     .ai_protocol  = (int)lauxh_optinteger(L, 4, 0),
+                                     // AI_PASSIVE:bind socket if node is null
+                                     .ai_flags     = (int)lauxh_optflags(L, 5),
+                                     // initialize
+                                     .ai_addrlen   = 0,
+                                     .ai_addr      = (struct sockaddr *)&saddr,
+                                     .ai_canonname = NULL,
+                                     .ai_next      = NULL};
+
+    ai.ai_addrlen = lls_parseaddr(addr, len, AF_UNSPEC, port, &saddr);
+    if (!ai.ai_addrlen) {
+        // addr is not an ipv4 or ipv6 address literal
+        lua_pushnil(L);
+        errno = EINVAL;
+        lua_errno_new(L, errno, "parse");
+        return 2;
+    }
+    ai.ai_family = saddr.ss_family;
+    lls_addrinfo_alloc(L, &ai);
 
     return 1;
 }
@@ -228,12 +358,8 @@ static int inet6_lua(lua_State *L)
 #endif
 
     if (len) {
-        switch (inet_pton(AF_INET6, addr, (void *)&saddr.sin6_addr)) {
-        case -1:
-            lua_pushnil(L);
-            lua_errno_new(L, errno, "inet_pton");
-            return 2;
-        case 0:
+        if (lls_parse6inaddr(addr, len, &saddr.sin6_addr,
+                             &saddr.sin6_scope_id) != 0) {
             // addr cannot be parsed as ipv6 address
             lua_pushnil(L);
             errno = EAFNOSUPPORT;
@@ -272,12 +398,7 @@ static int inet_lua(lua_State *L)
 #endif
 
     if (len) {
-        switch (inet_pton(AF_INET, addr, (void *)&saddr.sin_addr)) {
-        case -1:
-            lua_pushnil(L);
-            lua_errno_new(L, errno, "inet_pton");
-            return 2;
-        case 0:
+        if (lls_parse4inaddr(addr, len, &saddr.sin_addr) != 0) {
             // addr cannot be parsed as ipv4 address
             lua_pushnil(L);
             errno = EAFNOSUPPORT;
@@ -327,11 +448,13 @@ LUALIB_API int luaopen_llsocket_addrinfo(lua_State *L)
     // create metatable
     if (luaL_newmetatable(L, ADDRINFO_MT)) {
         struct luaL_Reg mmethod[] = {
-            {"__gc",       gc_lua      },
             {"__tostring", tostring_lua},
+            {"__eq",       eq_lua      },
             {NULL,         NULL        }
         };
         struct luaL_Reg method[] = {
+            {"hash",        hash_lua       },
+            {"pack",        pack_lua       },
             {"family",      family_lua     },
             {"socktype",    socktype_lua   },
             {"protocol",    protocol_lua   },
@@ -366,6 +489,10 @@ LUALIB_API int luaopen_llsocket_addrinfo(lua_State *L)
     lauxh_pushfn2tbl(L, "inet", inet_lua);
     lauxh_pushfn2tbl(L, "inet6", inet6_lua);
     lauxh_pushfn2tbl(L, "getaddrinfo", getaddrinfo_lua);
+    lauxh_pushfn2tbl(L, "parse", parse_lua);
+    lauxh_pushfn2tbl(L, "unpack", unpack_lua);
+    lauxh_pushfn2tbl(L, "unpackmany", unpackmany_lua);
+    lls_aicache_init(L);
 
     return 1;
 }
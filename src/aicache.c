@@ -0,0 +1,561 @@
+/**
+ *  Copyright (C) 2026 Masatoshi Fukunaga
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ *  aicache.c
+ *  lua-llsocket
+ */
+
+#include "llsocket.h"
+
+// registry key of the cache of this state
+#define STATE_CACHE AICACHE_MT ".state"
+
+// default lifetime of the positive and negative entries in msec
+#define DEFAULT_TTL    30000
+#define DEFAULT_NEGTTL 5000
+
+#define KEY_ADDRINFO 0
+#define KEY_NAMEINFO 1
+
+// the longer keys are not cached
+#define MAX_KEYLEN                                                             \
+    (sizeof(lls_aicache_keyhdr_t) + sizeof(struct sockaddr_storage) +         \
+     NI_MAXHOST + NI_MAXSERV)
+
+typedef struct {
+    int type;
+    int family;
+    int socktype;
+    int protocol;
+    int flags;
+    // length of the node and service including the terminating NUL, or 0 if
+    // NULL
+    int nodelen;
+    int servlen;
+} lls_aicache_keyhdr_t;
+
+typedef struct {
+    int family;
+    int socktype;
+    int protocol;
+    socklen_t addrlen;
+    struct sockaddr_storage addr;
+} lls_aicache_rec_t;
+
+typedef struct lls_aicache_entry_st {
+    // hash chain
+    struct lls_aicache_entry_st *chain;
+    // lru list
+    struct lls_aicache_entry_st *prev;
+    struct lls_aicache_entry_st *next;
+    uint32_t hash;
+    uint64_t expire;
+    // result of getaddrinfo or getnameinfo
+    int rc;
+    size_t klen;
+    const char *key;
+    const char *canonname;
+    const char *host;
+    const char *serv;
+    size_t nrec;
+    lls_aicache_rec_t recs[];
+} lls_aicache_entry_t;
+
+typedef struct {
+    lls_aicache_entry_t **buckets;
+    size_t nbucket;
+    // most and least recently used entries
+    lls_aicache_entry_t *mru;
+    lls_aicache_entry_t *lru;
+    size_t len;
+    size_t size;
+    uint64_t ttl;
+    uint64_t negttl;
+    uint64_t hits;
+    uint64_t misses;
+} lls_aicache_t;
+
+static inline uint64_t getmsec(void)
+{
+    struct timespec ts = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static inline lls_aicache_t *getcache(lua_State *L)
+{
+    lls_aicache_t *c = NULL;
+
+    lua_getfield(L, LUA_REGISTRYINDEX, STATE_CACHE);
+    c = lua_touserdata(L, -1);
+    lua_pop(L, 1);
+
+    return (c && c->size) ? c : NULL;
+}
+
+static inline void unlink_lru(lls_aicache_t *c, lls_aicache_entry_t *e)
+{
+    if (e->prev) {
+        e->prev->next = e->next;
+    } else {
+        c->mru = e->next;
+    }
+    if (e->next) {
+        e->next->prev = e->prev;
+    } else {
+        c->lru = e->prev;
+    }
+}
+
+static inline void link_mru(lls_aicache_t *c, lls_aicache_entry_t *e)
+{
+    e->prev = NULL;
+    e->next = c->mru;
+    if (c->mru) {
+        c->mru->prev = e;
+    } else {
+        c->lru = e;
+    }
+    c->mru = e;
+}
+
+static void remove_entry(lls_aicache_t *c, lls_aicache_entry_t *e)
+{
+    lls_aicache_entry_t **ptr = &c->buckets[e->hash & (c->nbucket - 1)];
+
+    while (*ptr != e) {
+        ptr = &(*ptr)->chain;
+    }
+    *ptr = e->chain;
+    unlink_lru(c, e);
+    c->len--;
+    free(e);
+}
+
+static void clear(lls_aicache_t *c)
+{
+    while (c->mru) {
+        remove_entry(c, c->mru);
+    }
+}
+
+static lls_aicache_entry_t *lookup(lls_aicache_t *c, const char *key,
+                                   size_t klen, uint32_t hash)
+{
+    lls_aicache_entry_t *e = c->buckets[hash & (c->nbucket - 1)];
+
+    for (; e; e = e->chain) {
+        if (e->hash == hash && e->klen == klen &&
+            memcmp(e->key, key, klen) == 0) {
+            if (e->expire <= getmsec()) {
+                // expired
+                remove_entry(c, e);
+                break;
+            }
+            unlink_lru(c, e);
+            link_mru(c, e);
+            c->hits++;
+            return e;
+        }
+    }
+    c->misses++;
+    return NULL;
+}
+
+static lls_aicache_entry_t *insert(lls_aicache_t *c, const char *key,
+                                   size_t klen, uint32_t hash, int rc,
+                                   size_t nrec, size_t slen)
+{
+    lls_aicache_entry_t *e = NULL;
+    size_t i               = hash & (c->nbucket - 1);
+
+    e = malloc(sizeof(lls_aicache_entry_t) + sizeof(lls_aicache_rec_t) * nrec +
+               klen + slen);
+    if (!e) {
+        // just not cached
+        return NULL;
+    } else if (c->len >= c->size) {
+        // evict the least recently used entry
+        remove_entry(c, c->lru);
+    }
+
+    *e = (lls_aicache_entry_t){
+        .chain     = c->buckets[i],
+        .hash      = hash,
+        .expire    = getmsec() + (rc ? c->negttl : c->ttl),
+        .rc        = rc,
+        .klen      = klen,
+        .canonname = NULL,
+        .host      = NULL,
+        .serv      = NULL,
+        .nrec      = nrec,
+    };
+    e->key = (char *)(e->recs + nrec);
+    memcpy((void *)e->key, key, klen);
+    c->buckets[i] = e;
+    link_mru(c, e);
+    c->len++;
+
+    return e;
+}
+
+static inline int is_negative(int rc)
+{
+    // the answers of the name server are cached, but not the temporary
+    // failures
+    switch (rc) {
+    case EAI_NONAME:
+#if defined(EAI_NODATA) && EAI_NODATA != EAI_NONAME
+    case EAI_NODATA:
+#endif
+        return 1;
+    }
+    return 0;
+}
+
+static int pusherror(lua_State *L, int rc, const char *op)
+{
+    lua_pushnil(L);
+    lua_errno_eai_new(L, rc, op);
+    return 2;
+}
+
+static void pushentry(lua_State *L, lls_aicache_entry_t *e)
+{
+    lua_createtable(L, (int)e->nrec, 0);
+    for (size_t i = 0; i < e->nrec; i++) {
+        lls_aicache_rec_t *rec = e->recs + i;
+        struct addrinfo ai;
+
+        ai = (struct addrinfo){
+            .ai_flags     = 0,
+            .ai_family    = rec->family,
+            .ai_socktype  = rec->socktype,
+            .ai_protocol  = rec->protocol,
+            .ai_addrlen   = rec->addrlen,
+            .ai_addr      = (struct sockaddr *)&rec->addr,
+            .ai_canonname = (i == 0) ? (char *)e->canonname : NULL,
+            .ai_next      = NULL,
+        };
+        lls_addrinfo_alloc(L, &ai);
+        lua_rawseti(L, -2, (int)i + 1);
+    }
+}
+
+static void store_addrinfo(lls_aicache_t *c, const char *key, size_t klen,
+                           uint32_t hash, int rc, struct addrinfo *list)
+{
+    size_t nrec            = 0;
+    size_t slen            = 0;
+    lls_aicache_entry_t *e = NULL;
+
+    for (struct addrinfo *ptr = list; ptr; ptr = ptr->ai_next) {
+        if (ptr->ai_addrlen > sizeof(struct sockaddr_storage)) {
+            return;
+        }
+        nrec++;
+    }
+    if (list && list->ai_canonname) {
+        slen = strlen(list->ai_canonname) + 1;
+    }
+
+    if ((e = insert(c, key, klen, hash, rc, nrec, slen))) {
+        lls_aicache_rec_t *rec = e->recs;
+
+        for (struct addrinfo *ptr = list; ptr; ptr = ptr->ai_next, rec++) {
+            rec->family   = ptr->ai_family;
+            rec->socktype = ptr->ai_socktype;
+            rec->protocol = ptr->ai_protocol;
+            rec->addrlen  = ptr->ai_addrlen;
+            memcpy((void *)&rec->addr, ptr->ai_addr, ptr->ai_addrlen);
+        }
+        if (slen) {
+            e->canonname = e->key + klen;
+            memcpy((void *)e->canonname, list->ai_canonname, slen);
+        }
+    }
+}
+
+int lls_aicache_getaddrinfo(lua_State *L, const char *node,
+                            const char *service, const struct addrinfo *hints)
+{
+    lls_aicache_t *c       = getcache(L);
+    struct addrinfo *list  = NULL;
+    char key[MAX_KEYLEN]   = {0};
+    size_t klen            = sizeof(lls_aicache_keyhdr_t);
+    uint32_t hash          = 0;
+    lls_aicache_keyhdr_t h = {
+        .type     = KEY_ADDRINFO,
+        .family   = hints->ai_family,
+        .socktype = hints->ai_socktype,
+        .protocol = hints->ai_protocol,
+        .flags    = hints->ai_flags,
+        .nodelen  = node ? (int)strlen(node) + 1 : 0,
+        .servlen  = service ? (int)strlen(service) + 1 : 0,
+    };
+    int rc = 0;
+
+    if (c && klen + h.nodelen + h.servlen <= MAX_KEYLEN) {
+        lls_aicache_entry_t *e = NULL;
+
+        memcpy(key, &h, sizeof(h));
+        if (node) {
+            memcpy(key + klen, node, h.nodelen);
+            klen += h.nodelen;
+        }
+        if (service) {
+            memcpy(key + klen, service, h.servlen);
+            klen += h.servlen;
+        }
+        hash = lls_hash(key, klen, 0);
+        if ((e = lookup(c, key, klen, hash))) {
+            if (e->rc) {
+                return pusherror(L, e->rc, "getaddrinfo");
+            }
+            pushentry(L, e);
+            return 1;
+        }
+    } else {
+        c = NULL;
+    }
+
+    rc = getaddrinfo(node, service, hints, &list);
+    if (rc != 0) {
+        if (c && c->negttl && is_negative(rc)) {
+            store_addrinfo(c, key, klen, hash, rc, NULL);
+        }
+        return pusherror(L, rc, "getaddrinfo");
+    } else if (c) {
+        store_addrinfo(c, key, klen, hash, rc, list);
+    }
+    lls_addrinfo_pushlist(L, list);
+    freeaddrinfo(list);
+
+    return 1;
+}
+
+int lls_aicache_getnameinfo(lua_State *L, const struct sockaddr *sa,
+                            socklen_t len, int flags)
+{
+    lls_aicache_t *c       = getcache(L);
+    lls_aicache_entry_t *e = NULL;
+    char key[MAX_KEYLEN]   = {0};
+    size_t klen            = sizeof(lls_aicache_keyhdr_t) + len;
+    uint32_t hash          = 0;
+    lls_aicache_keyhdr_t h = {
+        .type     = KEY_NAMEINFO,
+        .family   = sa->sa_family,
+        .socktype = 0,
+        .protocol = 0,
+        .flags    = flags,
+        .nodelen  = 0,
+        .servlen  = 0,
+    };
+    char host[NI_MAXHOST];
+    char serv[NI_MAXSERV];
+    int rc = 0;
+
+    if (c && klen <= MAX_KEYLEN) {
+        memcpy(key, &h, sizeof(h));
+        memcpy(key + sizeof(h), sa, len);
+        hash = lls_hash(key, klen, 0);
+        e    = lookup(c, key, klen, hash);
+    } else {
+        c = NULL;
+    }
+
+    if (!e) {
+        rc = getnameinfo(sa, len, host, NI_MAXHOST, serv, NI_MAXSERV, flags);
+        if (c && (rc == 0 || (c->negttl && is_negative(rc)))) {
+            size_t hlen = (rc == 0) ? strlen(host) + 1 : 0;
+            size_t slen = (rc == 0) ? strlen(serv) + 1 : 0;
+
+            if ((e = insert(c, key, klen, hash, rc, 0, hlen + slen)) && !rc) {
+                e->host = e->key + klen;
+                e->serv = e->host + hlen;
+                memcpy((void *)e->host, host, hlen);
+                memcpy((void *)e->serv, serv, slen);
+            }
+        }
+        if (rc != 0) {
+            return pusherror(L, rc, "getnameinfo");
+        }
+        lua_createtable(L, 0, 2);
+        lauxh_pushstr2tbl(L, "host", host);
+        lauxh_pushstr2tbl(L, "service", serv);
+        return 1;
+    } else if (e->rc) {
+        return pusherror(L, e->rc, "getnameinfo");
+    }
+
+    lua_createtable(L, 0, 2);
+    lauxh_pushstr2tbl(L, "host", e->host);
+    lauxh_pushstr2tbl(L, "service", e->serv);
+
+    return 1;
+}
+
+static lls_aicache_t *checkcache(lua_State *L)
+{
+    lls_aicache_t *c = NULL;
+
+    lua_getfield(L, LUA_REGISTRYINDEX, STATE_CACHE);
+    c = lua_touserdata(L, -1);
+    lua_pop(L, 1);
+
+    return c;
+}
+
+static int invalidate_lua(lua_State *L)
+{
+    size_t len             = 0;
+    const char *host       = lauxh_optlstring(L, 1, NULL, &len);
+    lls_aicache_t *c       = checkcache(L);
+    lls_aicache_entry_t *e = c->mru;
+    size_t n               = c->len;
+
+    if (!host) {
+        clear(c);
+        lua_pushinteger(L, (lua_Integer)n);
+        return 1;
+    }
+
+    n = 0;
+    while (e) {
+        lls_aicache_entry_t *next = e->next;
+        lls_aicache_keyhdr_t h;
+
+        memcpy(&h, e->key, sizeof(h));
+        // the forward lookups of the host, or the reverse lookups that
+        // resolved to the host
+        if ((h.type == KEY_ADDRINFO && h.nodelen == (int)len + 1 &&
+             memcmp(e->key + sizeof(h), host, len) == 0) ||
+            (h.type == KEY_NAMEINFO && e->host && strcmp(e->host, host) == 0)) {
+            remove_entry(c, e);
+            n++;
+        }
+        e = next;
+    }
+    lua_pushinteger(L, (lua_Integer)n);
+
+    return 1;
+}
+
+static int stats_lua(lua_State *L)
+{
+    lls_aicache_t *c = checkcache(L);
+
+    lua_pushinteger(L, (lua_Integer)c->hits);
+    lua_pushinteger(L, (lua_Integer)c->misses);
+    lua_pushinteger(L, (lua_Integer)c->len);
+
+    return 3;
+}
+
+static int cache_lua(lua_State *L)
+{
+    lua_Integer size              = lauxh_checkinteger(L, 1);
+    lua_Number ttl                = lauxh_optnumber(L, 2, DEFAULT_TTL / 1e3);
+    lua_Number negttl             = lauxh_optnumber(L, 3, DEFAULT_NEGTTL / 1e3);
+    lls_aicache_t *c              = checkcache(L);
+    size_t nbucket                = 1;
+    lls_aicache_entry_t **buckets = NULL;
+
+    if (size < 0) {
+        return luaL_argerror(L, 1, "size must be greater than or equal to 0");
+    } else if (ttl <= 0) {
+        return luaL_argerror(L, 2, "ttl must be greater than 0");
+    } else if (negttl < 0) {
+        return luaL_argerror(L, 3, "negttl must be greater than or equal to 0");
+    }
+
+    while (nbucket < (size_t)size) {
+        nbucket <<= 1;
+    }
+    if (size && !(buckets = calloc(nbucket, sizeof(lls_aicache_entry_t *)))) {
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "calloc");
+        return 2;
+    }
+
+    // discard the current entries
+    clear(c);
+    free(c->buckets);
+    c->buckets = buckets;
+    c->nbucket = nbucket;
+    c->size    = (size_t)size;
+    c->ttl     = (uint64_t)(ttl * 1000);
+    c->negttl  = (uint64_t)(negttl * 1000);
+    c->hits    = 0;
+    c->misses  = 0;
+    lua_pushboolean(L, 1);
+
+    return 1;
+}
+
+static int gc_lua(lua_State *L)
+{
+    lls_aicache_t *c = lua_touserdata(L, 1);
+
+    if (c->buckets) {
+        clear(c);
+        free(c->buckets);
+        c->buckets = NULL;
+    }
+    c->size = 0;
+
+    return 0;
+}
+
+void lls_aicache_init(lua_State *L)
+{
+    // create the cache of this state
+    if (luaL_newmetatable(L, AICACHE_MT)) {
+        lauxh_pushfn2tbl(L, "__gc", gc_lua);
+    }
+    lua_pop(L, 1);
+    lua_getfield(L, LUA_REGISTRYINDEX, STATE_CACHE);
+    if (lua_isnil(L, -1)) {
+        lls_aicache_t *c = lua_newuserdata(L, sizeof(lls_aicache_t));
+
+        *c = (lls_aicache_t){
+            .buckets = NULL,
+            .nbucket = 0,
+            .mru     = NULL,
+            .lru     = NULL,
+            .len     = 0,
+            .size    = 0,
+            .ttl     = DEFAULT_TTL,
+            .negttl  = DEFAULT_NEGTTL,
+            .hits    = 0,
+            .misses  = 0,
+        };
+        lauxh_setmetatable(L, AICACHE_MT);
+        lua_setfield(L, LUA_REGISTRYINDEX, STATE_CACHE);
+    }
+    lua_pop(L, 1);
+
+    // add the functions to the module table
+    lauxh_pushfn2tbl(L, "cache", cache_lua);
+    lauxh_pushfn2tbl(L, "cachestats", stats_lua);
+    lauxh_pushfn2tbl(L, "invalidate", invalidate_lua);
+}
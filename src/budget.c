@@ -0,0 +1,133 @@
+/**
+ *  Copyright (C) 2026 Masatoshi Fukunaga
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ *  budget.c
+ *  lua-llsocket
+ */
+
+#include "llsocket.h"
+
+// registry key of the global budget
+#define GLOBAL_BUDGET BUDGET_MT ".global"
+
+typedef struct {
+    lls_budget_t *budget;
+    int budget_ref;
+    int ref;
+    size_t len;
+} lls_rbuf_t;
+
+char *lls_budget_alloc(lua_State *L, lls_budget_t *b, int ref, size_t len)
+{
+    lls_rbuf_t *rb = lua_newuserdata(L, sizeof(lls_rbuf_t) + len);
+
+    // nothing is accounted until lls_budget_charge is called
+    *rb = (lls_rbuf_t){
+        .budget     = b,
+        .budget_ref = ref,
+        .ref        = LUA_NOREF,
+        .len        = 0,
+    };
+    lauxh_setmetatable(L, RBUF_MT);
+
+    return (char *)(rb + 1);
+}
+
+void lls_budget_charge(lua_State *L, int idx, size_t len)
+{
+    lls_rbuf_t *rb = lua_touserdata(L, idx);
+
+    // keep the budget alive until the read buffer is released
+    if (!lauxh_isref(rb->ref) && lauxh_isref(rb->budget_ref)) {
+        lauxh_pushref(L, rb->budget_ref);
+        rb->ref = lauxh_ref(L);
+    }
+    for (lls_budget_t *b = rb->budget; b; b = b->parent) {
+        b->used += len;
+    }
+    rb->len += len;
+}
+
+static int rbuf_gc_lua(lua_State *L)
+{
+    lls_rbuf_t *rb = lua_touserdata(L, 1);
+
+    // the budget may have been collected if nothing is accounted
+    if (rb->len) {
+        for (lls_budget_t *b = rb->budget; b; b = b->parent) {
+            b->used -= rb->len;
+        }
+    }
+    rb->ref = lauxh_unref(L, rb->ref);
+
+    return 0;
+}
+
+lls_budget_t *lls_budget_new(lua_State *L)
+{
+    lls_budget_t *b = lua_newuserdata(L, sizeof(lls_budget_t));
+
+    *b = (lls_budget_t){
+        .used      = 0,
+        .limit     = 0,
+        .nexceeded = 0,
+        .parent    = lls_budget_global(L),
+    };
+    lauxh_setmetatable(L, BUDGET_MT);
+
+    return b;
+}
+
+lls_budget_t *lls_budget_global(lua_State *L)
+{
+    lls_budget_t *b = NULL;
+
+    lua_getfield(L, LUA_REGISTRYINDEX, GLOBAL_BUDGET);
+    b = lua_touserdata(L, -1);
+    lua_pop(L, 1);
+
+    return b;
+}
+
+void lls_budget_init(lua_State *L)
+{
+    // create metatables
+    luaL_newmetatable(L, BUDGET_MT);
+    lua_pop(L, 1);
+    if (luaL_newmetatable(L, RBUF_MT)) {
+        lauxh_pushfn2tbl(L, "__gc", rbuf_gc_lua);
+    }
+    lua_pop(L, 1);
+
+    // create the global budget of this state
+    if (!lls_budget_global(L)) {
+        lls_budget_t *b = lua_newuserdata(L, sizeof(lls_budget_t));
+
+        *b = (lls_budget_t){
+            .used      = 0,
+            .limit     = 0,
+            .nexceeded = 0,
+            .parent    = NULL,
+        };
+        lauxh_setmetatable(L, BUDGET_MT);
+        lua_setfield(L, LUA_REGISTRYINDEX, GLOBAL_BUDGET);
+    }
+}
@@ -0,0 +1,173 @@
+/**
+ *  Copyright (C) 2026 Masatoshi Fukunaga
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ *  buffer.c
+ *  lua-llsocket
+ */
+
+#include "llsocket.h"
+
+static int string_lua(lua_State *L)
+{
+    lls_buffer_t *b = lauxh_checkudata(L, 1, BUFFER_MT);
+
+    lua_pushlstring(L, b->data, b->len);
+
+    return 1;
+}
+
+static int sub_lua(lua_State *L)
+{
+    lls_buffer_t *b = lauxh_checkudata(L, 1, BUFFER_MT);
+    lua_Integer len = (lua_Integer)b->len;
+    lua_Integer i   = lauxh_optinteger(L, 2, 1);
+    lua_Integer j   = lauxh_optinteger(L, 3, -1);
+
+    // same as string.sub
+    if (i < 0) {
+        i = (-i > len) ? 1 : len + i + 1;
+    } else if (i == 0) {
+        i = 1;
+    }
+    if (j < 0) {
+        j = len + j + 1;
+    } else if (j > len) {
+        j = len;
+    }
+    if (i > j) {
+        i = 1;
+        j = 0;
+    }
+
+    // the new slice refers to the same storage
+    lls_getuservalue(L, 1, LLS_BUFFER_UV_STORAGE);
+    lls_buffer_alloc(L, b->data + i - 1, (size_t)(j - i + 1));
+
+    return 1;
+}
+
+static int len_lua(lua_State *L)
+{
+    lls_buffer_t *b = lauxh_checkudata(L, 1, BUFFER_MT);
+
+    lua_pushinteger(L, b->len);
+
+    return 1;
+}
+
+static int tostring_lua(lua_State *L)
+{
+    lua_pushfstring(L, BUFFER_MT ": %p", lua_touserdata(L, 1));
+    return 1;
+}
+
+static int file_lua(lua_State *L)
+{
+    int fd          = lauxh_isinteger(L, 1) ? (int)lua_tointeger(L, 1) :
+                                              fileno(lauxh_checkfile(L, 1));
+    lua_Integer len = lauxh_checkinteger(L, 2);
+    off_t offset    = (off_t)lauxh_optinteger(L, 3, 0);
+    char *data      = NULL;
+    ssize_t rv      = 0;
+
+    // invalid length
+    if (len < 0) {
+        lua_pushnil(L);
+        errno = EINVAL;
+        lua_errno_new(L, errno, "file_lua");
+        return 2;
+    }
+
+    lua_settop(L, 0);
+    data = lua_newuserdata(L, len);
+    for (size_t total = 0; total < (size_t)len; total += rv) {
+        rv = pread(fd, data + total, (size_t)len - total, offset + total);
+        if (rv == -1) {
+            if (errno == EINTR) {
+                rv = 0;
+                continue;
+            }
+            lua_pushnil(L);
+            lua_errno_new(L, errno, "pread");
+            return 2;
+        } else if (rv == 0) {
+            // reached to end-of-file
+            len = total;
+            break;
+        }
+    }
+    lls_buffer_alloc(L, data, (size_t)len);
+
+    return 1;
+}
+
+static int new_lua(lua_State *L)
+{
+    size_t len       = 0;
+    const char *data = lauxh_checklstring(L, 1, &len);
+
+    lua_settop(L, 1);
+    lls_buffer_alloc(L, data, len);
+
+    return 1;
+}
+
+LUALIB_API int luaopen_llsocket_buffer(lua_State *L)
+{
+    // create metatable
+    if (luaL_newmetatable(L, BUFFER_MT)) {
+        struct luaL_Reg mmethod[] = {
+            {"__tostring", tostring_lua},
+            {"__len",      len_lua     },
+            {NULL,         NULL        }
+        };
+        struct luaL_Reg method[] = {
+            {"len",      len_lua   },
+            {"sub",      sub_lua   },
+            {"tostring", string_lua},
+            {NULL,       NULL      }
+        };
+        struct luaL_Reg *ptr = mmethod;
+
+        // metamethods
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        // methods
+        lua_pushstring(L, "__index");
+        lua_newtable(L);
+        ptr = method;
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        lua_rawset(L, -3);
+    }
+    lua_pop(L, 1);
+
+    // create module table
+    lua_newtable(L);
+    lauxh_pushfn2tbl(L, "new", new_lua);
+    lauxh_pushfn2tbl(L, "file", file_lua);
+
+    return 1;
+}
@@ -31,7 +31,7 @@ static int data_lua(lua_State *L)
 {
     lls_cmsghdr_t *cmsg = lauxh_checkudata(L, 1, CMSGHDR_MT);
 
-    lauxh_pushref(L, cmsg->ref);
+    lls_getuservalue(L, 1, LLS_CMSGHDR_UV_DATA);
     if (cmsg->level == SOL_SOCKET && cmsg->type == SCM_RIGHTS) {
         size_t len       = 0;
         const char *data = lauxh_checklstring(L, -1, &len);
@@ -95,17 +95,6 @@ static int tostring_lua(lua_State *L)
     return 1;
 }
 
-static int gc_lua(lua_State *L)
-{
-    lls_cmsghdr_t *cmsg = lauxh_checkudata(L, 1, CMSGHDR_MT);
-
-    if (lauxh_isref(cmsg->ref)) {
-        lauxh_unref(L, cmsg->ref);
-    }
-
-    return 0;
-}
-
 static int new_lua(lua_State *L)
 {
     int level = lauxh_checkinteger(L, 1);
@@ -145,7 +134,6 @@ LUALIB_API int luaopen_llsocket_cmsghdr(lua_State *L)
     // create metatable
     if (luaL_newmetatable(L, CMSGHDR_MT)) {
         struct luaL_Reg mmethod[] = {
-            {"__gc",       gc_lua      },
             {"__tostring", tostring_lua},
             {"__len",      len_lua     },
             {NULL,         NULL        }
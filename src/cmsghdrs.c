@@ -74,9 +74,8 @@ static int push_lua(lua_State *L)
         // copy current and new data
         memcpy(data, cmsg->data, cmsg->len);
 
-        // release old data
-        lauxh_unref(L, cmsg->ref);
-        cmsg->ref   = lauxh_ref(L);
+        // replace old data
+        lls_setuservalue(L, 1, LLS_CMSGHDRS_UV_DATA);
         cmsg->data  = data;
         cmsg->bytes = len;
     }
@@ -98,22 +97,10 @@ static int tostring_lua(lua_State *L)
     return 1;
 }
 
-static int gc_lua(lua_State *L)
-{
-    lls_cmsghdrs_t *cmsg = lauxh_checkudata(L, 1, CMSGHDRS_MT);
-
-    if (lauxh_isref(cmsg->ref)) {
-        lauxh_unref(L, cmsg->ref);
-    }
-
-    return 0;
-}
-
 static int new_lua(lua_State *L)
 {
-    lls_cmsghdrs_t *cmsg = lua_newuserdata(L, sizeof(lls_cmsghdrs_t));
+    lls_cmsghdrs_t *cmsg = lls_newuserdata(L, sizeof(lls_cmsghdrs_t), 1);
 
-    cmsg->ref   = LUA_NOREF;
     cmsg->data  = NULL;
     cmsg->len   = 0;
     cmsg->bytes = 0;
@@ -127,7 +114,6 @@ LUALIB_API int luaopen_llsocket_cmsghdrs(lua_State *L)
     // create metatable
     if (luaL_newmetatable(L, CMSGHDRS_MT)) {
         struct luaL_Reg mmethod[] = {
-            {"__gc",       gc_lua      },
             {"__tostring", tostring_lua},
             {NULL,         NULL        }
         };
@@ -0,0 +1,632 @@
+/**
+ *  Copyright (C) 2026 Masatoshi Fukunaga
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ *  connector.c
+ *  lua-llsocket
+ */
+
+#include "llsocket.h"
+#include <poll.h>
+
+// RFC 8305 recommends 250 milliseconds
+#define DEFAULT_DELAY 250
+#define MIN_DELAY     10
+#define MAX_DELAY     2000
+// maximum number of candidates
+#define MAX_CANDS     64
+
+#define SCOPE_LINKLOCAL 0x2
+#define SCOPE_SITELOCAL 0x5
+#define SCOPE_GLOBAL    0xe
+
+typedef struct {
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    int family;
+    int socktype;
+    int protocol;
+    // descriptor of the connection attempt or -1
+    int fd;
+    // sort keys
+    int idx;
+    int usable;
+    int scope;
+    int label;
+    int prec;
+    int srcscope;
+    int srclabel;
+    int prefixlen;
+} lls_cand_t;
+
+typedef struct {
+    // delay between attempts and the overall timeout in milliseconds
+    uint64_t delay;
+    uint64_t deadline;
+    uint64_t started_at;
+    // number of candidates, attempts started and attempts in flight
+    int ncand;
+    int next;
+    int nflight;
+    int done;
+    int lasterr;
+    lls_cand_t cands[];
+} lls_connector_t;
+
+static inline uint64_t getmsec(void)
+{
+    struct timespec ts = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/**
+ * policy table of RFC 6724 section 2.1
+ */
+static const struct {
+    uint8_t prefix[16];
+    int len;
+    int prec;
+    int label;
+} POLICY[] = {
+    // ::1/128
+    {{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1}, 128, 50, 0 },
+    // ::ffff:0:0/96
+    {{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff},       96,  35, 4 },
+    // 2002::/16
+    {{0x20, 0x02},                                     16,  30, 2 },
+    // 2001::/32
+    {{0x20, 0x01, 0, 0},                               32,  5,  5 },
+    // fc00::/7
+    {{0xfc},                                           7,   3,  13},
+    // ::/96
+    {{0},                                              96,  1,  3 },
+    // fec0::/10
+    {{0xfe, 0xc0},                                     10,  1,  11},
+    // 3ffe::/16
+    {{0x3f, 0xfe},                                     16,  1,  12},
+    // ::/0
+    {{0},                                              0,   40, 1 },
+};
+
+static inline int prefixlen(const uint8_t *a, const uint8_t *b, int max)
+{
+    int n = 0;
+
+    for (int i = 0; i < 16 && n < max; i++) {
+        uint8_t x = a[i] ^ b[i];
+
+        if (x) {
+            while (!(x & 0x80) && n < max) {
+                x <<= 1;
+                n++;
+            }
+            return n;
+        }
+        n += 8;
+    }
+    return (n < max) ? n : max;
+}
+
+/**
+ * convert the address to the IPv6 address. the IPv4 address is mapped to
+ * ::ffff:0:0/96.
+ */
+static inline void to6(const struct sockaddr *sa, uint8_t *addr)
+{
+    if (sa->sa_family == AF_INET6) {
+        memcpy(addr, &((struct sockaddr_in6 *)sa)->sin6_addr, 16);
+    } else {
+        memset(addr, 0, 10);
+        addr[10] = addr[11] = 0xff;
+        memcpy(addr + 12, &((struct sockaddr_in *)sa)->sin_addr, 4);
+    }
+}
+
+static void classify(const struct sockaddr *sa, int *scope, int *label,
+                     int *prec)
+{
+    uint8_t addr[16];
+
+    to6(sa, addr);
+    if (sa->sa_family == AF_INET) {
+        // 127.0.0.0/8 and 169.254.0.0/16 are link-local
+        *scope = (addr[12] == 127 || (addr[12] == 169 && addr[13] == 254)) ?
+                     SCOPE_LINKLOCAL :
+                     SCOPE_GLOBAL;
+    } else if (addr[0] == 0xff) {
+        // multicast
+        *scope = addr[1] & 0xf;
+    } else if ((addr[0] == 0xfe && (addr[1] & 0xc0) == 0x80) ||
+               IN6_IS_ADDR_LOOPBACK((struct in6_addr *)addr)) {
+        *scope = SCOPE_LINKLOCAL;
+    } else if (addr[0] == 0xfe && (addr[1] & 0xc0) == 0xc0) {
+        *scope = SCOPE_SITELOCAL;
+    } else {
+        *scope = SCOPE_GLOBAL;
+    }
+
+    for (size_t i = 0; i < sizeof(POLICY) / sizeof(POLICY[0]); i++) {
+        if (prefixlen(addr, POLICY[i].prefix, POLICY[i].len) ==
+            POLICY[i].len) {
+            *label = POLICY[i].label;
+            *prec  = POLICY[i].prec;
+            return;
+        }
+    }
+}
+
+/**
+ * find the source address that the kernel would choose for the destination
+ * by connecting an udp socket, which does not send any packet.
+ */
+static void lookup_source(lls_cand_t *c)
+{
+    struct sockaddr_storage src = {0};
+    socklen_t srclen            = sizeof(src);
+    int fd                      = -1;
+    uint8_t a[16];
+    uint8_t b[16];
+    int prec = 0;
+
+    c->usable = 0;
+    if ((fd = socket(c->family, SOCK_DGRAM, 0)) == -1) {
+        return;
+    } else if (connect(fd, (struct sockaddr *)&c->addr, c->addrlen) == 0 &&
+               getsockname(fd, (struct sockaddr *)&src, &srclen) == 0) {
+        c->usable = 1;
+        classify((struct sockaddr *)&src, &c->srcscope, &c->srclabel, &prec);
+        if (c->family == AF_INET6) {
+            to6((struct sockaddr *)&c->addr, a);
+            to6((struct sockaddr *)&src, b);
+            // compare up to the 64 bits of the prefix
+            c->prefixlen = prefixlen(a, b, 64);
+        }
+    }
+    close(fd);
+}
+
+/**
+ * compare the destination addresses by the rules of RFC 6724 section 6.
+ * the rules 3, 4 and 7 are not applicable without the source address
+ * attributes.
+ */
+static int compare(const void *x, const void *y)
+{
+    const lls_cand_t *a = x;
+    const lls_cand_t *b = y;
+
+    // rule 1: avoid unusable destinations
+    if (a->usable != b->usable) {
+        return b->usable - a->usable;
+    }
+    if (a->usable) {
+        // rule 2: prefer matching scope
+        int ma = a->scope == a->srcscope;
+        int mb = b->scope == b->srcscope;
+
+        if (ma != mb) {
+            return mb - ma;
+        }
+        // rule 5: prefer matching label
+        ma = a->label == a->srclabel;
+        mb = b->label == b->srclabel;
+        if (ma != mb) {
+            return mb - ma;
+        }
+    }
+    // rule 6: prefer higher precedence
+    if (a->prec != b->prec) {
+        return b->prec - a->prec;
+    }
+    // rule 8: prefer smaller scope
+    if (a->scope != b->scope) {
+        return a->scope - b->scope;
+    }
+    // rule 9: use longest matching prefix
+    if (a->usable && b->usable && a->family == AF_INET6 &&
+        b->family == AF_INET6 && a->prefixlen != b->prefixlen) {
+        return b->prefixlen - a->prefixlen;
+    }
+    // rule 10: otherwise, leave the order unchanged
+    return a->idx - b->idx;
+}
+
+static void sort(lls_cand_t *cands, int n)
+{
+    for (int i = 0; i < n; i++) {
+        lls_cand_t *c = cands + i;
+
+        c->idx = i;
+        if (c->family == AF_INET || c->family == AF_INET6) {
+            classify((struct sockaddr *)&c->addr, &c->scope, &c->label,
+                     &c->prec);
+            lookup_source(c);
+        } else {
+            // keep the order of the other families
+            c->usable = 1;
+            c->scope = c->srcscope = SCOPE_GLOBAL;
+            c->label = c->srclabel = 0;
+            c->prec                = 0;
+        }
+    }
+    qsort(cands, (size_t)n, sizeof(lls_cand_t), compare);
+}
+
+/**
+ * interleave the address families as described in RFC 8305 section 4.
+ */
+static void interleave(lls_cand_t *cands, int n)
+{
+    for (int i = 1; i < n; i++) {
+        if (cands[i].family == cands[i - 1].family) {
+            // find the next address of the other family
+            int j = i + 1;
+
+            while (j < n && cands[j].family == cands[i - 1].family) {
+                j++;
+            }
+            if (j == n) {
+                return;
+            }
+            // move it to the position i
+            lls_cand_t c = cands[j];
+
+            memmove(cands + i + 1, cands + i, sizeof(lls_cand_t) * (j - i));
+            cands[i] = c;
+        }
+    }
+}
+
+/**
+ * read the candidates from the list of llsocket.addrinfo at the index.
+ */
+static int checkcands(lua_State *L, int idx, lls_cand_t *cands)
+{
+    int n = 0;
+
+    for (int i = 1; n < MAX_CANDS; i++) {
+        lls_addrinfo_t *info = NULL;
+
+        lua_rawgeti(L, idx, i);
+        if (lua_isnil(L, -1)) {
+            lua_pop(L, 1);
+            break;
+        } else if (!(info = lauxh_isuserdataof(L, -1, ADDRINFO_MT) ?
+                                lua_touserdata(L, -1) :
+                                NULL)) {
+            return luaL_argerror(L, idx,
+                                 "ais must be the list of llsocket.addrinfo");
+        }
+        lua_pop(L, 1);
+        if (cands) {
+            lls_cand_t *c = cands + n;
+
+            *c = (lls_cand_t){
+                .addrlen  = info->ai.ai_addrlen,
+                .family   = info->ai.ai_family,
+                .socktype = info->ai.ai_socktype ? info->ai.ai_socktype :
+                                                   SOCK_STREAM,
+                .protocol = info->ai.ai_protocol,
+                .fd       = -1,
+            };
+            memcpy(&c->addr, info->ai.ai_addr, info->ai.ai_addrlen);
+        }
+        n++;
+    }
+
+    if (!n) {
+        return luaL_argerror(L, idx,
+                             "ais must be the non-empty list of "
+                             "llsocket.addrinfo");
+    }
+    return n;
+}
+
+static inline void closecand(lls_connector_t *c, lls_cand_t *cand)
+{
+    if (cand->fd != -1) {
+        close(cand->fd);
+        cand->fd = -1;
+        c->nflight--;
+    }
+}
+
+static void closeall(lls_connector_t *c)
+{
+    for (int i = 0; i < c->next; i++) {
+        closecand(c, c->cands + i);
+    }
+    c->done = 1;
+}
+
+/**
+ * start the connection attempt of the next candidate, and return 1 if
+ * connected immediately, 0 if in progress, or -1 on failure.
+ */
+static int start(lls_connector_t *c)
+{
+    lls_cand_t *cand = c->cands + c->next++;
+    int fd           = socket(cand->family, cand->socktype, cand->protocol);
+    int fl           = 0;
+
+    c->started_at = getmsec();
+    if (fd == -1) {
+        c->lasterr = errno;
+        return -1;
+    } else if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1 ||
+               (fl = fcntl(fd, F_GETFL)) == -1 ||
+               fcntl(fd, F_SETFL, fl | O_NONBLOCK) == -1) {
+        c->lasterr = errno;
+        close(fd);
+        return -1;
+    }
+
+    cand->fd = fd;
+    c->nflight++;
+    if (connect(fd, (struct sockaddr *)&cand->addr, cand->addrlen) == 0) {
+        return 1;
+    } else if (errno != EINPROGRESS && errno != EINTR) {
+        c->lasterr = errno;
+        closecand(c, cand);
+        return -1;
+    }
+    return 0;
+}
+
+static int winner(lua_State *L, lls_connector_t *c, lls_cand_t *cand)
+{
+    int fd = cand->fd;
+
+    // close the losers
+    cand->fd = -1;
+    c->nflight--;
+    closeall(c);
+    lls_socket_new(L, fd, cand->family, cand->socktype, cand->protocol);
+    return 1;
+}
+
+static int step_lua(lua_State *L)
+{
+    lls_connector_t *c = lauxh_checkudata(L, 1, CONNECT_MT);
+    struct pollfd fds[MAX_CANDS];
+    int idx[MAX_CANDS];
+    int nfds     = 0;
+    int failed   = 0;
+    uint64_t now = 0;
+    uint64_t at  = 0;
+
+    lua_settop(L, 1);
+    if (c->done) {
+        lua_pushnil(L);
+        errno = EALREADY;
+        lua_errno_new(L, errno, "step");
+        return 2;
+    }
+
+    // check the attempts in flight
+    for (int i = 0; i < c->next; i++) {
+        if (c->cands[i].fd != -1) {
+            fds[nfds] = (struct pollfd){
+                .fd      = c->cands[i].fd,
+                .events  = POLLOUT,
+                .revents = 0,
+            };
+            idx[nfds++] = i;
+        }
+    }
+    if (nfds && poll(fds, (nfds_t)nfds, 0) > 0) {
+        for (int i = 0; i < nfds; i++) {
+            lls_cand_t *cand = c->cands + idx[i];
+            int err          = 0;
+            socklen_t len    = sizeof(err);
+
+            if (!fds[i].revents) {
+                continue;
+            } else if (getsockopt(cand->fd, SOL_SOCKET, SO_ERROR, &err,
+                                  &len) == -1) {
+                err = errno;
+            }
+            if (!err) {
+                return winner(L, c, cand);
+            }
+            c->lasterr = err;
+            closecand(c, cand);
+            failed = 1;
+        }
+    }
+
+    // start the next attempt immediately if the previous attempt failed, or
+    // after the connection attempt delay
+    now = getmsec();
+    while (c->next < c->ncand &&
+           (failed || !c->nflight || now >= c->started_at + c->delay)) {
+        int rv = start(c);
+
+        if (rv == 1) {
+            return winner(L, c, c->cands + c->next - 1);
+        }
+        failed = (rv == -1);
+        now    = getmsec();
+    }
+
+    if (!c->nflight) {
+        // all attempts failed
+        closeall(c);
+        lua_pushnil(L);
+        lua_errno_new(L, c->lasterr ? c->lasterr : ECONNREFUSED, "connect");
+        return 2;
+    } else if (c->deadline && now >= c->deadline) {
+        closeall(c);
+        lua_pushnil(L);
+        lua_errno_new(L, ETIMEDOUT, "connect");
+        return 2;
+    }
+
+    // seconds until the next attempt or the deadline
+    at = (c->next < c->ncand) ? c->started_at + c->delay : 0;
+    if (c->deadline && (!at || c->deadline < at)) {
+        at = c->deadline;
+    }
+    lua_pushnil(L);
+    lua_pushnil(L);
+    lua_pushboolean(L, 1);
+    if (at) {
+        lua_pushnumber(L, (at > now) ? (lua_Number)(at - now) / 1000.0 : 0);
+        return 4;
+    }
+    return 3;
+}
+
+static int fds_lua(lua_State *L)
+{
+    lls_connector_t *c = lauxh_checkudata(L, 1, CONNECT_MT);
+    int n              = 0;
+
+    lua_createtable(L, c->nflight, 0);
+    for (int i = 0; i < c->next; i++) {
+        if (c->cands[i].fd != -1) {
+            lua_pushinteger(L, c->cands[i].fd);
+            lua_rawseti(L, -2, ++n);
+        }
+    }
+
+    return 1;
+}
+
+static int close_lua(lua_State *L)
+{
+    lls_connector_t *c = lauxh_checkudata(L, 1, CONNECT_MT);
+
+    closeall(c);
+
+    return 0;
+}
+
+static int tostring_lua(lua_State *L)
+{
+    lua_pushfstring(L, CONNECT_MT ": %p", lua_touserdata(L, 1));
+    return 1;
+}
+
+static int new_lua(lua_State *L)
+{
+    int ncand          = 0;
+    lua_Number delay   = luaL_optnumber(L, 2, DEFAULT_DELAY / 1000.0);
+    lua_Number timeout = luaL_optnumber(L, 3, 0);
+    lls_connector_t *c = NULL;
+
+    luaL_checktype(L, 1, LUA_TTABLE);
+    ncand = checkcands(L, 1, NULL);
+    if (delay < MIN_DELAY / 1000.0 || delay > MAX_DELAY / 1000.0) {
+        return luaL_argerror(L, 2, "delay must be between 0.01 and 2");
+    } else if (timeout < 0) {
+        return luaL_argerror(L, 3, "timeout must be greater than 0");
+    }
+
+    lua_settop(L, 1);
+    c  = lua_newuserdata(L,
+                         sizeof(lls_connector_t) + sizeof(lls_cand_t) * ncand);
+    *c = (lls_connector_t){
+        .delay      = (uint64_t)(delay * 1000),
+        .deadline   = (timeout > 0) ? getmsec() + (uint64_t)(timeout * 1000) :
+                                      0,
+        .started_at = 0,
+        .ncand      = ncand,
+        .next       = 0,
+        .nflight    = 0,
+        .done       = 0,
+        .lasterr    = 0,
+    };
+    checkcands(L, 1, c->cands);
+    sort(c->cands, ncand);
+    interleave(c->cands, ncand);
+    lauxh_setmetatable(L, CONNECT_MT);
+
+    return 1;
+}
+
+static int sort_lua(lua_State *L)
+{
+    lls_cand_t cands[MAX_CANDS];
+    int n = 0;
+
+    luaL_checktype(L, 1, LUA_TTABLE);
+    lua_settop(L, 1);
+    n = checkcands(L, 1, cands);
+    sort(cands, n);
+
+    // reorder the list in place
+    lua_createtable(L, n, 0);
+    for (int i = 0; i < n; i++) {
+        lua_rawgeti(L, 1, cands[i].idx + 1);
+        lua_rawseti(L, 2, i + 1);
+    }
+    for (int i = 1; i <= n; i++) {
+        lua_rawgeti(L, 2, i);
+        lua_rawseti(L, 1, i);
+    }
+    lua_settop(L, 1);
+
+    return 1;
+}
+
+LUALIB_API int luaopen_llsocket_connector(lua_State *L)
+{
+    // create metatable
+    if (luaL_newmetatable(L, CONNECT_MT)) {
+        struct luaL_Reg mmethod[] = {
+            {"__gc",       close_lua   },
+            {"__tostring", tostring_lua},
+            {NULL,         NULL        }
+        };
+        struct luaL_Reg method[] = {
+            {"fds",   fds_lua  },
+            {"step",  step_lua },
+            {"close", close_lua},
+            {NULL,    NULL     }
+        };
+        struct luaL_Reg *ptr = mmethod;
+
+        // metamethods
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        // methods
+        lua_pushstring(L, "__index");
+        lua_newtable(L);
+        ptr = method;
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        lua_rawset(L, -3);
+    }
+    lua_pop(L, 1);
+
+    // create module table
+    lua_newtable(L);
+    lauxh_pushfn2tbl(L, "new", new_lua);
+    lauxh_pushfn2tbl(L, "sort", sort_lua);
+
+    return 1;
+}
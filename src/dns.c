@@ -0,0 +1,1197 @@
+/**
+ *  Copyright (C) 2026 Masatoshi Fukunaga
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ *  dns.c
+ *  lua-llsocket
+ */
+
+#include "llsocket.h"
+
+#define DEFAULT_RESOLVCONF "/etc/resolv.conf"
+#define DEFAULT_HOSTS      "/etc/hosts"
+// same as the defaults of resolv.conf(5)
+#define DEFAULT_TIMEOUT    5000
+#define DEFAULT_ATTEMPTS   2
+#define MAX_ATTEMPTS       5
+
+#define DNS_PORT     53
+#define DNS_MAXNS    3
+#define DNS_MAXNAME  255
+// header + qname + qtype + qclass
+#define DNS_MAXQUERY (12 + DNS_MAXNAME + 1 + 4)
+#define DNS_MAXUDP   4096
+#define DNS_MAXTCP   (2 + 65535)
+// maximum number of addresses per query type
+#define DNS_MAXADDR  32
+
+#define T_A     1
+#define T_CNAME 5
+#define T_AAAA  28
+#define C_IN    1
+
+#define RCODE_NOERROR  0
+#define RCODE_SERVFAIL 2
+#define RCODE_NXDOMAIN 3
+
+// user values of the resolver
+#define UV_HOSTS 1
+#define NUV      1
+
+// user values of the query
+#define Q_UV_RESULT 1
+#define Q_UV_ERROR  2
+#define Q_UV_SOCKET 3
+#define Q_NUV       3
+
+#define TCP_NONE 0
+#define TCP_CONN 1
+
+#define PROCESS_IGNORE   0
+#define PROCESS_DONE     1
+#define PROCESS_TRUNCATE 2
+#define PROCESS_RETRY    3
+
+typedef struct {
+    int nns;
+    struct sockaddr_storage ns[DNS_MAXNS];
+    socklen_t nslen[DNS_MAXNS];
+    uint64_t timeout;
+    int attempts;
+    uint64_t rnd;
+} lls_dns_t;
+
+typedef struct {
+    uint16_t id;
+    uint16_t type;
+    int pending;
+    int rcode;
+    size_t len;
+    uint8_t pkt[DNS_MAXQUERY];
+} lls_dns_question_t;
+
+typedef struct {
+    // socket of the current try
+    lls_socket_t *s;
+    int tcp;
+    int done;
+    // nameservers
+    int nns;
+    struct sockaddr_storage ns[DNS_MAXNS];
+    socklen_t nslen[DNS_MAXNS];
+    // current try and the number of tries
+    int cur;
+    int ntry;
+    uint64_t timeout;
+    uint64_t deadline;
+    // questions
+    int nq;
+    lls_dns_question_t q[2];
+    // answers
+    int n4;
+    int n6;
+    uint8_t a4[DNS_MAXADDR][4];
+    uint8_t a6[DNS_MAXADDR][16];
+    // tcp buffers
+    size_t wlen;
+    size_t woff;
+    uint8_t wbuf[2 * (2 + DNS_MAXQUERY)];
+    size_t rlen;
+    uint8_t *rbuf;
+    // hints of the result
+    uint16_t port;
+    int family;
+    int socktype;
+    int protocol;
+} lls_dnsquery_t;
+
+static inline uint64_t getmsec(void)
+{
+    struct timespec ts = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static inline uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static inline uint16_t nextid(lls_dns_t *r)
+{
+    // xorshift64*
+    r->rnd ^= r->rnd >> 12;
+    r->rnd ^= r->rnd << 25;
+    r->rnd ^= r->rnd >> 27;
+    return (uint16_t)((r->rnd * 2685821657736338717ULL) >> 48);
+}
+
+static inline int lower(int c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+/**
+ * encode the query message with the recursion desired flag, or return 0 if
+ * the name is not a valid domain name.
+ */
+static size_t encode(uint8_t *buf, uint16_t id, const char *name, size_t len,
+                     uint16_t qtype)
+{
+    uint8_t *p = buf + 12;
+
+    if (len && name[len - 1] == '.') {
+        // absolute name
+        len--;
+    }
+    if (!len || len > DNS_MAXNAME - 2) {
+        return 0;
+    }
+
+    // header: id, flags(RD), qdcount=1, ancount, nscount, arcount
+    memset(buf, 0, 12);
+    put16(buf, id);
+    buf[2] = 0x01;
+    put16(buf + 4, 1);
+
+    // qname
+    for (size_t i = 0; i <= len;) {
+        size_t n = 0;
+
+        while (i + n < len && name[i + n] != '.') {
+            n++;
+        }
+        if (!n || n > 63) {
+            return 0;
+        }
+        *p++ = (uint8_t)n;
+        memcpy(p, name + i, n);
+        p += n;
+        i += n + 1;
+    }
+    *p++ = 0;
+    put16(p, qtype);
+    put16(p + 2, C_IN);
+    p += 4;
+
+    return (size_t)(p - buf);
+}
+
+/**
+ * read the possibly compressed name at the offset into the buf as the dotted
+ * string, and return the offset of the next field, or 0 on error. the buf
+ * can be NULL to skip the name.
+ */
+static size_t readname(const uint8_t *msg, size_t len, size_t off, char *buf)
+{
+    size_t next = 0;
+    size_t nbuf = 0;
+    int nhop    = 0;
+
+    while (off < len) {
+        uint8_t n = msg[off];
+
+        if (n == 0) {
+            if (buf) {
+                buf[nbuf] = 0;
+            }
+            return next ? next : off + 1;
+        } else if ((n & 0xc0) == 0xc0) {
+            // compression pointer
+            if (off + 1 >= len || ++nhop > 64) {
+                return 0;
+            } else if (!next) {
+                next = off + 2;
+            }
+            off = ((size_t)(n & 0x3f) << 8) | msg[off + 1];
+            continue;
+        } else if (n & 0xc0 || off + 1 + n > len ||
+                   nbuf + n + 1 > DNS_MAXNAME) {
+            return 0;
+        }
+        if (nbuf) {
+            if (buf) {
+                buf[nbuf] = '.';
+            }
+            nbuf++;
+        }
+        if (buf) {
+            memcpy(buf + nbuf, msg + off + 1, n);
+        }
+        nbuf += n;
+        off += 1 + n;
+    }
+
+    return 0;
+}
+
+/**
+ * process the response message, and return the PROCESS_* result.
+ */
+static int process(lls_dnsquery_t *q, const uint8_t *msg, size_t len)
+{
+    lls_dns_question_t *qs = NULL;
+    size_t off             = 0;
+    int rcode              = 0;
+    uint16_t ancount       = 0;
+
+    if (len < 12 || !(msg[2] & 0x80)) {
+        return PROCESS_IGNORE;
+    }
+    for (int i = 0; i < q->nq; i++) {
+        if (q->q[i].pending && q->q[i].id == get16(msg)) {
+            qs = q->q + i;
+            break;
+        }
+    }
+    if (!qs || get16(msg + 4) != 1 || len < qs->len) {
+        return PROCESS_IGNORE;
+    }
+    // the question must be the same as the query
+    for (size_t i = 12; i < qs->len; i++) {
+        if (lower(msg[i]) != lower(qs->pkt[i])) {
+            return PROCESS_IGNORE;
+        }
+    }
+
+    if (msg[2] & 0x02) {
+        // truncated
+        return (q->tcp) ? PROCESS_RETRY : PROCESS_TRUNCATE;
+    }
+    rcode = msg[3] & 0x0f;
+    if (rcode != RCODE_NOERROR && rcode != RCODE_NXDOMAIN) {
+        // SERVFAIL, NOTIMP, REFUSED: ask the next nameserver
+        return PROCESS_RETRY;
+    }
+    qs->pending = 0;
+    qs->rcode   = rcode;
+
+    ancount = get16(msg + 6);
+    off     = qs->len;
+    for (uint16_t i = 0; i < ancount; i++) {
+        uint16_t type   = 0;
+        uint16_t rdlen  = 0;
+
+        if (!(off = readname(msg, len, off, NULL)) || off + 10 > len) {
+            break;
+        }
+        type  = get16(msg + off);
+        rdlen = get16(msg + off + 8);
+        off += 10;
+        if (off + rdlen > len) {
+            break;
+        } else if (get16(msg + off - 8) != C_IN || type != qs->type) {
+            // CNAME or other records
+        } else if (type == T_A && rdlen == 4 && q->n4 < DNS_MAXADDR) {
+            memcpy(q->a4[q->n4++], msg + off, 4);
+        } else if (type == T_AAAA && rdlen == 16 && q->n6 < DNS_MAXADDR) {
+            memcpy(q->a6[q->n6++], msg + off, 16);
+        }
+        off += rdlen;
+    }
+
+    return PROCESS_DONE;
+}
+
+/**
+ * open the socket of the current try and keep it in the user value of the
+ * query at the stack index.
+ */
+static int opensock(lua_State *L, lls_dnsquery_t *q, int idx, int family,
+                    int socktype)
+{
+    int fd = socket(family, socktype, 0);
+    int fl = 0;
+
+    if (fd == -1) {
+        return -1;
+    } else if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1 ||
+               (fl = fcntl(fd, F_GETFL)) == -1 ||
+               fcntl(fd, F_SETFL, fl | O_NONBLOCK) == -1) {
+        close(fd);
+        return -1;
+    }
+    q->s = lls_socket_new(L, fd, family, socktype, 0);
+    lls_setuservalue(L, idx, Q_UV_SOCKET);
+    return 0;
+}
+
+/**
+ * close the socket of the current try by its close method.
+ */
+static void closesock(lua_State *L, lls_dnsquery_t *q, int idx)
+{
+    if (q->s) {
+        q->s = NULL;
+        lls_getuservalue(L, idx, Q_UV_SOCKET);
+        lua_pushnil(L);
+        lls_setuservalue(L, idx, Q_UV_SOCKET);
+        lua_getfield(L, -1, "close");
+        lua_insert(L, -2);
+        lua_call(L, 1, 0);
+    }
+}
+
+/**
+ * send the pending questions to the nameserver of the current try.
+ */
+static int start(lua_State *L, lls_dnsquery_t *q, int idx)
+{
+    int i                        = q->cur % q->nns;
+    struct sockaddr_storage *ns  = q->ns + i;
+
+    closesock(L, q, idx);
+    q->deadline = getmsec() + q->timeout;
+    if (opensock(L, q, idx, ns->ss_family,
+                 q->tcp ? SOCK_STREAM : SOCK_DGRAM) != 0) {
+        return -1;
+    } else if (connect(q->s->fd, (struct sockaddr *)ns, q->nslen[i]) == -1 &&
+               errno != EINPROGRESS) {
+        return -1;
+    }
+
+    if (q->tcp) {
+        // send the length-prefixed messages after connected
+        q->wlen = q->woff = q->rlen = 0;
+        for (int j = 0; j < q->nq; j++) {
+            if (q->q[j].pending) {
+                put16(q->wbuf + q->wlen, (uint16_t)q->q[j].len);
+                memcpy(q->wbuf + q->wlen + 2, q->q[j].pkt, q->q[j].len);
+                q->wlen += 2 + q->q[j].len;
+            }
+        }
+        return 0;
+    }
+
+    for (int j = 0; j < q->nq; j++) {
+        if (q->q[j].pending &&
+            send(q->s->fd, q->q[j].pkt, q->q[j].len, 0) == -1 &&
+            errno != EAGAIN && errno != EWOULDBLOCK) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * move to the next try, or return -1 if there are no more tries.
+ */
+static int nexttry(lua_State *L, lls_dnsquery_t *q, int idx)
+{
+    while (++q->cur < q->ntry) {
+        if (start(L, q, idx) == 0) {
+            return 0;
+        }
+    }
+    closesock(L, q, idx);
+    return -1;
+}
+
+/**
+ * read the responses, and return PROCESS_* result, or -1 on error.
+ */
+static int udp_io(lls_dnsquery_t *q)
+{
+    uint8_t buf[DNS_MAXUDP];
+
+    for (;;) {
+        ssize_t n = recv(q->s->fd, buf, sizeof(buf), 0);
+        int rv    = 0;
+
+        if (n == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                return PROCESS_IGNORE;
+            }
+            // ECONNREFUSED: the nameserver is not running
+            return -1;
+        } else if ((rv = process(q, buf, (size_t)n)) != PROCESS_IGNORE &&
+                   rv != PROCESS_DONE) {
+            return rv;
+        }
+    }
+}
+
+static int tcp_io(lls_dnsquery_t *q)
+{
+    // send the queries
+    while (q->woff < q->wlen) {
+        ssize_t n = send(q->s->fd, q->wbuf + q->woff, q->wlen - q->woff, 0);
+
+        if (n == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ||
+                errno == ENOTCONN) {
+                // not connected yet
+                return PROCESS_IGNORE;
+            }
+            return -1;
+        }
+        q->woff += (size_t)n;
+    }
+
+    // read the length-prefixed responses
+    for (;;) {
+        ssize_t n =
+            recv(q->s->fd, q->rbuf + q->rlen, DNS_MAXTCP - q->rlen, 0);
+
+        if (n == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                return PROCESS_IGNORE;
+            }
+            return -1;
+        } else if (n == 0) {
+            // closed by the nameserver
+            return -1;
+        }
+        q->rlen += (size_t)n;
+        while (q->rlen >= 2 && q->rlen >= 2 + (size_t)get16(q->rbuf)) {
+            size_t mlen = get16(q->rbuf);
+            int rv      = process(q, q->rbuf + 2, mlen);
+
+            if (rv == PROCESS_RETRY) {
+                return rv;
+            }
+            q->rlen -= 2 + mlen;
+            memmove(q->rbuf, q->rbuf + 2 + mlen, q->rlen);
+        }
+    }
+}
+
+static inline void pushaddr(lua_State *L, lls_dnsquery_t *q, int family,
+                            const uint8_t *addr)
+{
+    struct sockaddr_storage ss = {0};
+    struct addrinfo ai         = {.ai_flags     = 0,
+                                  .ai_family    = family,
+                                  .ai_socktype  = q->socktype,
+                                  .ai_protocol  = q->protocol,
+                                  .ai_addrlen   = 0,
+                                  .ai_addr      = (struct sockaddr *)&ss,
+                                  .ai_canonname = NULL,
+                                  .ai_next      = NULL};
+
+    if (family == AF_INET) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)&ss;
+
+#ifdef HAVE_SOCKADDR_SA_LEN
+        sin->sin_len = sizeof(struct sockaddr_in);
+#endif
+        sin->sin_family = AF_INET;
+        sin->sin_port   = htons(q->port);
+        memcpy(&sin->sin_addr, addr, 4);
+        ai.ai_addrlen = sizeof(struct sockaddr_in);
+    } else {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&ss;
+
+#ifdef HAVE_SOCKADDR_SA_LEN
+        sin6->sin6_len = sizeof(struct sockaddr_in6);
+#endif
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port   = htons(q->port);
+        memcpy(&sin6->sin6_addr, addr, 16);
+        ai.ai_addrlen = sizeof(struct sockaddr_in6);
+    }
+    lls_addrinfo_alloc(L, &ai);
+}
+
+/**
+ * save the result to the user values of the query at the stack index.
+ */
+static void finish(lua_State *L, lls_dnsquery_t *q, int idx, int rc)
+{
+    closesock(L, q, idx);
+    free(q->rbuf);
+    q->rbuf = NULL;
+    q->done = 1;
+
+    if (!rc && q->n4 + q->n6 == 0) {
+        rc = EAI_NONAME;
+#if defined(EAI_NODATA)
+        // the name exists but has no address of the family
+        for (int i = 0; i < q->nq; i++) {
+            if (q->q[i].rcode == RCODE_NOERROR) {
+                rc = EAI_NODATA;
+            }
+        }
+#endif
+    }
+
+    if (rc) {
+        lua_pushnil(L);
+        lls_setuservalue(L, idx, Q_UV_RESULT);
+        lua_errno_eai_new(L, rc, "dns");
+        lls_setuservalue(L, idx, Q_UV_ERROR);
+        return;
+    }
+
+    lua_createtable(L, q->n4 + q->n6, 0);
+    for (int i = 0; i < q->n6; i++) {
+        pushaddr(L, q, AF_INET6, q->a6[i]);
+        lua_rawseti(L, -2, i + 1);
+    }
+    for (int i = 0; i < q->n4; i++) {
+        pushaddr(L, q, AF_INET, q->a4[i]);
+        lua_rawseti(L, -2, q->n6 + i + 1);
+    }
+    lls_setuservalue(L, idx, Q_UV_RESULT);
+}
+
+static int pushresult(lua_State *L, int idx)
+{
+    lls_getuservalue(L, idx, Q_UV_RESULT);
+    lls_getuservalue(L, idx, Q_UV_ERROR);
+    return 2;
+}
+
+static int q_step_lua(lua_State *L)
+{
+    lls_dnsquery_t *q = lauxh_checkudata(L, 1, DNSQUERY_MT);
+    int rv            = 0;
+    uint64_t now      = 0;
+
+    lua_settop(L, 1);
+    if (q->done) {
+        return pushresult(L, 1);
+    }
+
+    rv = (q->tcp) ? tcp_io(q) : udp_io(q);
+    if (rv == PROCESS_TRUNCATE) {
+        // retry the current try over tcp
+        if (!q->rbuf && !(q->rbuf = malloc(DNS_MAXTCP))) {
+            lua_pushnil(L);
+            lua_errno_new(L, errno, "malloc");
+            return 2;
+        }
+        q->tcp = TCP_CONN;
+        if (start(L, q, 1) != 0 && nexttry(L, q, 1) != 0) {
+            finish(L, q, 1, EAI_AGAIN);
+            return pushresult(L, 1);
+        }
+    }
+
+    // all questions are answered
+    rv = (rv == -1 || rv == PROCESS_RETRY) ? -1 : 0;
+    for (int i = 0; i < q->nq && rv == 0; i++) {
+        rv = q->q[i].pending;
+    }
+    if (rv == 0) {
+        finish(L, q, 1, 0);
+        return pushresult(L, 1);
+    }
+
+    now = getmsec();
+    if ((rv == -1 || now >= q->deadline) && nexttry(L, q, 1) != 0) {
+        // no response from any nameservers
+        finish(L, q, 1, EAI_AGAIN);
+        return pushresult(L, 1);
+    }
+
+    now = getmsec();
+    lua_pushnil(L);
+    lua_pushnil(L);
+    lua_pushboolean(L, 1);
+    lua_pushnumber(L, (q->deadline > now) ?
+                          (lua_Number)(q->deadline - now) / 1000.0 :
+                          0);
+    return 4;
+}
+
+static int q_fd_lua(lua_State *L)
+{
+    lls_dnsquery_t *q = lauxh_checkudata(L, 1, DNSQUERY_MT);
+
+    if (!q->s || q->s->fd == -1) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_pushinteger(L, q->s->fd);
+    lua_pushboolean(L, q->tcp && q->woff < q->wlen);
+    return 2;
+}
+
+static int q_socket_lua(lua_State *L)
+{
+    lls_dnsquery_t *q = lauxh_checkudata(L, 1, DNSQUERY_MT);
+
+    if (!q->s) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lls_getuservalue(L, 1, Q_UV_SOCKET);
+    return 1;
+}
+
+static int q_close_lua(lua_State *L)
+{
+    lls_dnsquery_t *q = lauxh_checkudata(L, 1, DNSQUERY_MT);
+
+    lua_settop(L, 1);
+    closesock(L, q, 1);
+    free(q->rbuf);
+    q->rbuf = NULL;
+    if (!q->done) {
+        q->done = 1;
+        lua_pushnil(L);
+        lls_setuservalue(L, 1, Q_UV_RESULT);
+        errno = ECANCELED;
+        lua_errno_new(L, errno, "close");
+        lls_setuservalue(L, 1, Q_UV_ERROR);
+    }
+
+    return 0;
+}
+
+static int q_gc_lua(lua_State *L)
+{
+    lls_dnsquery_t *q = lua_touserdata(L, 1);
+
+    // the socket is closed by its own finalizer
+    free(q->rbuf);
+    q->rbuf = NULL;
+    return 0;
+}
+
+static int q_tostring_lua(lua_State *L)
+{
+    lua_pushfstring(L, DNSQUERY_MT ": %p", lua_touserdata(L, 1));
+    return 1;
+}
+
+static int query_lua(lua_State *L)
+{
+    lls_dns_t *r                 = lauxh_checkudata(L, 1, DNS_MT);
+    size_t len                   = 0;
+    const char *name             = lauxh_checklstring(L, 2, &len);
+    uint16_t port                = lauxh_optuint16(L, 3, 0);
+    int family                   = (int)lauxh_optinteger(L, 4, AF_UNSPEC);
+    int socktype                 = (int)lauxh_optinteger(L, 5, 0);
+    int protocol                 = (int)lauxh_optinteger(L, 6, 0);
+    struct sockaddr_storage addr = {0};
+    char key[DNS_MAXNAME + 1]    = {0};
+    lls_dnsquery_t *q            = NULL;
+
+    if (family != AF_UNSPEC && family != AF_INET && family != AF_INET6) {
+        return luaL_argerror(L, 4, "family must be AF_INET or AF_INET6");
+    }
+
+    lua_settop(L, 2);
+    q  = lls_newuserdata(L, sizeof(lls_dnsquery_t), Q_NUV);
+    *q = (lls_dnsquery_t){
+        .s        = NULL,
+        .tcp      = TCP_NONE,
+        .done     = 0,
+        .nns      = r->nns,
+        .cur      = 0,
+        .ntry     = r->nns * r->attempts,
+        .timeout  = r->timeout,
+        .nq       = 0,
+        .n4       = 0,
+        .n6       = 0,
+        .rbuf     = NULL,
+        .port     = port,
+        .family   = family,
+        .socktype = socktype,
+        .protocol = protocol,
+    };
+    memcpy(q->ns, r->ns, sizeof(r->ns));
+    memcpy(q->nslen, r->nslen, sizeof(r->nslen));
+    lauxh_setmetatable(L, DNSQUERY_MT);
+
+    // address literal
+    if (lls_parseaddr(name, len, AF_UNSPEC, port, &addr)) {
+        if (addr.ss_family == AF_INET && family != AF_INET6) {
+            memcpy(q->a4[q->n4++], &((struct sockaddr_in *)&addr)->sin_addr,
+                   4);
+        } else if (addr.ss_family == AF_INET6 && family != AF_INET) {
+            memcpy(q->a6[q->n6++], &((struct sockaddr_in6 *)&addr)->sin6_addr,
+                   16);
+        }
+        finish(L, q, 3, (q->n4 + q->n6) ? 0 : EAI_NONAME);
+        return 1;
+    }
+
+    // hosts(5)
+    if (len && len <= DNS_MAXNAME) {
+        for (size_t i = 0; i < len; i++) {
+            key[i] = (char)lower(name[i]);
+        }
+        if (key[len - 1] == '.') {
+            key[len - 1] = 0;
+        }
+        lls_getuservalue(L, 1, UV_HOSTS);
+        lua_getfield(L, -1, key);
+        if (lua_isstring(L, -1)) {
+            size_t plen        = 0;
+            const uint8_t *pkd = (const uint8_t *)lua_tolstring(L, -1, &plen);
+            socklen_t addrlen  = 0;
+            size_t n           = 0;
+
+            for (; (n = lls_addr_unpack(pkd, plen, &addr, &addrlen));
+                 pkd += n, plen -= n) {
+                if (addr.ss_family == AF_INET && family != AF_INET6 &&
+                    q->n4 < DNS_MAXADDR) {
+                    memcpy(q->a4[q->n4++],
+                           &((struct sockaddr_in *)&addr)->sin_addr, 4);
+                } else if (addr.ss_family == AF_INET6 && family != AF_INET &&
+                           q->n6 < DNS_MAXADDR) {
+                    memcpy(q->a6[q->n6++],
+                           &((struct sockaddr_in6 *)&addr)->sin6_addr, 16);
+                }
+            }
+            if (q->n4 + q->n6) {
+                lua_settop(L, 3);
+                finish(L, q, 3, 0);
+                return 1;
+            }
+        }
+        lua_settop(L, 3);
+    }
+
+    // questions
+    if (family != AF_INET) {
+        q->q[q->nq++].type = T_AAAA;
+    }
+    if (family != AF_INET6) {
+        q->q[q->nq++].type = T_A;
+    }
+    for (int i = 0; i < q->nq; i++) {
+        lls_dns_question_t *qs = q->q + i;
+
+        qs->id      = nextid(r);
+        qs->pending = 1;
+        qs->rcode   = RCODE_NOERROR;
+        if (!(qs->len = encode(qs->pkt, qs->id, name, len, qs->type))) {
+            // invalid domain name
+            finish(L, q, 3, EAI_NONAME);
+            return 1;
+        }
+    }
+
+    if (!q->ntry || (start(L, q, 3) != 0 && nexttry(L, q, 3) != 0)) {
+        finish(L, q, 3, EAI_AGAIN);
+    }
+
+    return 1;
+}
+
+static int tostring_lua(lua_State *L)
+{
+    lua_pushfstring(L, DNS_MT ": %p", lua_touserdata(L, 1));
+    return 1;
+}
+
+static void loadresolvconf(lls_dns_t *r, const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[512];
+
+    if (!fp) {
+        return;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        char *save = NULL;
+        char *tok  = strtok_r(line, " \t\r\n", &save);
+
+        if (!tok) {
+            continue;
+        } else if (strcmp(tok, "nameserver") == 0) {
+            tok = strtok_r(NULL, " \t\r\n", &save);
+            if (tok && r->nns < DNS_MAXNS) {
+                socklen_t len = lls_parseaddr(tok, strlen(tok), AF_UNSPEC,
+                                              DNS_PORT, r->ns + r->nns);
+                if (len) {
+                    r->nslen[r->nns++] = len;
+                }
+            }
+        } else if (strcmp(tok, "options") == 0) {
+            while ((tok = strtok_r(NULL, " \t\r\n", &save))) {
+                int v = 0;
+
+                if (strncmp(tok, "timeout:", 8) == 0 &&
+                    (v = atoi(tok + 8)) > 0) {
+                    r->timeout = (uint64_t)((v < 30) ? v : 30) * 1000;
+                } else if (strncmp(tok, "attempts:", 9) == 0 &&
+                           (v = atoi(tok + 9)) > 0) {
+                    r->attempts = (v < MAX_ATTEMPTS) ? v : MAX_ATTEMPTS;
+                }
+            }
+        }
+    }
+    fclose(fp);
+}
+
+/**
+ * load the hosts file into the table on the top of the stack. the names are
+ * mapped to the concatenation of the packed addresses.
+ */
+static void loadhosts(lua_State *L, const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[1024];
+
+    if (!fp) {
+        return;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        char *save                   = NULL;
+        char *tok                    = NULL;
+        struct sockaddr_storage addr = {0};
+        uint8_t pkd[LLS_PACKED_INET6_LEN];
+        size_t plen = 0;
+
+        // strip the comment
+        if ((tok = strchr(line, '#'))) {
+            *tok = 0;
+        }
+        if (!(tok = strtok_r(line, " \t\r\n", &save)) ||
+            !lls_parseaddr(tok, strlen(tok), AF_UNSPEC, 0, &addr)) {
+            continue;
+        }
+        plen = lls_addr_pack(pkd, (struct sockaddr *)&addr, sizeof(addr));
+        while ((tok = strtok_r(NULL, " \t\r\n", &save))) {
+            for (char *c = tok; *c; c++) {
+                *c = (char)lower(*c);
+            }
+            lua_getfield(L, -1, tok);
+            lua_pushlstring(L, (const char *)pkd, plen);
+            if (lua_isstring(L, -2)) {
+                lua_concat(L, 2);
+            } else {
+                lua_replace(L, -2);
+            }
+            lua_setfield(L, -2, tok);
+        }
+    }
+    fclose(fp);
+}
+
+static inline void seed(lls_dns_t *r)
+{
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+
+    r->rnd = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32) ^
+             (uint64_t)(uintptr_t)r;
+    if (fd != -1) {
+        uint64_t v = 0;
+
+        if (read(fd, &v, sizeof(v)) == sizeof(v)) {
+            r->rnd ^= v;
+        }
+        close(fd);
+    }
+    if (!r->rnd) {
+        r->rnd = 0x9e3779b97f4a7c15ULL;
+    }
+}
+
+static int new_lua(lua_State *L)
+{
+    const char *resolvconf = DEFAULT_RESOLVCONF;
+    const char *hosts      = DEFAULT_HOSTS;
+    lls_dns_t *r           = NULL;
+
+    if (!lua_isnoneornil(L, 1)) {
+        luaL_checktype(L, 1, LUA_TTABLE);
+    }
+    lua_settop(L, 1);
+    r  = lls_newuserdata(L, sizeof(lls_dns_t), NUV);
+    *r = (lls_dns_t){
+        .nns      = 0,
+        .timeout  = DEFAULT_TIMEOUT,
+        .attempts = DEFAULT_ATTEMPTS,
+    };
+    seed(r);
+    lauxh_setmetatable(L, DNS_MT);
+
+    if (lua_istable(L, 1)) {
+        // false disables the file
+        lua_getfield(L, 1, "resolvconf");
+        if (lua_type(L, -1) == LUA_TBOOLEAN && !lua_toboolean(L, -1)) {
+            resolvconf = NULL;
+        } else if (!lua_isnil(L, -1)) {
+            resolvconf = lauxh_checkstring(L, -1);
+        }
+        lua_getfield(L, 1, "hosts");
+        if (lua_type(L, -1) == LUA_TBOOLEAN && !lua_toboolean(L, -1)) {
+            hosts = NULL;
+        } else if (!lua_isnil(L, -1)) {
+            hosts = lauxh_checkstring(L, -1);
+        }
+    }
+    if (resolvconf) {
+        loadresolvconf(r, resolvconf);
+    }
+
+    if (lua_istable(L, 1)) {
+        lua_getfield(L, 1, "nameservers");
+        if (!lua_isnil(L, -1)) {
+            int idx = lua_gettop(L);
+
+            luaL_checktype(L, idx, LUA_TTABLE);
+            r->nns = 0;
+            for (int i = 1; r->nns < DNS_MAXNS; i++) {
+                lua_rawgeti(L, idx, i);
+                r->nslen[r->nns] = 0;
+                if (lua_isnil(L, -1)) {
+                    break;
+                } else if (lua_type(L, -1) == LUA_TSTRING) {
+                    size_t len      = 0;
+                    const char *str = lua_tolstring(L, -1, &len);
+
+                    r->nslen[r->nns] = lls_parseaddr(str, len, AF_UNSPEC,
+                                                     DNS_PORT, r->ns + r->nns);
+                } else if (lauxh_isuserdataof(L, -1, ADDRINFO_MT)) {
+                    lls_addrinfo_t *info = lua_touserdata(L, -1);
+
+                    if (info->ai.ai_family == AF_INET ||
+                        info->ai.ai_family == AF_INET6) {
+                        memcpy(r->ns + r->nns, info->ai.ai_addr,
+                               info->ai.ai_addrlen);
+                        r->nslen[r->nns] = info->ai.ai_addrlen;
+                    }
+                }
+                if (!r->nslen[r->nns]) {
+                    return luaL_argerror(L, 1,
+                                         "nameservers must be the list of "
+                                         "address literal or "
+                                         "llsocket.addrinfo");
+                }
+                r->nns++;
+                lua_pop(L, 1);
+            }
+        }
+        lua_getfield(L, 1, "timeout");
+        if (!lua_isnil(L, -1)) {
+            lua_Number v = luaL_checknumber(L, -1);
+
+            if (v <= 0) {
+                return luaL_argerror(L, 1, "timeout must be greater than 0");
+            }
+            r->timeout = (uint64_t)(v * 1000);
+        }
+        lua_getfield(L, 1, "attempts");
+        if (!lua_isnil(L, -1)) {
+            lua_Integer v = luaL_checkinteger(L, -1);
+
+            if (v < 1 || v > MAX_ATTEMPTS) {
+                return luaL_argerror(L, 1, "attempts must be between 1 and 5");
+            }
+            r->attempts = (int)v;
+        }
+    }
+
+    if (!r->nns) {
+        // use the nameserver on the local machine as resolv.conf(5) does
+        r->nslen[0] = lls_parseaddr("127.0.0.1", 9, AF_INET, DNS_PORT, r->ns);
+        r->nns      = 1;
+    }
+
+    lua_pushvalue(L, 2);
+    lua_newtable(L);
+    if (hosts) {
+        loadhosts(L, hosts);
+    }
+    lls_setuservalue(L, -2, UV_HOSTS);
+
+    return 1;
+}
+
+static int encode_lua(lua_State *L)
+{
+    size_t len       = 0;
+    const char *name = lauxh_checklstring(L, 1, &len);
+    uint16_t qtype   = lauxh_checkuint16(L, 2);
+    uint16_t id      = lauxh_optuint16(L, 3, 0);
+    uint8_t pkt[DNS_MAXQUERY];
+
+    if (!(len = encode(pkt, id, name, len, qtype))) {
+        lua_pushnil(L);
+        errno = EINVAL;
+        lua_errno_new(L, errno, "encode");
+        return 2;
+    }
+    lua_pushlstring(L, (const char *)pkt, len);
+
+    return 1;
+}
+
+static int decode_lua(lua_State *L)
+{
+    size_t len         = 0;
+    const uint8_t *msg = (const uint8_t *)lauxh_checklstring(L, 1, &len);
+    char name[DNS_MAXNAME + 1];
+    size_t off      = 12;
+    uint16_t qdcount = 0;
+    uint16_t ancount = 0;
+
+    if (len < 12) {
+        goto INVALID;
+    }
+    qdcount = get16(msg + 4);
+    ancount = get16(msg + 6);
+
+    lua_settop(L, 1);
+    lua_createtable(L, 0, 8);
+    lauxh_pushint2tbl(L, "id", get16(msg));
+    lauxh_pushbool2tbl(L, "qr", msg[2] & 0x80);
+    lauxh_pushbool2tbl(L, "tc", msg[2] & 0x02);
+    lauxh_pushbool2tbl(L, "rd", msg[2] & 0x01);
+    lauxh_pushint2tbl(L, "rcode", msg[3] & 0x0f);
+
+    // the first question
+    for (uint16_t i = 0; i < qdcount; i++) {
+        if (!(off = readname(msg, len, off, name)) || off + 4 > len) {
+            goto INVALID;
+        } else if (i == 0) {
+            lauxh_pushstr2tbl(L, "qname", name);
+            lauxh_pushint2tbl(L, "qtype", get16(msg + off));
+        }
+        off += 4;
+    }
+
+    // answers
+    lua_pushstring(L, "answers");
+    lua_createtable(L, ancount, 0);
+    for (uint16_t i = 0; i < ancount; i++) {
+        uint16_t type  = 0;
+        uint16_t rdlen = 0;
+        char addr[INET6_ADDRSTRLEN];
+
+        if (!(off = readname(msg, len, off, name)) || off + 10 > len) {
+            goto INVALID;
+        }
+        type  = get16(msg + off);
+        rdlen = get16(msg + off + 8);
+        if (off + 10 + rdlen > len) {
+            goto INVALID;
+        }
+        lua_createtable(L, 0, 5);
+        lauxh_pushstr2tbl(L, "name", name);
+        lauxh_pushint2tbl(L, "type", type);
+        lauxh_pushint2tbl(L, "class", get16(msg + off + 2));
+        lauxh_pushint2tbl(L, "ttl", ((uint32_t)get16(msg + off + 4) << 16) |
+                                        get16(msg + off + 6));
+        off += 10;
+        lua_pushstring(L, "data");
+        if ((type == T_A && rdlen == 4) || (type == T_AAAA && rdlen == 16)) {
+            inet_ntop((type == T_A) ? AF_INET : AF_INET6, msg + off, addr,
+                      sizeof(addr));
+            lua_pushstring(L, addr);
+        } else if (type == T_CNAME && readname(msg, len, off, name)) {
+            lua_pushstring(L, name);
+        } else {
+            lua_pushlstring(L, (const char *)msg + off, rdlen);
+        }
+        lua_rawset(L, -3);
+        lua_rawseti(L, -2, i + 1);
+        off += rdlen;
+    }
+    lua_rawset(L, -3);
+
+    return 1;
+
+INVALID:
+    lua_settop(L, 0);
+    lua_pushnil(L);
+    errno = EINVAL;
+    lua_errno_new(L, errno, "decode");
+    return 2;
+}
+
+LUALIB_API int luaopen_llsocket_dns(lua_State *L)
+{
+    // create metatable
+    if (luaL_newmetatable(L, DNS_MT)) {
+        struct luaL_Reg mmethod[] = {
+            {"__tostring", tostring_lua},
+            {NULL,         NULL        }
+        };
+        struct luaL_Reg method[] = {
+            {"query", query_lua},
+            {NULL,    NULL     }
+        };
+        struct luaL_Reg *ptr = mmethod;
+
+        // metamethods
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        // methods
+        lua_pushstring(L, "__index");
+        lua_newtable(L);
+        ptr = method;
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        lua_rawset(L, -3);
+    }
+    lua_pop(L, 1);
+
+    if (luaL_newmetatable(L, DNSQUERY_MT)) {
+        struct luaL_Reg mmethod[] = {
+            {"__gc",       q_gc_lua      },
+            {"__tostring", q_tostring_lua},
+            {NULL,         NULL          }
+        };
+        struct luaL_Reg method[] = {
+            {"fd",     q_fd_lua    },
+            {"socket", q_socket_lua},
+            {"step",   q_step_lua  },
+            {"close",  q_close_lua },
+            {NULL,     NULL        }
+        };
+        struct luaL_Reg *ptr = mmethod;
+
+        // metamethods
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        // methods
+        lua_pushstring(L, "__index");
+        lua_newtable(L);
+        ptr = method;
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        lua_rawset(L, -3);
+    }
+    lua_pop(L, 1);
+
+    // create module table
+    lua_newtable(L);
+    lauxh_pushfn2tbl(L, "new", new_lua);
+    lauxh_pushfn2tbl(L, "encode", encode_lua);
+    lauxh_pushfn2tbl(L, "decode", decode_lua);
+    lauxh_pushint2tbl(L, "T_A", T_A);
+    lauxh_pushint2tbl(L, "T_AAAA", T_AAAA);
+    lauxh_pushint2tbl(L, "T_CNAME", T_CNAME);
+
+    return 1;
+}
@@ -0,0 +1,83 @@
+/**
+ *  Copyright (C) 2026 Masatoshi Fukunaga
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ *  ffi.c
+ *  lua-llsocket
+ */
+
+#include "llsocket.h"
+
+// the C declarations of struct iovec and struct msghdr for ffi.cdef
+static const char MSGHDR_CDEF[] =
+    "typedef uint32_t socklen_t;"
+    "struct iovec {"
+    "    void *iov_base;"
+    "    size_t iov_len;"
+    "};"
+    "struct msghdr {"
+    "    void *msg_name;"
+    "    socklen_t msg_namelen;"
+    "    struct iovec *msg_iov;"
+#if defined(__linux__)
+    "    size_t msg_iovlen;"
+    "    void *msg_control;"
+    "    size_t msg_controllen;"
+#else
+    "    int msg_iovlen;"
+    "    void *msg_control;"
+    "    socklen_t msg_controllen;"
+#endif
+    "    int msg_flags;"
+    "};";
+
+// ffi.cdef does not know ssize_t
+#define ssize_t intptr_t
+static const char CDEF[] =
+    LLS_TOSTRING(LLS_SOCKET_DECL LLS_MMSGHDR_DECL LLS_ABI_DECL
+                 LLS_CAPI_DECL);
+#undef ssize_t
+
+static inline void pushfnptr(lua_State *L, const char *name, void *fn)
+{
+    lua_pushstring(L, name);
+    lua_pushlightuserdata(L, fn);
+    lua_rawset(L, -3);
+}
+
+LUALIB_API int luaopen_llsocket_ffi(lua_State *L)
+{
+    // create module table
+    lua_newtable(L);
+    lauxh_pushint2tbl(L, "version", LLS_ABI_VERSION);
+    lauxh_pushstr2tbl(L, "cdef", CDEF);
+    lauxh_pushstr2tbl(L, "msghdr_cdef", MSGHDR_CDEF);
+    // pointers to the functions of the stable C ABI
+    pushfnptr(L, "fd", (void *)lls_socket_fd);
+    pushfnptr(L, "family", (void *)lls_socket_family);
+    pushfnptr(L, "socktype", (void *)lls_socket_socktype);
+    pushfnptr(L, "protocol", (void *)lls_socket_protocol);
+    pushfnptr(L, "send", (void *)lls_socket_send);
+    pushfnptr(L, "recv", (void *)lls_socket_recv);
+    pushfnptr(L, "sendmsg", (void *)lls_socket_sendmsg);
+    pushfnptr(L, "recvmmsg", (void *)lls_socket_recvmmsg);
+
+    return 1;
+}
@@ -44,14 +44,20 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/uio.h>
 #include <sys/un.h>
 #include <time.h>
 #include <unistd.h>
+#if defined(__linux__)
+# include <linux/errqueue.h>
+# include <linux/sockios.h>
+#endif
 // lualib
 #include "config.h"
 #include "lauxhlib.h"
+#include "../include/lls_socket.h"
 #include <lua_errno.h>
 #include <lua_iovec.h>
 
@@ -61,6 +67,20 @@
 #define CMSGHDRS_MT "llsocket.cmsghdrs"
 #define MSGHDR_MT   "llsocket.msghdr"
 #define GCFN_MT     "llsocket.gcfn"
+#define BUFFER_MT   "llsocket.buffer"
+#define OUTQ_MT     "llsocket.outq"
+#define BUDGET_MT   "llsocket.budget"
+#define RBUF_MT     "llsocket.rbuf"
+#define WHEEL_MT    "llsocket.wheel"
+#define PEERMAP_MT  "llsocket.peermap"
+#define RESOLVER_MT "llsocket.resolver"
+#define RESREQ_MT   "llsocket.resolver.request"
+#define AICACHE_MT  "llsocket.addrinfo.cache"
+#define DNS_MT      "llsocket.dns"
+#define DNSQUERY_MT "llsocket.dns.query"
+#define CONNECT_MT  "llsocket.connector"
+#define POOL_MT     "llsocket.pool"
+#define UDPCACHE_MT "llsocket.udpcache"
 
 #if defined(__linux__)
 # include <linux/if.h>
@@ -83,6 +103,22 @@ LUALIB_API int luaopen_llsocket_cmsghdr(lua_State *L);
 LUALIB_API int luaopen_llsocket_cmsghdrs(lua_State *L);
 LUALIB_API int luaopen_llsocket_msghdr(lua_State *L);
 LUALIB_API int luaopen_llsocket_env(lua_State *L);
+LUALIB_API int luaopen_llsocket_buffer(lua_State *L);
+LUALIB_API int luaopen_llsocket_outq(lua_State *L);
+LUALIB_API int luaopen_llsocket_wheel(lua_State *L);
+LUALIB_API int luaopen_llsocket_ffi(lua_State *L);
+LUALIB_API int luaopen_llsocket_peermap(lua_State *L);
+LUALIB_API int luaopen_llsocket_resolver(lua_State *L);
+LUALIB_API int luaopen_llsocket_dns(lua_State *L);
+LUALIB_API int luaopen_llsocket_connector(lua_State *L);
+LUALIB_API int luaopen_llsocket_pool(lua_State *L);
+LUALIB_API int luaopen_llsocket_udpcache(lua_State *L);
+
+/**
+ * @brief lls_capi_init publish the C API capsule to the registry.
+ * @param L Lua state
+ */
+void lls_capi_init(lua_State *L);
 
 // gc function
 
@@ -137,6 +173,238 @@ int lls_gcfn_del(lua_State *L, lls_gcfn_t *gcf);
  */
 void lls_gcfn_call(lua_State *L, lls_gcfn_t *gcf);
 
+// read buffer budget
+
+/**
+ * @brief lls_budget_t
+ * the accounting of bytes held by the read buffers that allocated by llsocket.
+ * the budget of each socket is chained to the global budget of the Lua state.
+ */
+typedef struct lls_budget_st {
+    // number of bytes held
+    size_t used;
+    // maximum number of bytes that can be held, or 0 for unlimited
+    size_t limit;
+    // number of reads that refused by the limit
+    size_t nexceeded;
+    struct lls_budget_st *parent;
+} lls_budget_t;
+
+/**
+ * @brief lls_budget_init create the global budget of the Lua state.
+ * @param L Lua state
+ */
+void lls_budget_init(lua_State *L);
+
+/**
+ * @brief lls_budget_global get the global budget of the Lua state.
+ * @param L Lua state
+ * @return lls_budget_t*
+ */
+lls_budget_t *lls_budget_global(lua_State *L);
+
+/**
+ * @brief lls_budget_new create a new budget that chained to the global budget
+ * and push it onto the stack.
+ * @param L Lua state
+ * @return lls_budget_t*
+ */
+lls_budget_t *lls_budget_new(lua_State *L);
+
+/**
+ * @brief lls_budget_check check whether the read buffer of the specified size
+ * can be allocated within the budget and its parents.
+ * @param b budget
+ * @param len size of the read buffer
+ * @return 1 on success, or 0 with errno set to ENOBUFS.
+ */
+static inline int lls_budget_check(lls_budget_t *b, size_t len)
+{
+    for (; b; b = b->parent) {
+        if (b->limit && (b->used >= b->limit || len > b->limit - b->used)) {
+            b->nexceeded++;
+            errno = ENOBUFS;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief lls_budget_alloc allocate the read buffer for the budget and push it
+ * onto the stack. nothing is accounted until lls_budget_charge is called.
+ * @param L Lua state
+ * @param b budget
+ * @param ref reference of the budget, or LUA_NOREF
+ * @param len size of the read buffer
+ * @return char* the read buffer.
+ */
+char *lls_budget_alloc(lua_State *L, lls_budget_t *b, int ref, size_t len);
+
+/**
+ * @brief lls_budget_charge account the bytes held by the read buffer at the
+ * specified stack index to the budget and its parents. the accounting is
+ * released when the read buffer is garbage collected.
+ * @param L Lua state
+ * @param idx index of the read buffer
+ * @param len number of bytes held
+ */
+void lls_budget_charge(lua_State *L, int idx, size_t len);
+
+/**
+ * @brief lls_socket_st
+ * the private layout of lls_socket_t that declared as the opaque handle in
+ * lls_socket.h.
+ */
+struct lls_socket_st {
+    int fd;
+    int family;
+    int socktype;
+    int protocol;
+    lls_gcfn_t *gcfunc;
+    // pipe for vmsplice
+    int pipefd[2];
+    // number of bytes remaining in the pipe
+    size_t npipe;
+    // reference of the messages that their pages are not yet sent
+    int pipe_ref;
+    // range of the messages in the pipe_ref table
+    int pin_head;
+    int pin_tail;
+    // total number of bytes spliced into the send queue
+    uint64_t spliced;
+    // budget of the read buffers
+    lls_budget_t *budget;
+    int budget_ref;
+    // timer of the timing wheel
+    struct lls_timer_st *timer;
+};
+
+// timing wheel
+
+#define LLS_WHEEL_BITS   6
+#define LLS_WHEEL_SLOTS  (1 << LLS_WHEEL_BITS)
+#define LLS_WHEEL_LEVELS 4
+
+/**
+ * @brief lls_timer_t
+ * the timer of the socket that attached to the timing wheel.
+ * the timeouts and the last activities are in ticks.
+ */
+typedef struct lls_timer_st {
+    // list of the wheel slot or the expired list
+    struct lls_timer_st **pprev;
+    struct lls_timer_st *next;
+    // list in order of the least recently active
+    struct lls_timer_st *lprev;
+    struct lls_timer_st *lnext;
+    struct lls_wheel_st *wheel;
+    lls_socket_t *sock;
+    int ref;
+    uint64_t idle;
+    uint64_t rdtimeo;
+    uint64_t wrtimeo;
+    uint64_t idle_at;
+    uint64_t read_at;
+    uint64_t write_at;
+    // scheduled tick
+    uint64_t expire;
+} lls_timer_t;
+
+typedef struct lls_wheel_st {
+    // milliseconds per tick
+    uint64_t msec;
+    // current tick
+    uint64_t cur;
+    // number of attached timers
+    size_t ntimer;
+    // number of timers in the wheel slots
+    size_t nsched;
+    // maximum number of timers, or 0 for unlimited
+    size_t maxconn;
+    lls_timer_t *lru_head;
+    lls_timer_t *lru_tail;
+    lls_timer_t *expired;
+    lls_timer_t *slots[LLS_WHEEL_LEVELS][LLS_WHEEL_SLOTS];
+} lls_wheel_t;
+
+#define LLS_TOUCH_READ  0x1
+#define LLS_TOUCH_WRITE 0x2
+
+/**
+ * @brief lls_timer_touch update the last activity of the socket with the
+ * current tick of the timing wheel. the timer is rescheduled lazily when its
+ * slot is expired.
+ * @param s socket
+ * @param flg LLS_TOUCH_READ and/or LLS_TOUCH_WRITE
+ */
+static inline void lls_timer_touch(lls_socket_t *s, int flg)
+{
+    lls_timer_t *t = s->timer;
+
+    if (t) {
+        lls_wheel_t *w = t->wheel;
+
+        t->idle_at = w->cur;
+        if (flg & LLS_TOUCH_READ) {
+            t->read_at = w->cur;
+        }
+        if (flg & LLS_TOUCH_WRITE) {
+            t->write_at = w->cur;
+        }
+
+        // move to the tail of the least recently active list
+        if (t != w->lru_tail) {
+            if (t->lprev) {
+                t->lprev->lnext = t->lnext;
+            } else {
+                w->lru_head = t->lnext;
+            }
+            t->lnext->lprev    = t->lprev;
+            t->lprev           = w->lru_tail;
+            t->lnext           = NULL;
+            w->lru_tail->lnext = t;
+            w->lru_tail        = t;
+        }
+    }
+}
+
+/**
+ * @brief lls_timer_detach detach the socket from the timing wheel.
+ * @param L Lua state
+ * @param s socket
+ */
+void lls_timer_detach(lua_State *L, lls_socket_t *s);
+
+/**
+ * @brief lls_socket_new create a new llsocket.socket object that owns the
+ * descriptor and push it onto the stack.
+ * @param L Lua state
+ * @param fd descriptor
+ * @param family address family
+ * @param socktype socket type
+ * @param protocol protocol
+ * @return lls_socket_t*
+ */
+lls_socket_t *lls_socket_new(lua_State *L, int fd, int family, int socktype,
+                             int protocol);
+
+/**
+ * @brief lls_socket_connectpeer create a new llsocket.socket object by
+ * lls_connectpeer and push it onto the stack, followed by the list of the
+ * {msg, llsocket.addrinfo} pairs of the datagrams from the other peers that
+ * were received by the new socket before it was connected, or nil if none.
+ * @param L Lua state
+ * @param s bound datagram socket
+ * @param peer peer address
+ * @param len length of the peer address
+ * @return lls_socket_t* new socket, or NULL with errno without pushing
+ * anything.
+ */
+lls_socket_t *lls_socket_connectpeer(lua_State *L, lls_socket_t *s,
+                                     const struct sockaddr *peer,
+                                     socklen_t len);
+
 #define ERROR_TYPE_NAME "llsocket.error"
 
 static inline void lls_initerror(lua_State *L)
@@ -151,8 +419,183 @@ static inline void lls_initerror(lua_State *L)
     lua_pop(L, 1);
 }
 
+/**
+ * @brief user values
+ * the values associated with the userdata are kept alive while the userdata
+ * is alive, without the registry references and the finalizer. Lua 5.4
+ * supports multiple user values natively, and the older versions store them
+ * in the table that associated with the userdata.
+ */
+#if LUA_VERSION_NUM >= 504
+# define lls_newuserdata(L, size, nuv) lua_newuserdatauv((L), (size), (nuv))
+# define lls_getuservalue(L, idx, n)    lua_getiuservalue((L), (idx), (n))
+# define lls_setuservalue(L, idx, n)    lua_setiuservalue((L), (idx), (n))
+#else
+
+# if LUA_VERSION_NUM < 502
+// registry key of the empty table shared by the userdata that have no user
+// values yet
+#  define LLS_EMPTY_UV "llsocket.uv.empty"
+
+static inline void lls_pushemptyuv(lua_State *L)
+{
+    lua_getfield(L, LUA_REGISTRYINDEX, LLS_EMPTY_UV);
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, LUA_REGISTRYINDEX, LLS_EMPTY_UV);
+    }
+}
+# endif
+
+/**
+ * @brief lls_newuserdata create a new userdata that can hold nuv user values.
+ * @param L Lua state
+ * @param size size of the userdata
+ * @param nuv number of user values
+ * @return void*
+ */
+static inline void *lls_newuserdata(lua_State *L, size_t size, int nuv)
+{
+    void *udata = lua_newuserdata(L, size);
+
+# if LUA_VERSION_NUM >= 502
+    // the table will be created on demand
+    (void)nuv;
+# else
+    // environment of the userdata must be a table, so the shared empty table
+    // is used until the first user value is set
+    if (nuv > 0) {
+        lls_pushemptyuv(L);
+        lua_setfenv(L, -2);
+    }
+# endif
+    return udata;
+}
+
+/**
+ * @brief lls_getuservalue push the n-th user value of the userdata at the
+ * specified stack index.
+ * @param L Lua state
+ * @param idx index of the userdata
+ * @param n index of the user value
+ */
+static inline void lls_getuservalue(lua_State *L, int idx, int n)
+{
+# if LUA_VERSION_NUM >= 502
+    lua_getuservalue(L, idx);
+# else
+    lua_getfenv(L, idx);
+# endif
+    if (lua_istable(L, -1)) {
+        lua_rawgeti(L, -1, n);
+        lua_replace(L, -2);
+        return;
+    }
+    lua_pop(L, 1);
+    lua_pushnil(L);
+}
+
+/**
+ * @brief lls_setuservalue pop a value from the stack and set it as the n-th
+ * user value of the userdata at the specified stack index.
+ * @param L Lua state
+ * @param idx index of the userdata
+ * @param n index of the user value
+ */
+static inline void lls_setuservalue(lua_State *L, int idx, int n)
+{
+    if (idx < 0 && idx > LUA_REGISTRYINDEX) {
+        idx = lua_gettop(L) + idx + 1;
+    }
+# if LUA_VERSION_NUM >= 502
+    lua_getuservalue(L, idx);
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        lua_createtable(L, n, 0);
+        lua_pushvalue(L, -1);
+        lua_setuservalue(L, idx);
+    }
+# else
+    lua_getfenv(L, idx);
+    lls_pushemptyuv(L);
+    if (lua_rawequal(L, -1, -2)) {
+        // create the table on demand
+        lua_pop(L, 2);
+        lua_createtable(L, n, 0);
+        lua_pushvalue(L, -1);
+        lua_setfenv(L, idx);
+    } else {
+        lua_pop(L, 1);
+    }
+# endif
+    lua_insert(L, -2);
+    lua_rawseti(L, -2, n);
+    lua_pop(L, 1);
+}
+
+#endif
+
+// user value of lls_buffer_t
+#define LLS_BUFFER_UV_STORAGE 1
+
+/**
+ * @brief lls_buffer_t
+ * the immutable byte-slice that refers to the part of the backing storage.
+ * the backing storage is either a lua string or a userdata memory block, and
+ * it is shared by all slices that created from the same storage.
+ */
+typedef struct {
+    size_t len;
+    const char *data;
+} lls_buffer_t;
+
+/**
+ * @brief lls_buffer_alloc create a new lls_buffer_t that refers to the range
+ * of the storage at the top of the stack. the storage will be popped.
+ * @param L Lua state
+ * @param data head of the range
+ * @param len length of the range
+ * @return lls_buffer_t*
+ */
+static inline lls_buffer_t *lls_buffer_alloc(lua_State *L, const char *data,
+                                             size_t len)
+{
+    lls_buffer_t *b = lls_newuserdata(L, sizeof(lls_buffer_t), 1);
+
+    // the storage is kept alive by the user value
+    lua_insert(L, -2);
+    lls_setuservalue(L, -2, LLS_BUFFER_UV_STORAGE);
+    b->len  = len;
+    b->data = data;
+    lauxh_setmetatable(L, BUFFER_MT);
+
+    return b;
+}
+
+/**
+ * @brief lls_checkbytes get the pointer and length of a string or
+ * llsocket.buffer at the specified stack index.
+ * @param L Lua state
+ * @param idx index of argument
+ * @param len length of bytes
+ * @return const char*
+ */
+static inline const char *lls_checkbytes(lua_State *L, int idx, size_t *len)
+{
+    if (lua_type(L, idx) == LUA_TUSERDATA) {
+        lls_buffer_t *b = lauxh_checkudata(L, idx, BUFFER_MT);
+        *len            = b->len;
+        return b->data;
+    }
+    return lauxh_checklstring(L, idx, len);
+}
+
+// user value of lls_cmsghdr_t
+#define LLS_CMSGHDR_UV_DATA 1
+
 typedef struct {
-    int ref;
     // originating protocol
     int level;
     // protocol-specific type
@@ -162,32 +605,46 @@ typedef struct {
     const char *data;
 } lls_cmsghdr_t;
 
+// user value of lls_cmsghdrs_t
+#define LLS_CMSGHDRS_UV_DATA 1
+
 typedef struct {
-    int ref;
     size_t bytes;
     size_t len;
     char *data;
 } lls_cmsghdrs_t;
 
+// user values of lls_msghdr_t
+#define LLS_MSGHDR_UV_NAME    1
+#define LLS_MSGHDR_UV_IOV     2
+#define LLS_MSGHDR_UV_CONTROL 3
+#define LLS_MSGHDR_NUV        3
+
 typedef struct {
-    // msg_name
-    int name_ref;
-    // msg_iov
-    int iov_ref;
-    // msg_control
-    int control_ref;
     // msg_flags
     int flags;
     // data pointers
     struct addrinfo *name;
     lua_iovec_t *iov;
+    lls_buffer_t *buf;
     lls_cmsghdrs_t *control;
 } lls_msghdr_t;
 
+// user values of lls_addrinfo_t
+#define LLS_ADDRINFO_UV_CANONNAME 1
+#define LLS_ADDRINFO_NUV          1
+
+/**
+ * @brief lls_addrinfo_t
+ * the ai.ai_addr always points to the inline addr field.
+ * the result of addr() is memoized in the inline straddr field, so it does
+ * not need a user value.
+ */
 typedef struct {
-    int ai_addr_ref;
-    int ai_canonname_ref;
     struct addrinfo ai;
+    struct sockaddr_storage addr;
+    // memoized result of addr(), or empty string if not yet formatted
+    char straddr[INET6_ADDRSTRLEN];
 } lls_addrinfo_t;
 
 static inline lls_cmsghdr_t *lls_cmsghdr_alloc(lua_State *L, int level,
@@ -195,10 +652,10 @@ static inline lls_cmsghdr_t *lls_cmsghdr_alloc(lua_State *L, int level,
 {
     size_t len          = 0;
     const char *data    = lauxh_checklstring(L, -1, &len);
-    lls_cmsghdr_t *cmsg = lua_newuserdata(L, sizeof(lls_cmsghdr_t));
+    lls_cmsghdr_t *cmsg = lls_newuserdata(L, sizeof(lls_cmsghdr_t), 1);
 
     lua_pushvalue(L, -2);
-    cmsg->ref   = lauxh_ref(L);
+    lls_setuservalue(L, -2, LLS_CMSGHDR_UV_DATA);
     cmsg->level = level;
     cmsg->type  = type;
     cmsg->len   = len;
@@ -237,20 +694,20 @@ static inline int lls_getaddrinfo(struct addrinfo **list, const char *node,
 static inline lls_addrinfo_t *lls_addrinfo_alloc(lua_State *L,
                                                  struct addrinfo *src)
 {
-    lls_addrinfo_t *info = lua_newuserdata(L, sizeof(lls_addrinfo_t));
+    lls_addrinfo_t *info =
+        lls_newuserdata(L, sizeof(lls_addrinfo_t), LLS_ADDRINFO_NUV);
 
     // copy data
     memcpy((void *)&info->ai, (void *)src, sizeof(struct addrinfo));
-    info->ai.ai_addr    = lua_newuserdata(L, sizeof(struct sockaddr_storage));
-    info->ai_addr_ref   = lauxh_ref(L);
-    info->ai.ai_addrlen = src->ai_addrlen;
+    info->ai.ai_addr = (struct sockaddr *)&info->addr;
     memcpy((void *)info->ai.ai_addr, (void *)src->ai_addr, src->ai_addrlen);
-    info->ai.ai_canonname  = NULL;
-    info->ai_canonname_ref = LUA_NOREF;
+    info->ai.ai_next      = NULL;
+    info->ai.ai_canonname = NULL;
+    info->straddr[0]      = 0;
     if (src->ai_canonname) {
         lua_pushstring(L, src->ai_canonname);
-        info->ai.ai_canonname  = (char *)lua_tostring(L, -1);
-        info->ai_canonname_ref = lauxh_ref(L);
+        info->ai.ai_canonname = (char *)lua_tostring(L, -1);
+        lls_setuservalue(L, -2, LLS_ADDRINFO_UV_CANONNAME);
     }
     // set metatable
     lauxh_setmetatable(L, ADDRINFO_MT);
@@ -258,6 +715,272 @@ static inline lls_addrinfo_t *lls_addrinfo_alloc(lua_State *L,
     return info;
 }
 
+/**
+ * @brief lls_addrinfo_pushlist push a table of llsocket.addrinfo objects
+ * created from the result of getaddrinfo.
+ * @param L Lua state
+ * @param list result of getaddrinfo
+ */
+static inline void lls_addrinfo_pushlist(lua_State *L, struct addrinfo *list)
+{
+    int idx = 1;
+
+    lua_newtable(L);
+    for (; list; list = list->ai_next) {
+        lls_addrinfo_alloc(L, list);
+        lua_rawseti(L, -2, idx++);
+    }
+}
+
+/**
+ * @brief lls_aicache_init create the lookup cache of the Lua state, and add
+ * the cache functions to the module table on the top of the stack.
+ * @param L Lua state
+ */
+void lls_aicache_init(lua_State *L);
+
+/**
+ * @brief lls_aicache_getaddrinfo call getaddrinfo through the lookup cache,
+ * and push the list of llsocket.addrinfo objects, or nil and the error
+ * object.
+ * @param L Lua state
+ * @param node node name or NULL
+ * @param service service name or NULL
+ * @param hints hints
+ * @return int number of the pushed values
+ */
+int lls_aicache_getaddrinfo(lua_State *L, const char *node,
+                            const char *service, const struct addrinfo *hints);
+
+/**
+ * @brief lls_aicache_getnameinfo call getnameinfo through the lookup cache,
+ * and push the nameinfo table, or nil and the error object.
+ * @param L Lua state
+ * @param sa socket address
+ * @param len length of the socket address
+ * @param flags NI_* flags
+ * @return int number of the pushed values
+ */
+int lls_aicache_getnameinfo(lua_State *L, const struct sockaddr *sa,
+                            socklen_t len, int flags);
+
+/**
+ * @brief lls_addrinfo_reset update the addrinfo at the specified stack index
+ * after its address storage has been overwritten, and discard the memoized
+ * result of addr().
+ * @param L Lua state
+ * @param idx index of the addrinfo
+ * @param addrlen length of the new address
+ */
+static inline void lls_addrinfo_reset(lua_State *L, int idx, socklen_t addrlen)
+{
+    lls_addrinfo_t *info = lua_touserdata(L, idx);
+
+    info->ai.ai_family  = info->addr.ss_family;
+    info->ai.ai_addrlen = addrlen;
+    info->straddr[0]    = 0;
+}
+
+/**
+ * @brief lls_addrinfo_copy overwrite the addrinfo at the specified stack index
+ * with the src, instead of allocating a new addrinfo.
+ * @param L Lua state
+ * @param idx index of the addrinfo
+ * @param src source addrinfo
+ */
+static inline void lls_addrinfo_copy(lua_State *L, int idx,
+                                     struct addrinfo *src)
+{
+    lls_addrinfo_t *info = lua_touserdata(L, idx);
+
+    if (idx < 0 && idx > LUA_REGISTRYINDEX) {
+        idx = lua_gettop(L) + idx + 1;
+    }
+    info->ai.ai_flags    = src->ai_flags;
+    info->ai.ai_socktype = src->ai_socktype;
+    info->ai.ai_protocol = src->ai_protocol;
+    memcpy((void *)&info->addr, (void *)src->ai_addr, src->ai_addrlen);
+    if (info->ai.ai_canonname) {
+        info->ai.ai_canonname = NULL;
+        lua_pushnil(L);
+        lls_setuservalue(L, idx, LLS_ADDRINFO_UV_CANONNAME);
+    }
+    lls_addrinfo_reset(L, idx, src->ai_addrlen);
+    info->ai.ai_family = src->ai_family;
+}
+
+/**
+ * @brief lls_hash calculate the FNV-1a hash of the bytes.
+ * @param data bytes
+ * @param len length of bytes
+ * @param seed initial value
+ * @return uint32_t
+ */
+static inline uint32_t lls_hash(const void *data, size_t len, uint32_t seed)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t h       = 2166136261U ^ seed;
+
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 16777619U;
+    }
+    return h;
+}
+
+/**
+ * @brief lls_peerkey_t
+ * the fixed-size binary key of the inet/inet6 peer address. the IPv4-mapped
+ * IPv6 address is normalized to the IPv4 address.
+ */
+typedef struct {
+    uint16_t family;
+    // port number in network byte order
+    uint16_t port;
+    // sin6_scope_id
+    uint32_t scope;
+    uint8_t addr[16];
+} lls_peerkey_t;
+
+/**
+ * @brief lls_peerkey_init initialize the key with the socket address.
+ * @param key key
+ * @param sa socket address
+ * @param len length of the socket address
+ * @return int 0 on success, or -1 with errno if the address family is not
+ * AF_INET or AF_INET6.
+ */
+static inline int lls_peerkey_init(lls_peerkey_t *key,
+                                   const struct sockaddr *sa, socklen_t len)
+{
+    memset((void *)key, 0, sizeof(lls_peerkey_t));
+    if (len >= sizeof(struct sockaddr_in) && sa->sa_family == AF_INET) {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)sa;
+
+        key->family = AF_INET;
+        key->port   = sin->sin_port;
+        memcpy(key->addr, &sin->sin_addr, 4);
+        return 0;
+    } else if (len >= sizeof(struct sockaddr_in6) &&
+               sa->sa_family == AF_INET6) {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)sa;
+
+        key->port = sin6->sin6_port;
+        if (IN6_IS_ADDR_V4MAPPED(&sin6->sin6_addr)) {
+            // normalize to ipv4 address
+            key->family = AF_INET;
+            memcpy(key->addr, sin6->sin6_addr.s6_addr + 12, 4);
+        } else {
+            key->family = AF_INET6;
+            key->scope  = sin6->sin6_scope_id;
+            memcpy(key->addr, &sin6->sin6_addr, 16);
+        }
+        return 0;
+    }
+
+    errno = EAFNOSUPPORT;
+    return -1;
+}
+
+/**
+ * @brief LLS_PACKED_INET_LEN, LLS_PACKED_INET6_LEN
+ * length of the packed address. the packed address is the canonical binary
+ * encoding that does not depend on the platform;
+ *
+ *  tag(1: 4 or 6) | port(2) | addr(4 or 16) | scope(4: inet6 only)
+ *
+ * all integers are in network byte order.
+ */
+#define LLS_PACKED_INET_LEN  7
+#define LLS_PACKED_INET6_LEN 23
+
+/**
+ * @brief lls_addr_pack encode the socket address into the buf.
+ * @param buf buffer that has at least LLS_PACKED_INET6_LEN bytes
+ * @param sa socket address
+ * @param len length of the socket address
+ * @return size_t number of bytes written, or 0 if the address family is not
+ * AF_INET or AF_INET6.
+ */
+static inline size_t lls_addr_pack(uint8_t *buf, const struct sockaddr *sa,
+                                   socklen_t len)
+{
+    if (len >= sizeof(struct sockaddr_in) && sa->sa_family == AF_INET) {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)sa;
+
+        buf[0] = 4;
+        memcpy(buf + 1, &sin->sin_port, 2);
+        memcpy(buf + 3, &sin->sin_addr, 4);
+        return LLS_PACKED_INET_LEN;
+    } else if (len >= sizeof(struct sockaddr_in6) &&
+               sa->sa_family == AF_INET6) {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)sa;
+        uint32_t scope                  = htonl(sin6->sin6_scope_id);
+
+        buf[0] = 6;
+        memcpy(buf + 1, &sin6->sin6_port, 2);
+        memcpy(buf + 3, &sin6->sin6_addr, 16);
+        memcpy(buf + 19, &scope, 4);
+        return LLS_PACKED_INET6_LEN;
+    }
+    return 0;
+}
+
+/**
+ * @brief lls_addr_unpack decode the first packed address in the buf.
+ * @param buf packed addresses
+ * @param len length of the buf
+ * @param sockaddr decoded socket address
+ * @param addrlen length of the decoded socket address
+ * @return size_t number of bytes consumed, or 0 if the buf does not start
+ * with a packed address.
+ */
+static inline size_t lls_addr_unpack(const uint8_t *buf, size_t len,
+                                     struct sockaddr_storage *sockaddr,
+                                     socklen_t *addrlen)
+{
+    memset((void *)sockaddr, 0, sizeof(struct sockaddr_storage));
+    if (len >= LLS_PACKED_INET_LEN && buf[0] == 4) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)sockaddr;
+
+#ifdef HAVE_SOCKADDR_SA_LEN
+        sin->sin_len = sizeof(struct sockaddr_in);
+#endif
+        sin->sin_family = AF_INET;
+        memcpy(&sin->sin_port, buf + 1, 2);
+        memcpy(&sin->sin_addr, buf + 3, 4);
+        *addrlen = sizeof(struct sockaddr_in);
+        return LLS_PACKED_INET_LEN;
+    } else if (len >= LLS_PACKED_INET6_LEN && buf[0] == 6) {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)sockaddr;
+        uint32_t scope            = 0;
+
+#ifdef HAVE_SOCKADDR_SA_LEN
+        sin6->sin6_len = sizeof(struct sockaddr_in6);
+#endif
+        sin6->sin6_family = AF_INET6;
+        memcpy(&sin6->sin6_port, buf + 1, 2);
+        memcpy(&sin6->sin6_addr, buf + 3, 16);
+        memcpy(&scope, buf + 19, 4);
+        sin6->sin6_scope_id = ntohl(scope);
+        *addrlen            = sizeof(struct sockaddr_in6);
+        return LLS_PACKED_INET6_LEN;
+    }
+    return 0;
+}
+
+/**
+ * @brief lls_peermap_get push the value associated with the socket address
+ * in the llsocket.peermap at the specified stack index, or nil if not found.
+ * @param L Lua state
+ * @param idx index of the llsocket.peermap
+ * @param sa socket address
+ * @param len length of the socket address
+ * @return int 1 if found, 0 otherwise.
+ */
+int lls_peermap_get(lua_State *L, int idx, const struct sockaddr *sa,
+                    socklen_t len);
+
 static inline void *lls_checkudata(lua_State *L, int idx, const char *tname)
 {
     const int argc = lua_gettop(L);
@@ -286,11 +1009,234 @@ static inline void *lls_checkudata(lua_State *L, int idx, const char *tname)
     return NULL;
 }
 
-static inline int lls_checksockaddr(lua_State *L, int idx, int family,
-                                    int socktype,
-                                    struct sockaddr_storage *sockaddr)
+/**
+ * @brief lls_parse4inaddr parse the dotted-decimal IPv4 address literal
+ * without allocating. the leading zeros and the shorthand forms are rejected
+ * as inet_pton does.
+ * @param str address literal
+ * @param len length of the str
+ * @param addr parsed address
+ * @return int 0 on success, or -1 if the str is not an IPv4 address literal.
+ */
+static inline int lls_parse4inaddr(const char *str, size_t len,
+                                   struct in_addr *addr)
+{
+    const char *end = str + len;
+    uint8_t buf[4]  = {0};
+
+    for (int n = 0; n < 4; n++) {
+        uint32_t v = 0;
+        int nd     = 0;
+
+        if (n && (str == end || *str++ != '.')) {
+            return -1;
+        } else if (str + 1 < end && *str == '0' && str[1] >= '0' &&
+                   str[1] <= '9') {
+            // leading zero
+            return -1;
+        }
+        while (str < end && nd < 3 && *str >= '0' && *str <= '9') {
+            v = v * 10 + (uint32_t)(*str++ - '0');
+            nd++;
+        }
+        if (!nd || v > 255) {
+            return -1;
+        }
+        buf[n] = (uint8_t)v;
+    }
+    if (str != end) {
+        return -1;
+    }
+    memcpy((void *)addr, buf, 4);
+
+    return 0;
+}
+
+static inline int lls_hexval(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief lls_parse6inaddr parse the IPv6 address literal without allocating.
+ * the literal may contain the embedded IPv4 address and the zone index
+ * suffix, e.g. 'fe80::1%eth0' or 'fe80::1%2'.
+ * @param str address literal
+ * @param len length of the str
+ * @param addr parsed address
+ * @param scope parsed zone index, or 0 if not specified
+ * @return int 0 on success, or -1 if the str is not an IPv6 address literal.
+ */
+static inline int lls_parse6inaddr(const char *str, size_t len,
+                                   struct in6_addr *addr, uint32_t *scope)
+{
+    const char *end = str + len;
+    const char *pct = memchr(str, '%', len);
+    uint8_t buf[16] = {0};
+    size_t n        = 0;
+    size_t gap      = SIZE_MAX;
+
+    *scope = 0;
+    if (pct) {
+        // zone index
+        const char *zone = pct + 1;
+        size_t zlen      = (size_t)(end - zone);
+        uint64_t v       = 0;
+        size_t i         = 0;
+
+        if (!zlen || zlen >= IF_NAMESIZE) {
+            return -1;
+        }
+        for (; i < zlen && zone[i] >= '0' && zone[i] <= '9'; i++) {
+            v = v * 10 + (uint64_t)(zone[i] - '0');
+            if (v > UINT32_MAX) {
+                return -1;
+            }
+        }
+        if (i == zlen) {
+            *scope = (uint32_t)v;
+        } else {
+            char name[IF_NAMESIZE] = {0};
+
+            memcpy(name, zone, zlen);
+            if (!(*scope = if_nametoindex(name))) {
+                return -1;
+            }
+        }
+        end = pct;
+    }
+
+    if (str < end && *str == ':') {
+        if (end - str < 2 || str[1] != ':') {
+            return -1;
+        }
+        gap = 0;
+        str += 2;
+    }
+    while (str < end) {
+        const char *grp = str;
+        uint32_t v      = 0;
+        int nd          = 0;
+
+        for (int h = 0; str < end && nd < 5 && (h = lls_hexval(*str)) >= 0;
+             str++) {
+            v = (v << 4) | (uint32_t)h;
+            nd++;
+        }
+        if (!nd || nd > 4) {
+            return -1;
+        } else if (str < end && *str == '.') {
+            // embedded ipv4 address in the last 32 bits
+            if (n > 12 ||
+                lls_parse4inaddr(grp, (size_t)(end - grp),
+                                 (struct in_addr *)(buf + n)) != 0) {
+                return -1;
+            }
+            n += 4;
+            break;
+        } else if (n == 16) {
+            return -1;
+        }
+        buf[n++] = (uint8_t)(v >> 8);
+        buf[n++] = (uint8_t)v;
+        if (str == end) {
+            break;
+        } else if (*str++ != ':' || str == end) {
+            return -1;
+        } else if (*str == ':') {
+            if (gap != SIZE_MAX) {
+                // '::' can appear only once
+                return -1;
+            }
+            gap = n;
+            str++;
+        }
+    }
+
+    if (gap != SIZE_MAX) {
+        // '::' represents one or more groups of zeros
+        if (n == 16) {
+            return -1;
+        }
+        memmove(buf + 16 - (n - gap), buf + gap, n - gap);
+        memset(buf + gap, 0, 16 - n);
+    } else if (n != 16) {
+        return -1;
+    }
+    memcpy((void *)addr, buf, 16);
+
+    return 0;
+}
+
+/**
+ * @brief lls_parseaddr parse the IPv4 or IPv6 address literal into the
+ * socket address without allocating, instead of getaddrinfo with
+ * AI_NUMERICHOST.
+ * @param str address literal
+ * @param len length of the str
+ * @param family AF_INET, AF_INET6 or AF_UNSPEC to detect from the str
+ * @param port port number
+ * @param sockaddr parsed socket address
+ * @return socklen_t length of the socket address, or 0 if the str is not an
+ * address literal of the family.
+ */
+static inline socklen_t lls_parseaddr(const char *str, size_t len, int family,
+                                      uint16_t port,
+                                      struct sockaddr_storage *sockaddr)
+{
+    if (family == AF_UNSPEC) {
+        family = memchr(str, ':', len) ? AF_INET6 : AF_INET;
+    }
+
+    memset((void *)sockaddr, 0, sizeof(struct sockaddr_storage));
+    if (family == AF_INET) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)sockaddr;
+
+        if (lls_parse4inaddr(str, len, &sin->sin_addr) == 0) {
+#ifdef HAVE_SOCKADDR_SA_LEN
+            sin->sin_len = sizeof(struct sockaddr_in);
+#endif
+            sin->sin_family = AF_INET;
+            sin->sin_port   = htons(port);
+            return sizeof(struct sockaddr_in);
+        }
+    } else if (family == AF_INET6) {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)sockaddr;
+
+        if (lls_parse6inaddr(str, len, &sin6->sin6_addr,
+                             &sin6->sin6_scope_id) == 0) {
+#ifdef HAVE_SOCKADDR_SA_LEN
+            sin6->sin6_len = sizeof(struct sockaddr_in6);
+#endif
+            sin6->sin6_family = AF_INET6;
+            sin6->sin6_port   = htons(port);
+            return sizeof(struct sockaddr_in6);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief lls_getnumericaddr resolve the address literal by getaddrinfo with
+ * AI_NUMERICHOST. this accepts the forms that the strict parsers reject, e.g.
+ * '127.1' or '0x7f.0.0.1'.
+ * @param str address literal
+ * @param family AF_INET, AF_INET6 or AF_UNSPEC
+ * @param socktype socket type
+ * @param sockaddr resolved socket address
+ * @return int 0 on success, or the error code of getaddrinfo.
+ */
+static inline int lls_getnumericaddr(const char *str, int family, int socktype,
+                                     struct sockaddr_storage *sockaddr)
 {
-    const char *str       = lauxh_checkstring(L, idx);
     struct addrinfo *list = NULL;
     int rc =
         lls_getaddrinfo(&list, str, NULL, family, socktype, 0, AI_NUMERICHOST);
@@ -303,20 +1249,37 @@ static inline int lls_checksockaddr(lua_State *L, int idx, int family,
     return rc;
 }
 
+static inline int lls_checksockaddr(lua_State *L, int idx, int family,
+                                    int socktype,
+                                    struct sockaddr_storage *sockaddr)
+{
+    size_t len      = 0;
+    const char *str = lauxh_checklstring(L, idx, &len);
+
+    if (!lls_parseaddr(str, len, family, 0, sockaddr)) {
+        // fallback to getaddrinfo
+        return lls_getnumericaddr(str, family, socktype, sockaddr);
+    }
+    return 0;
+}
+
 static inline int lls_check4inaddr(lua_State *L, int idx, int socktype,
                                    struct in_addr *addr)
 {
-    const char *str       = lauxh_checkstring(L, idx);
-    struct addrinfo *list = NULL;
-    int rc =
-        lls_getaddrinfo(&list, str, NULL, AF_INET, socktype, 0, AI_NUMERICHOST);
+    size_t len      = 0;
+    const char *str = lauxh_checklstring(L, idx, &len);
 
-    if (rc == 0) {
-        *addr = ((struct sockaddr_in *)list->ai_addr)->sin_addr;
-        freeaddrinfo(list);
-    }
+    if (lls_parse4inaddr(str, len, addr) != 0) {
+        // fallback to getaddrinfo
+        struct sockaddr_storage sockaddr;
+        int rc = lls_getnumericaddr(str, AF_INET, socktype, &sockaddr);
 
-    return rc;
+        if (rc == 0) {
+            *addr = ((struct sockaddr_in *)&sockaddr)->sin_addr;
+        }
+        return rc;
+    }
+    return 0;
 }
 
 static inline int lls_opt4inaddr(lua_State *L, int idx, int socktype,
@@ -333,17 +1296,21 @@ static inline int lls_opt4inaddr(lua_State *L, int idx, int socktype,
 static inline int lls_check6inaddr(lua_State *L, int idx, int socktype,
                                    struct in6_addr *addr)
 {
-    const char *str       = lauxh_checkstring(L, idx);
-    struct addrinfo *list = NULL;
-    int rc = lls_getaddrinfo(&list, str, NULL, AF_INET6, socktype, 0,
-                             AI_NUMERICHOST);
+    size_t len      = 0;
+    const char *str = lauxh_checklstring(L, idx, &len);
+    uint32_t scope  = 0;
 
-    if (rc == 0) {
-        *addr = ((struct sockaddr_in6 *)list->ai_addr)->sin6_addr;
-        freeaddrinfo(list);
-    }
+    if (lls_parse6inaddr(str, len, addr, &scope) != 0) {
+        // fallback to getaddrinfo
+        struct sockaddr_storage sockaddr;
+        int rc = lls_getnumericaddr(str, AF_INET6, socktype, &sockaddr);
 
-    return rc;
+        if (rc == 0) {
+            *addr = ((struct sockaddr_in6 *)&sockaddr)->sin6_addr;
+        }
+        return rc;
+    }
+    return 0;
 }
 
 static inline int lls_opt6inaddr(lua_State *L, int idx, int socktype,
@@ -357,6 +1324,107 @@ static inline int lls_opt6inaddr(lua_State *L, int idx, int socktype,
     return lls_check6inaddr(L, idx, socktype, addr);
 }
 
+/**
+ * @brief lls_connectpeer create a datagram socket that is bound to the same
+ * local address as the socket and connected to the peer. the local port is
+ * shared by SO_REUSEADDR and SO_REUSEPORT, so the socket must enable these
+ * options before bind.
+ * the datagrams from the other peers that are received between bind and
+ * connect are left in the new socket, use lls_drainstrays to take them out.
+ * @param fd bound datagram socket
+ * @param protocol protocol of the socket
+ * @param peer peer address
+ * @param len length of the peer address
+ * @return int the close-on-exec descriptor that has the same O_NONBLOCK flag
+ * as fd, or -1 with errno. errno is EINVAL if fd is not bound yet.
+ */
+static inline int lls_connectpeer(int fd, int protocol,
+                                  const struct sockaddr *peer, socklen_t len)
+{
+    struct sockaddr_storage local = {0};
+    socklen_t llen                = sizeof(local);
+    int enable                    = 1;
+    int sfd                       = -1;
+    int fl                        = 0;
+    int err                       = 0;
+
+    if (getsockname(fd, (struct sockaddr *)&local, &llen) != 0) {
+        return -1;
+    } else if ((local.ss_family == AF_INET &&
+                !((struct sockaddr_in *)&local)->sin_port) ||
+               (local.ss_family == AF_INET6 &&
+                !((struct sockaddr_in6 *)&local)->sin6_port)) {
+        // not bound yet
+        errno = EINVAL;
+        return -1;
+    } else if ((fl = fcntl(fd, F_GETFL)) == -1 ||
+               (sfd = socket(local.ss_family, SOCK_DGRAM, protocol)) == -1) {
+        return -1;
+    } else if (fcntl(sfd, F_SETFD, FD_CLOEXEC) == -1 ||
+               fcntl(sfd, F_SETFL, fl & O_NONBLOCK) == -1 ||
+               setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, &enable,
+                          sizeof(enable)) != 0 ||
+#if defined(SO_REUSEPORT)
+               setsockopt(sfd, SOL_SOCKET, SO_REUSEPORT, &enable,
+                          sizeof(enable)) != 0 ||
+#endif
+               bind(sfd, (struct sockaddr *)&local, llen) != 0 ||
+               connect(sfd, peer, len) != 0) {
+        err = errno;
+        close(sfd);
+        errno = err;
+        return -1;
+    }
+
+    return sfd;
+}
+
+/**
+ * @brief lls_strayfn_t receive the datagram at the head of the socket that
+ * was sent by the other peer.
+ * @param arg argument of lls_drainstrays
+ * @param sfd socket created by lls_connectpeer
+ * @return ssize_t number of bytes received, or -1 if the datagram was not
+ * received.
+ */
+typedef ssize_t (*lls_strayfn_t)(void *arg, int sfd);
+
+/**
+ * @brief lls_drainstrays take out the datagrams from the other peers that
+ * were received by the socket created by lls_connectpeer before it was
+ * connected. the draining stops at the first datagram from the peer since it
+ * cannot be put back, so the datagrams queued behind it may still come from
+ * the other peers.
+ * @param sfd socket created by lls_connectpeer
+ * @param peer peer address
+ * @param len length of the peer address
+ * @param fn function to receive each datagram, or NULL to discard them.
+ * the datagram that fn did not receive is discarded.
+ * @param arg argument of fn
+ */
+static inline void lls_drainstrays(int sfd, const struct sockaddr *peer,
+                                   socklen_t len, lls_strayfn_t fn, void *arg)
+{
+    lls_peerkey_t pkey = {0};
+
+    lls_peerkey_init(&pkey, peer, len);
+    for (;;) {
+        struct sockaddr_storage src = {0};
+        socklen_t slen              = sizeof(src);
+        lls_peerkey_t skey          = {0};
+        char c                      = 0;
+
+        if (recvfrom(sfd, &c, 1, MSG_PEEK | MSG_DONTWAIT,
+                     (struct sockaddr *)&src, &slen) == -1 ||
+            (lls_peerkey_init(&skey, (struct sockaddr *)&src, slen) == 0 &&
+             memcmp(&skey, &pkey, sizeof(lls_peerkey_t)) == 0)) {
+            break;
+        } else if (!fn || fn(arg, sfd) == -1) {
+            recv(sfd, &c, 1, MSG_DONTWAIT);
+        }
+    }
+}
+
 // fd option
 static inline int lls_fcntl_lua(lua_State *L, int fd, int getfl, int setfl,
                                 int fl)
@@ -40,20 +40,17 @@ static int control_lua(lua_State *L)
 {
     lls_msghdr_t *msg = lauxh_checkudata(L, 1, MSGHDR_MT);
 
-    // push ref
-    lauxh_pushref(L, msg->control_ref);
+    // push current value
+    lls_getuservalue(L, 1, LLS_MSGHDR_UV_CONTROL);
 
     if (lua_gettop(L) > 1) {
         // check argument
         lls_cmsghdrs_t *cmsgs = lauxh_optudata(L, 2, CMSGHDRS_MT, NULL);
 
-        // release current ref
-        msg->control_ref = lauxh_unref(L, msg->control_ref);
-        msg->control     = NULL;
-        if (cmsgs) {
-            msg->control_ref = lauxh_refat(L, 2);
-            msg->control     = cmsgs;
-        }
+        // replace current value
+        lua_pushvalue(L, 2);
+        lls_setuservalue(L, 1, LLS_MSGHDR_UV_CONTROL);
+        msg->control = cmsgs;
     }
 
     return 1;
@@ -63,20 +60,25 @@ static int iov_lua(lua_State *L)
 {
     lls_msghdr_t *msg = lauxh_checkudata(L, 1, MSGHDR_MT);
 
-    // push ref
-    lauxh_pushref(L, msg->iov_ref);
+    // push current value
+    lls_getuservalue(L, 1, LLS_MSGHDR_UV_IOV);
 
     if (lua_gettop(L) > 1) {
         // check argument
-        lua_iovec_t *iov = lauxh_optudata(L, 2, IOVEC_MT, NULL);
-
-        // release current ref
-        msg->iov_ref = lauxh_unref(L, msg->iov_ref);
-        msg->name    = NULL;
-        if (iov) {
-            msg->iov_ref = lauxh_refat(L, 2);
-            msg->iov     = iov;
+        lua_iovec_t *iov  = NULL;
+        lls_buffer_t *buf = NULL;
+
+        if (lauxh_isuserdataof(L, 2, BUFFER_MT)) {
+            buf = lua_touserdata(L, 2);
+        } else {
+            iov = lauxh_optudata(L, 2, IOVEC_MT, NULL);
         }
+
+        // replace current value
+        lua_pushvalue(L, 2);
+        lls_setuservalue(L, 1, LLS_MSGHDR_UV_IOV);
+        msg->iov = iov;
+        msg->buf = buf;
     }
 
     return 1;
@@ -86,19 +88,16 @@ static int name_lua(lua_State *L)
 {
     lls_msghdr_t *msg = lauxh_checkudata(L, 1, MSGHDR_MT);
 
-    // push ref
-    lauxh_pushref(L, msg->name_ref);
+    // push current value
+    lls_getuservalue(L, 1, LLS_MSGHDR_UV_NAME);
 
     if (lua_gettop(L) > 1) {
         lls_addrinfo_t *info = lauxh_optudata(L, 2, ADDRINFO_MT, NULL);
 
-        // release current ref
-        msg->name_ref = lauxh_unref(L, msg->name_ref);
-        msg->name     = NULL;
-        if (info) {
-            msg->name_ref = lauxh_refat(L, 2);
-            msg->name     = &info->ai;
-        }
+        // replace current value
+        lua_pushvalue(L, 2);
+        lls_setuservalue(L, 1, LLS_MSGHDR_UV_NAME);
+        msg->name = info ? &info->ai : NULL;
     }
 
     return 1;
@@ -110,28 +109,16 @@ static int tostring_lua(lua_State *L)
     return 1;
 }
 
-static int gc_lua(lua_State *L)
-{
-    lls_msghdr_t *msg = lauxh_checkudata(L, 1, MSGHDR_MT);
-
-    lauxh_unref(L, msg->name_ref);
-    lauxh_unref(L, msg->iov_ref);
-    lauxh_unref(L, msg->control_ref);
-
-    return 0;
-}
-
 static int new_lua(lua_State *L)
 {
-    lls_msghdr_t *msg = lua_newuserdata(L, sizeof(lls_msghdr_t));
-
-    *msg = (lls_msghdr_t){.name_ref    = LUA_NOREF,
-                          .iov_ref     = LUA_NOREF,
-                          .control_ref = LUA_NOREF,
-                          .flags       = 0,
-                          .name        = NULL,
-                          .iov         = NULL,
-                          .control     = NULL};
+    lls_msghdr_t *msg =
+        lls_newuserdata(L, sizeof(lls_msghdr_t), LLS_MSGHDR_NUV);
+
+    *msg = (lls_msghdr_t){.flags   = 0,
+                          .name    = NULL,
+                          .iov     = NULL,
+                          .buf     = NULL,
+                          .control = NULL};
     lauxh_setmetatable(L, MSGHDR_MT);
 
     return 1;
@@ -142,7 +129,6 @@ LUALIB_API int luaopen_llsocket_msghdr(lua_State *L)
     // create metatable
     if (luaL_newmetatable(L, MSGHDR_MT)) {
         struct luaL_Reg mmethod[] = {
-            {"__gc",       gc_lua      },
             {"__tostring", tostring_lua},
             {NULL,         NULL        }
         };
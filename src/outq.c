@@ -0,0 +1,412 @@
+/**
+ *  Copyright (C) 2026 Masatoshi Fukunaga
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ *  outq.c
+ *  lua-llsocket
+ */
+
+#include "llsocket.h"
+
+#define DEFAULT_NITEM 16
+
+// user values of the queue
+#define UV_ITEMS  1
+#define UV_ONHIGH 2
+#define UV_ONLOW  3
+#define NUV       3
+
+typedef struct {
+    size_t len;
+    const char *data;
+} lls_outq_item_t;
+
+/**
+ * the items are stored in the ring buffer. the message of the item at the
+ * slot i is anchored at the index i + 1 of the UV_ITEMS table.
+ */
+typedef struct {
+    // slot of the first item
+    size_t head;
+    // number of items
+    size_t nused;
+    // number of allocated slots, power of 2
+    size_t nitem;
+    // number of bytes of the first item that already sent
+    size_t offset;
+    // number of bytes queued
+    size_t nbyte;
+    // watermarks
+    size_t hiwat;
+    size_t lowat;
+    int above;
+    lls_outq_item_t *items;
+} lls_outq_t;
+
+static inline void callwatermark(lua_State *L, int uv)
+{
+    lls_getuservalue(L, 1, uv);
+    if (lua_isfunction(L, -1)) {
+        lua_pushvalue(L, 1);
+        lua_call(L, 1, 0);
+        return;
+    }
+    lua_pop(L, 1);
+}
+
+// the queue must be at the stack index 1
+static inline void consume(lua_State *L, lls_outq_t *q, size_t len)
+{
+    size_t mask = q->nitem - 1;
+
+    q->nbyte -= len;
+    len += q->offset;
+    lls_getuservalue(L, 1, UV_ITEMS);
+    while (q->nused && len >= q->items[q->head].len) {
+        len -= q->items[q->head].len;
+        // release the message
+        lua_pushnil(L);
+        lua_rawseti(L, -2, (lua_Integer)q->head + 1);
+        q->head = (q->head + 1) & mask;
+        q->nused--;
+    }
+    lua_pop(L, 1);
+    q->offset = len;
+    if (!q->nused) {
+        q->head = 0;
+    }
+
+    // fell below the low watermark
+    if (q->above && q->nbyte <= q->lowat) {
+        q->above = 0;
+        callwatermark(L, UV_ONLOW);
+    }
+}
+
+static inline ssize_t flushq(lua_State *L, lls_outq_t *q, lls_socket_t *s,
+                             int flg)
+{
+    struct iovec iov[IOV_MAX];
+    struct msghdr msg = {.msg_name       = NULL,
+                         .msg_namelen    = 0,
+                         .msg_iov        = iov,
+                         .msg_iovlen     = 0,
+                         .msg_control    = NULL,
+                         .msg_controllen = 0,
+                         .msg_flags      = 0};
+    size_t mask       = q->nitem - 1;
+    ssize_t rv        = 0;
+
+    // coalesce the queued items into a single sendmsg call
+    for (size_t i = 0; i < q->nused && msg.msg_iovlen < IOV_MAX; i++) {
+        lls_outq_item_t *item = q->items + ((q->head + i) & mask);
+
+        iov[msg.msg_iovlen++] = (struct iovec){
+            .iov_base = (void *)item->data,
+            .iov_len  = item->len,
+        };
+    }
+    iov[0].iov_base = (char *)iov[0].iov_base + q->offset;
+    iov[0].iov_len -= q->offset;
+#if defined(MSG_MORE)
+    // the remaining items will be sent immediately after this call
+    if (q->nused > msg.msg_iovlen) {
+        flg |= MSG_MORE;
+    }
+#endif
+
+    rv = sendmsg(s->fd, &msg, flg);
+    if (rv > 0) {
+        lls_timer_touch(s, LLS_TOUCH_WRITE);
+        consume(L, q, (size_t)rv);
+    }
+    return rv;
+}
+
+static inline int flush_result(lua_State *L, lls_outq_t *q, ssize_t rv,
+                               size_t total)
+{
+    if (rv == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            // again
+            lua_pushinteger(L, total);
+            lua_pushnil(L);
+            lua_pushboolean(L, 1);
+            return 3;
+        }
+        // got error
+        // closed by peer: EPIPE || ECONNRESET
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "sendmsg");
+        return 2;
+    }
+
+    lua_pushinteger(L, total);
+    lua_pushnil(L);
+    lua_pushboolean(L, q->nbyte);
+    return 3;
+}
+
+static int sendall_lua(lua_State *L)
+{
+    lls_outq_t *q   = lauxh_checkudata(L, 1, OUTQ_MT);
+    lls_socket_t *s = lauxh_checkudata(L, 2, SOCKET_MT);
+    int flg         = lauxh_optflags(L, 3);
+    size_t total    = 0;
+    ssize_t rv      = 0;
+
+    lua_settop(L, 2);
+    while (q->nbyte) {
+        rv = flushq(L, q, s, flg);
+        if (rv > 0) {
+            total += (size_t)rv;
+        } else if (rv == -1 && errno == EINTR) {
+            continue;
+        } else {
+            break;
+        }
+    }
+
+    return flush_result(L, q, rv, total);
+}
+
+static int flush_lua(lua_State *L)
+{
+    lls_outq_t *q   = lauxh_checkudata(L, 1, OUTQ_MT);
+    lls_socket_t *s = lauxh_checkudata(L, 2, SOCKET_MT);
+    int flg         = lauxh_optflags(L, 3);
+    ssize_t rv      = 0;
+
+    lua_settop(L, 2);
+    if (!q->nbyte) {
+        lua_pushinteger(L, 0);
+        return 1;
+    }
+
+    rv = flushq(L, q, s, flg);
+    return flush_result(L, q, rv, (rv > 0) ? (size_t)rv : 0);
+}
+
+/**
+ * double the slots of the ring. the items that wrapped around to the front of
+ * the slots are moved after the last slot, with their messages.
+ */
+static int grow(lua_State *L, lls_outq_t *q)
+{
+    size_t nitem = q->nitem ? q->nitem * 2 : DEFAULT_NITEM;
+    size_t nwrap = 0;
+    void *items  = realloc(q->items, sizeof(lls_outq_item_t) * nitem);
+
+    if (!items) {
+        return -1;
+    }
+    q->items = items;
+    if (q->head + q->nused > q->nitem) {
+        nwrap = q->head + q->nused - q->nitem;
+        memcpy(q->items + q->nitem, q->items,
+               sizeof(lls_outq_item_t) * nwrap);
+        for (size_t i = 0; i < nwrap; i++) {
+            lua_rawgeti(L, -1, (lua_Integer)i + 1);
+            lua_rawseti(L, -2, (lua_Integer)(q->nitem + i) + 1);
+            lua_pushnil(L);
+            lua_rawseti(L, -2, (lua_Integer)i + 1);
+        }
+    }
+    q->nitem = nitem;
+    return 0;
+}
+
+static int push_lua(lua_State *L)
+{
+    lls_outq_t *q    = lauxh_checkudata(L, 1, OUTQ_MT);
+    size_t len       = 0;
+    const char *data = lls_checkbytes(L, 2, &len);
+
+    lua_settop(L, 2);
+    if (len) {
+        size_t slot = 0;
+
+        lls_getuservalue(L, 1, UV_ITEMS);
+        if (!lua_istable(L, -1)) {
+            lua_pop(L, 1);
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lls_setuservalue(L, 1, UV_ITEMS);
+        }
+        if (q->nused == q->nitem && grow(L, q) != 0) {
+            lua_pushnil(L);
+            lua_errno_new(L, errno, "realloc");
+            return 2;
+        }
+
+        // refer to the data without copying
+        slot                = (q->head + q->nused++) & (q->nitem - 1);
+        q->items[slot].len  = len;
+        q->items[slot].data = data;
+        q->nbyte += len;
+        lua_pushvalue(L, 2);
+        lua_rawseti(L, 3, (lua_Integer)slot + 1);
+        lua_settop(L, 2);
+
+        // exceeded the high watermark
+        if (q->hiwat && !q->above && q->nbyte >= q->hiwat) {
+            q->above = 1;
+            callwatermark(L, UV_ONHIGH);
+        }
+    }
+
+    lua_pushinteger(L, q->nbyte);
+    return 1;
+}
+
+static int clear_lua(lua_State *L)
+{
+    lls_outq_t *q = lauxh_checkudata(L, 1, OUTQ_MT);
+
+    lua_settop(L, 1);
+    if (q->nbyte) {
+        consume(L, q, q->nbyte);
+    }
+
+    return 0;
+}
+
+static int count_lua(lua_State *L)
+{
+    lls_outq_t *q = lauxh_checkudata(L, 1, OUTQ_MT);
+
+    lua_pushinteger(L, q->nused);
+
+    return 1;
+}
+
+static int len_lua(lua_State *L)
+{
+    lls_outq_t *q = lauxh_checkudata(L, 1, OUTQ_MT);
+
+    lua_pushinteger(L, q->nbyte);
+
+    return 1;
+}
+
+static int tostring_lua(lua_State *L)
+{
+    lua_pushfstring(L, OUTQ_MT ": %p", lua_touserdata(L, 1));
+    return 1;
+}
+
+static int gc_lua(lua_State *L)
+{
+    lls_outq_t *q = lauxh_checkudata(L, 1, OUTQ_MT);
+
+    // the messages are released with the user values
+    free(q->items);
+    q->items = NULL;
+
+    return 0;
+}
+
+static int new_lua(lua_State *L)
+{
+    lua_Integer hiwat = lauxh_optinteger(L, 1, 0);
+    lua_Integer lowat = lauxh_optinteger(L, 2, 0);
+    lls_outq_t *q     = NULL;
+
+    if (hiwat < 0) {
+        return luaL_argerror(L, 1, "hiwat must be greater than or equal to 0");
+    } else if (lowat < 0 || (hiwat && lowat >= hiwat)) {
+        return luaL_argerror(L, 2, "lowat must be less than hiwat");
+    } else if (!lua_isnoneornil(L, 3)) {
+        luaL_checktype(L, 3, LUA_TFUNCTION);
+    }
+    if (!lua_isnoneornil(L, 4)) {
+        luaL_checktype(L, 4, LUA_TFUNCTION);
+    }
+
+    lua_settop(L, 4);
+    q  = lls_newuserdata(L, sizeof(lls_outq_t), NUV);
+    *q = (lls_outq_t){
+        .head   = 0,
+        .nused  = 0,
+        .nitem  = 0,
+        .offset = 0,
+        .nbyte  = 0,
+        .hiwat  = (size_t)hiwat,
+        .lowat  = (size_t)lowat,
+        .above  = 0,
+        .items  = NULL,
+    };
+    lauxh_setmetatable(L, OUTQ_MT);
+    if (!lua_isnil(L, 3)) {
+        lua_pushvalue(L, 3);
+        lls_setuservalue(L, -2, UV_ONHIGH);
+    }
+    if (!lua_isnil(L, 4)) {
+        lua_pushvalue(L, 4);
+        lls_setuservalue(L, -2, UV_ONLOW);
+    }
+
+    return 1;
+}
+
+LUALIB_API int luaopen_llsocket_outq(lua_State *L)
+{
+    // create metatable
+    if (luaL_newmetatable(L, OUTQ_MT)) {
+        struct luaL_Reg mmethod[] = {
+            {"__gc",       gc_lua      },
+            {"__tostring", tostring_lua},
+            {"__len",      len_lua     },
+            {NULL,         NULL        }
+        };
+        struct luaL_Reg method[] = {
+            {"len",     len_lua    },
+            {"count",   count_lua  },
+            {"clear",   clear_lua  },
+            {"push",    push_lua   },
+            {"flush",   flush_lua  },
+            {"sendall", sendall_lua},
+            {NULL,      NULL       }
+        };
+        struct luaL_Reg *ptr = mmethod;
+
+        // metamethods
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        // methods
+        lua_pushstring(L, "__index");
+        lua_newtable(L);
+        ptr = method;
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        lua_rawset(L, -3);
+    }
+    lua_pop(L, 1);
+
+    // create module table
+    lua_newtable(L);
+    lauxh_pushfn2tbl(L, "new", new_lua);
+
+    return 1;
+}
@@ -0,0 +1,420 @@
+/**
+ *  Copyright (C) 2026 Masatoshi Fukunaga
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ *  peermap.c
+ *  lua-llsocket
+ */
+
+#include "llsocket.h"
+
+#define DEFAULT_NSLOT 16
+
+// user values of lls_peermap_t
+#define UV_VALUES 1
+#define UV_SLOTS  2
+
+// hash values of the empty and deleted slots
+#define SLOT_EMPTY   0
+#define SLOT_DELETED 1
+
+typedef struct {
+    uint32_t hash;
+    lls_peerkey_t key;
+} lls_peerslot_t;
+
+typedef struct {
+    // number of entries
+    size_t len;
+    // number of deleted slots
+    size_t ndel;
+    // number of slots, power of 2
+    size_t nslot;
+    uint32_t seed;
+    // slots are held by the user value, and the values of the entries are
+    // held by the table of the user value at the same index of the slot
+    lls_peerslot_t *slots;
+} lls_peermap_t;
+
+static inline uint32_t hashkey(lls_peermap_t *m, const lls_peerkey_t *key)
+{
+    uint32_t h = lls_hash(key, sizeof(lls_peerkey_t), m->seed);
+
+    // 0 and 1 are reserved for the empty and deleted slots
+    return (h > SLOT_DELETED) ? h : h + 2;
+}
+
+/**
+ * return the index of the slot that has the key, or the index of the slot
+ * that the key can be inserted.
+ */
+static inline size_t lookup(lls_peermap_t *m, const lls_peerkey_t *key,
+                            uint32_t h, int *found)
+{
+    size_t mask = m->nslot - 1;
+    size_t i    = h & mask;
+    size_t ins  = SIZE_MAX;
+
+    *found = 0;
+    // linear probing, there is always an empty slot
+    for (;;) {
+        lls_peerslot_t *slot = m->slots + i;
+
+        if (slot->hash == SLOT_EMPTY) {
+            return (ins != SIZE_MAX) ? ins : i;
+        } else if (slot->hash == SLOT_DELETED) {
+            if (ins == SIZE_MAX) {
+                ins = i;
+            }
+        } else if (slot->hash == h &&
+                   memcmp(&slot->key, key, sizeof(lls_peerkey_t)) == 0) {
+            *found = 1;
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+static inline size_t slotsize(size_t len)
+{
+    size_t nslot = DEFAULT_NSLOT;
+
+    // keep the load factor below 0.5 after resizing
+    while (nslot < len * 2) {
+        nslot <<= 1;
+    }
+    return nslot;
+}
+
+static void rehash(lua_State *L, lls_peermap_t *m, int idx, size_t nslot)
+{
+    lls_peerslot_t *old = m->slots;
+    size_t n            = m->nslot;
+    int found           = 0;
+
+    // old values table
+    lls_getuservalue(L, idx, UV_VALUES);
+    m->slots = lua_newuserdata(L, sizeof(lls_peerslot_t) * nslot);
+    memset(m->slots, 0, sizeof(lls_peerslot_t) * nslot);
+    m->nslot = nslot;
+    m->ndel  = 0;
+    lua_createtable(L, (int)nslot, 0);
+    for (size_t i = 0; i < n; i++) {
+        if (old[i].hash > SLOT_DELETED) {
+            size_t j    = lookup(m, &old[i].key, old[i].hash, &found);
+            m->slots[j] = old[i];
+            lua_rawgeti(L, -3, (lua_Integer)i + 1);
+            lua_rawseti(L, -2, (lua_Integer)j + 1);
+        }
+    }
+    lls_setuservalue(L, idx, UV_VALUES);
+    lls_setuservalue(L, idx, UV_SLOTS);
+    lua_pop(L, 1);
+}
+
+static void checkkey(lua_State *L, int idx, lls_peerkey_t *key)
+{
+    struct sockaddr_storage addr;
+    const struct sockaddr *sa = (const struct sockaddr *)&addr;
+    socklen_t len             = 0;
+
+    if (lua_type(L, idx) == LUA_TSTRING) {
+        // result of addrinfo:pack() or the 'packed' address of socket
+        size_t slen     = 0;
+        const char *str = lua_tolstring(L, idx, &slen);
+
+        if (lls_addr_unpack((const uint8_t *)str, slen, &addr, &len) != slen) {
+            len = 0;
+        }
+    } else {
+        lls_addrinfo_t *info = lauxh_checkudata(L, idx, ADDRINFO_MT);
+
+        sa  = info->ai.ai_addr;
+        len = info->ai.ai_addrlen;
+    }
+
+    if (!len || lls_peerkey_init(key, sa, len) != 0) {
+        luaL_argerror(L, idx,
+                      "key must be the packed address or llsocket.addrinfo "
+                      "of AF_INET or AF_INET6");
+    }
+}
+
+static void pushkey(lua_State *L, const lls_peerkey_t *key)
+{
+    struct sockaddr_storage addr = {0};
+    struct addrinfo ai           = {.ai_flags     = 0,
+                                    .ai_family    = key->family,
+                                    .ai_socktype  = 0,
+                                    .ai_protocol  = 0,
+                                    .ai_addrlen   = 0,
+                                    .ai_addr      = (struct sockaddr *)&addr,
+                                    .ai_canonname = NULL,
+                                    .ai_next      = NULL};
+
+    if (key->family == AF_INET) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)&addr;
+
+        sin->sin_family = AF_INET;
+        sin->sin_port   = key->port;
+        memcpy(&sin->sin_addr, key->addr, 4);
+        ai.ai_addrlen = sizeof(struct sockaddr_in);
+#ifdef HAVE_SOCKADDR_SA_LEN
+        sin->sin_len = sizeof(struct sockaddr_in);
+#endif
+    } else {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&addr;
+
+        sin6->sin6_family   = AF_INET6;
+        sin6->sin6_port     = key->port;
+        sin6->sin6_scope_id = key->scope;
+        memcpy(&sin6->sin6_addr, key->addr, 16);
+        ai.ai_addrlen = sizeof(struct sockaddr_in6);
+#ifdef HAVE_SOCKADDR_SA_LEN
+        sin6->sin6_len = sizeof(struct sockaddr_in6);
+#endif
+    }
+    lls_addrinfo_alloc(L, &ai);
+}
+
+static inline void pushvalue(lua_State *L, int idx, size_t i)
+{
+    lls_getuservalue(L, idx, UV_VALUES);
+    lua_rawgeti(L, -1, (lua_Integer)i + 1);
+    lua_replace(L, -2);
+}
+
+int lls_peermap_get(lua_State *L, int idx, const struct sockaddr *sa,
+                    socklen_t len)
+{
+    lls_peermap_t *m = lua_touserdata(L, idx);
+    lls_peerkey_t key;
+    int found = 0;
+
+    if (lls_peerkey_init(&key, sa, len) == 0) {
+        size_t i = lookup(m, &key, hashkey(m, &key), &found);
+
+        if (found) {
+            pushvalue(L, idx, i);
+            return 1;
+        }
+    }
+    lua_pushnil(L);
+    return 0;
+}
+
+static int iter_lua(lua_State *L)
+{
+    lls_peermap_t *m = lua_touserdata(L, lua_upvalueindex(1));
+    size_t i         = (size_t)lua_tointeger(L, lua_upvalueindex(2));
+
+    for (; i < m->nslot; i++) {
+        if (m->slots[i].hash > SLOT_DELETED) {
+            // save the next position
+            lua_pushinteger(L, (lua_Integer)i + 1);
+            lua_replace(L, lua_upvalueindex(2));
+            pushkey(L, &m->slots[i].key);
+            pushvalue(L, lua_upvalueindex(1), i);
+            return 2;
+        }
+    }
+    lua_pushinteger(L, (lua_Integer)i);
+    lua_replace(L, lua_upvalueindex(2));
+
+    return 0;
+}
+
+static int pairs_lua(lua_State *L)
+{
+    lauxh_checkudata(L, 1, PEERMAP_MT);
+
+    lua_settop(L, 1);
+    lua_pushinteger(L, 0);
+    lua_pushcclosure(L, iter_lua, 2);
+
+    return 1;
+}
+
+static int delete_lua(lua_State *L)
+{
+    lls_peermap_t *m = lauxh_checkudata(L, 1, PEERMAP_MT);
+    lls_peerkey_t key;
+    int found = 0;
+    size_t i  = 0;
+
+    checkkey(L, 2, &key);
+    i = lookup(m, &key, hashkey(m, &key), &found);
+    if (!found) {
+        return 0;
+    }
+
+    // push the deleted value
+    lls_getuservalue(L, 1, UV_VALUES);
+    lua_rawgeti(L, -1, (lua_Integer)i + 1);
+    lua_pushnil(L);
+    lua_rawseti(L, -3, (lua_Integer)i + 1);
+    // the deleted slot is left as a tombstone until the next rehash, so that
+    // the entries can be deleted during the traversal
+    m->slots[i].hash = SLOT_DELETED;
+    m->len--;
+    m->ndel++;
+
+    return 1;
+}
+
+static int set_lua(lua_State *L)
+{
+    lls_peermap_t *m = lauxh_checkudata(L, 1, PEERMAP_MT);
+    lls_peerkey_t key;
+    uint32_t h = 0;
+    int found  = 0;
+    size_t i   = 0;
+
+    checkkey(L, 2, &key);
+    luaL_checkany(L, 3);
+    lua_settop(L, 3);
+    if (lua_isnil(L, 3)) {
+        delete_lua(L);
+        return 0;
+    }
+
+    h = hashkey(m, &key);
+    i = lookup(m, &key, h, &found);
+    if (!found) {
+        // keep the load factor below 0.75
+        if ((m->len + m->ndel + 1) * 4 > m->nslot * 3) {
+            rehash(L, m, 1, slotsize(m->len + 1));
+            i = lookup(m, &key, h, &found);
+        }
+        if (m->slots[i].hash == SLOT_DELETED) {
+            m->ndel--;
+        }
+        m->slots[i] = (lls_peerslot_t){
+            .hash = h,
+            .key  = key,
+        };
+        m->len++;
+    }
+    lls_getuservalue(L, 1, UV_VALUES);
+    lua_pushvalue(L, 3);
+    lua_rawseti(L, -2, (lua_Integer)i + 1);
+
+    return 0;
+}
+
+static int get_lua(lua_State *L)
+{
+    lls_peermap_t *m = lauxh_checkudata(L, 1, PEERMAP_MT);
+    lls_peerkey_t key;
+    int found = 0;
+    size_t i  = 0;
+
+    checkkey(L, 2, &key);
+    i = lookup(m, &key, hashkey(m, &key), &found);
+    if (!found) {
+        lua_pushnil(L);
+        return 1;
+    }
+    pushvalue(L, 1, i);
+
+    return 1;
+}
+
+static int len_lua(lua_State *L)
+{
+    lls_peermap_t *m = lauxh_checkudata(L, 1, PEERMAP_MT);
+
+    lua_pushinteger(L, m->len);
+
+    return 1;
+}
+
+static int tostring_lua(lua_State *L)
+{
+    lua_pushfstring(L, PEERMAP_MT ": %p", lua_touserdata(L, 1));
+    return 1;
+}
+
+static int new_lua(lua_State *L)
+{
+    size_t nslot     = slotsize((size_t)lauxh_optuint32(L, 1, 0));
+    lls_peermap_t *m = NULL;
+
+    lua_settop(L, 0);
+    m  = lls_newuserdata(L, sizeof(lls_peermap_t), 2);
+    *m = (lls_peermap_t){
+        .len   = 0,
+        .ndel  = 0,
+        .nslot = nslot,
+        .seed  = (uint32_t)(uintptr_t)m ^ (uint32_t)time(NULL),
+        .slots = lua_newuserdata(L, sizeof(lls_peerslot_t) * nslot),
+    };
+    memset(m->slots, 0, sizeof(lls_peerslot_t) * nslot);
+    lls_setuservalue(L, 1, UV_SLOTS);
+    lua_createtable(L, (int)nslot, 0);
+    lls_setuservalue(L, 1, UV_VALUES);
+    lauxh_setmetatable(L, PEERMAP_MT);
+
+    return 1;
+}
+
+LUALIB_API int luaopen_llsocket_peermap(lua_State *L)
+{
+    // create metatable
+    if (luaL_newmetatable(L, PEERMAP_MT)) {
+        struct luaL_Reg mmethod[] = {
+            {"__tostring", tostring_lua},
+            {"__len",      len_lua     },
+            {"__pairs",    pairs_lua   },
+            {NULL,         NULL        }
+        };
+        struct luaL_Reg method[] = {
+            {"len",    len_lua   },
+            {"get",    get_lua   },
+            {"set",    set_lua   },
+            {"delete", delete_lua},
+            {"pairs",  pairs_lua },
+            {NULL,     NULL      }
+        };
+        struct luaL_Reg *ptr = mmethod;
+
+        // metamethods
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        // methods
+        lua_pushstring(L, "__index");
+        lua_newtable(L);
+        ptr = method;
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        lua_rawset(L, -3);
+    }
+    lua_pop(L, 1);
+
+    // create module table
+    lua_newtable(L);
+    lauxh_pushfn2tbl(L, "new", new_lua);
+
+    return 1;
+}
@@ -0,0 +1,463 @@
+/**
+ *  Copyright (C) 2026 Masatoshi Fukunaga
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ *  pool.c
+ *  lua-llsocket
+ */
+
+#include "llsocket.h"
+#include <poll.h>
+
+#define DEFAULT_MAXIDLE    64
+#define DEFAULT_MAXPERHOST 8
+#define DEFAULT_TTL        60
+#define MAX_MAXIDLE        65536
+
+// user values of lls_pool_t
+#define UV_SOCKETS 1
+#define NUV        1
+
+// end of the list
+#define NIL -1
+
+typedef struct {
+    lls_peerkey_t key;
+    uint32_t hash;
+    lls_socket_t *s;
+    uint64_t idle_at;
+    // chain of the bucket, the most recently checked in first
+    int next;
+    // list of the idle sockets, the least recently checked in first
+    int lprev;
+    int lnext;
+} lls_poolslot_t;
+
+typedef struct {
+    // number of idle sockets
+    int len;
+    int maxidle;
+    int maxperhost;
+    // idle ttl in milliseconds, 0 means no limit
+    uint64_t ttl;
+    uint32_t seed;
+    // number of buckets, power of 2
+    uint32_t nbucket;
+    // free slots
+    int free;
+    int lru_head;
+    int lru_tail;
+    // slots and buckets are allocated with the pool
+    lls_poolslot_t *slots;
+    int *buckets;
+} lls_pool_t;
+
+static inline uint64_t getmsec(void)
+{
+    struct timespec ts = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void checkdest(lua_State *L, int idx, lls_peerkey_t *key)
+{
+    struct sockaddr_storage addr;
+    const struct sockaddr *sa = (const struct sockaddr *)&addr;
+    socklen_t len             = 0;
+
+    if (lua_type(L, idx) == LUA_TSTRING) {
+        // result of addrinfo:pack() or the 'packed' address of socket
+        size_t slen     = 0;
+        const char *str = lua_tolstring(L, idx, &slen);
+
+        if (lls_addr_unpack((const uint8_t *)str, slen, &addr, &len) != slen) {
+            len = 0;
+        }
+    } else {
+        lls_addrinfo_t *info = lauxh_checkudata(L, idx, ADDRINFO_MT);
+
+        sa  = info->ai.ai_addr;
+        len = info->ai.ai_addrlen;
+    }
+
+    if (!len || lls_peerkey_init(key, sa, len) != 0) {
+        luaL_argerror(L, idx,
+                      "dest must be the packed address or llsocket.addrinfo "
+                      "of AF_INET or AF_INET6");
+    }
+}
+
+/**
+ * remove the slot from the pool, and push the socket held by the slot.
+ */
+static void unlink_slot(lua_State *L, lls_pool_t *p, int i, int *prev)
+{
+    lls_poolslot_t *slot = p->slots + i;
+
+    // bucket
+    *prev = slot->next;
+    // idle list
+    if (slot->lprev == NIL) {
+        p->lru_head = slot->lnext;
+    } else {
+        p->slots[slot->lprev].lnext = slot->lnext;
+    }
+    if (slot->lnext == NIL) {
+        p->lru_tail = slot->lprev;
+    } else {
+        p->slots[slot->lnext].lprev = slot->lprev;
+    }
+
+    // release the reference of the socket
+    lls_getuservalue(L, 1, UV_SOCKETS);
+    lua_rawgeti(L, -1, i + 1);
+    lua_pushnil(L);
+    lua_rawseti(L, -3, i + 1);
+    lua_replace(L, -2);
+
+    slot->s    = NULL;
+    slot->next = p->free;
+    p->free    = i;
+    p->len--;
+}
+
+/**
+ * find the pointer that points to the slot in the bucket chain.
+ */
+static int *findprev(lls_pool_t *p, int i)
+{
+    int *prev = p->buckets + (p->slots[i].hash & (p->nbucket - 1));
+
+    while (*prev != i) {
+        prev = &p->slots[*prev].next;
+    }
+    return prev;
+}
+
+/**
+ * close the socket on the top of the stack by its close method.
+ */
+static inline void closetop(lua_State *L)
+{
+    lua_getfield(L, -1, "close");
+    lua_insert(L, -2);
+    lua_call(L, 1, 0);
+}
+
+static inline void evict(lua_State *L, lls_pool_t *p, int i)
+{
+    unlink_slot(L, p, i, findprev(p, i));
+    closetop(L);
+}
+
+/**
+ * check whether the idle connection is still usable. the connection that
+ * is closed by the peer or has the unread data is not reusable.
+ */
+static int isalive(lls_socket_t *s)
+{
+    struct pollfd pfd = {
+        .fd     = s->fd,
+        .events = POLLIN
+#if defined(POLLRDHUP)
+                  | POLLRDHUP
+#endif
+        ,
+        .revents = 0,
+    };
+    char c = 0;
+
+    if (s->fd == -1) {
+        return 0;
+    }
+    switch (poll(&pfd, 1, 0)) {
+    case 0:
+        return 1;
+    case -1:
+        return errno == EINTR;
+    }
+
+#if defined(POLLRDHUP)
+    if (pfd.revents & (POLLRDHUP | POLLHUP | POLLERR | POLLNVAL)) {
+        return 0;
+    }
+#else
+    if (pfd.revents & (POLLHUP | POLLERR | POLLNVAL)) {
+        return 0;
+    }
+#endif
+    // 0 on eof, 1 on the unexpected data
+    return recv(s->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == -1 &&
+           (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+static int checkout_lua(lua_State *L)
+{
+    lls_pool_t *p     = lauxh_checkudata(L, 1, POOL_MT);
+    lls_peerkey_t key = {0};
+    uint64_t now      = 0;
+    uint32_t h        = 0;
+    int *prev         = NULL;
+
+    checkdest(L, 2, &key);
+    lua_settop(L, 1);
+    now  = getmsec();
+    h    = lls_hash(&key, sizeof(key), p->seed);
+    prev = p->buckets + (h & (p->nbucket - 1));
+    while (*prev != NIL) {
+        int i                = *prev;
+        lls_poolslot_t *slot = p->slots + i;
+
+        if (slot->hash != h || memcmp(&slot->key, &key, sizeof(key)) != 0) {
+            prev = &slot->next;
+            continue;
+        }
+        // the most recently checked in socket first
+        unlink_slot(L, p, i, prev);
+        if ((!p->ttl || now - slot->idle_at < p->ttl) &&
+            isalive(lua_touserdata(L, -1))) {
+            return 1;
+        }
+        closetop(L);
+    }
+
+    return 0;
+}
+
+static int checkin_lua(lua_State *L)
+{
+    lls_pool_t *p              = lauxh_checkudata(L, 1, POOL_MT);
+    lls_socket_t *s            = lauxh_checkudata(L, 2, SOCKET_MT);
+    lls_peerkey_t key          = {0};
+    struct sockaddr_storage ss = {0};
+    socklen_t len              = sizeof(ss);
+    uint32_t h                 = 0;
+    int *head                  = NULL;
+    int oldest                 = NIL;
+    int nhost                  = 0;
+    int i                      = 0;
+    lls_poolslot_t *slot       = NULL;
+
+    if (!lua_isnoneornil(L, 3)) {
+        checkdest(L, 3, &key);
+    } else if (s->fd != -1 &&
+               (getpeername(s->fd, (struct sockaddr *)&ss, &len) != 0 ||
+                lls_peerkey_init(&key, (struct sockaddr *)&ss, len) != 0)) {
+        // not connected
+        s = NULL;
+    }
+    lua_settop(L, 2);
+    if (!s || s->fd == -1) {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+
+    h    = lls_hash(&key, sizeof(key), p->seed);
+    head = p->buckets + (h & (p->nbucket - 1));
+    // count the idle sockets of the destination
+    for (i = *head; i != NIL; i = p->slots[i].next) {
+        if (p->slots[i].s == s) {
+            // already checked in
+            lua_pushboolean(L, 1);
+            return 1;
+        } else if (p->slots[i].hash == h &&
+            memcmp(&p->slots[i].key, &key, sizeof(key)) == 0) {
+            nhost++;
+            oldest = i;
+        }
+    }
+    if (nhost >= p->maxperhost) {
+        // replace the least recently checked in socket of the destination
+        evict(L, p, oldest);
+    } else if (p->len >= p->maxidle) {
+        // replace the least recently checked in socket
+        evict(L, p, p->lru_head);
+    }
+
+    // push to the head of the bucket and the tail of the idle list
+    i       = p->free;
+    slot    = p->slots + i;
+    p->free = slot->next;
+    *slot   = (lls_poolslot_t){
+        .key     = key,
+        .hash    = h,
+        .s       = s,
+        .idle_at = getmsec(),
+        .next    = *head,
+        .lprev   = p->lru_tail,
+        .lnext   = NIL,
+    };
+    *head = i;
+    if (p->lru_tail == NIL) {
+        p->lru_head = i;
+    } else {
+        p->slots[p->lru_tail].lnext = i;
+    }
+    p->lru_tail = i;
+    p->len++;
+
+    lls_getuservalue(L, 1, UV_SOCKETS);
+    lua_pushvalue(L, 2);
+    lua_rawseti(L, -2, i + 1);
+    lua_pushboolean(L, 1);
+
+    return 1;
+}
+
+static int prune_lua(lua_State *L)
+{
+    lls_pool_t *p = lauxh_checkudata(L, 1, POOL_MT);
+    uint64_t now  = getmsec();
+    int n         = 0;
+
+    lua_settop(L, 1);
+    // the idle list is ordered by the idle time
+    while (p->lru_head != NIL && p->ttl &&
+           now - p->slots[p->lru_head].idle_at >= p->ttl) {
+        evict(L, p, p->lru_head);
+        n++;
+    }
+
+    lua_pushinteger(L, n);
+    return 1;
+}
+
+static int close_lua(lua_State *L)
+{
+    lls_pool_t *p = lauxh_checkudata(L, 1, POOL_MT);
+
+    lua_settop(L, 1);
+    while (p->lru_head != NIL) {
+        evict(L, p, p->lru_head);
+    }
+
+    return 0;
+}
+
+static int len_lua(lua_State *L)
+{
+    lls_pool_t *p = lauxh_checkudata(L, 1, POOL_MT);
+
+    lua_pushinteger(L, p->len);
+
+    return 1;
+}
+
+static int tostring_lua(lua_State *L)
+{
+    lua_pushfstring(L, POOL_MT ": %p", lua_touserdata(L, 1));
+    return 1;
+}
+
+static int new_lua(lua_State *L)
+{
+    lua_Integer maxidle    = lauxh_optinteger(L, 1, DEFAULT_MAXIDLE);
+    lua_Integer maxperhost = lauxh_optinteger(L, 2, DEFAULT_MAXPERHOST);
+    lua_Number ttl         = luaL_optnumber(L, 3, DEFAULT_TTL);
+    uint32_t nbucket       = 1;
+    size_t size            = 0;
+    lls_pool_t *p          = NULL;
+
+    if (maxidle < 1 || maxidle > MAX_MAXIDLE) {
+        return luaL_argerror(L, 1, "maxidle must be between 1 and 65536");
+    } else if (maxperhost < 1) {
+        return luaL_argerror(L, 2, "maxperhost must be greater than 0");
+    } else if (ttl < 0) {
+        return luaL_argerror(L, 3, "ttl must be greater than or equal to 0");
+    }
+    while (nbucket < (uint32_t)maxidle) {
+        nbucket <<= 1;
+    }
+
+    lua_settop(L, 0);
+    size = sizeof(lls_pool_t) + sizeof(lls_poolslot_t) * (size_t)maxidle +
+           sizeof(int) * nbucket;
+    p    = lls_newuserdata(L, size, NUV);
+    *p   = (lls_pool_t){
+        .len        = 0,
+        .maxidle    = (int)maxidle,
+        .maxperhost = (int)maxperhost,
+        .ttl        = (uint64_t)(ttl * 1000),
+        .seed       = (uint32_t)(uintptr_t)p ^ (uint32_t)time(NULL),
+        .nbucket    = nbucket,
+        .free       = 0,
+        .lru_head   = NIL,
+        .lru_tail   = NIL,
+        .slots      = (lls_poolslot_t *)(p + 1),
+        .buckets    = NULL,
+    };
+    p->buckets = (int *)(p->slots + maxidle);
+    for (int i = 0; i < (int)maxidle; i++) {
+        p->slots[i].next = (i + 1 < maxidle) ? i + 1 : NIL;
+    }
+    for (uint32_t i = 0; i < nbucket; i++) {
+        p->buckets[i] = NIL;
+    }
+    // the sockets are held by the array part of the table
+    lua_createtable(L, (int)maxidle, 0);
+    lls_setuservalue(L, -2, UV_SOCKETS);
+    lauxh_setmetatable(L, POOL_MT);
+
+    return 1;
+}
+
+LUALIB_API int luaopen_llsocket_pool(lua_State *L)
+{
+    // create metatable
+    if (luaL_newmetatable(L, POOL_MT)) {
+        struct luaL_Reg mmethod[] = {
+            {"__tostring", tostring_lua},
+            {"__len",      len_lua     },
+            {NULL,         NULL        }
+        };
+        struct luaL_Reg method[] = {
+            {"len",      len_lua     },
+            {"checkout", checkout_lua},
+            {"checkin",  checkin_lua },
+            {"prune",    prune_lua   },
+            {"close",    close_lua   },
+            {NULL,       NULL        }
+        };
+        struct luaL_Reg *ptr = mmethod;
+
+        // metamethods
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        // methods
+        lua_pushstring(L, "__index");
+        lua_newtable(L);
+        ptr = method;
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        lua_rawset(L, -3);
+    }
+    lua_pop(L, 1);
+
+    // create module table
+    lua_newtable(L);
+    lauxh_pushfn2tbl(L, "new", new_lua);
+
+    return 1;
+}
@@ -0,0 +1,726 @@
+/**
+ *  Copyright (C) 2026 Masatoshi Fukunaga
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ *  resolver.c
+ *  lua-llsocket
+ */
+
+#include "llsocket.h"
+#include <dlfcn.h>
+#include <pthread.h>
+#if defined(__linux__)
+# include <sys/eventfd.h>
+#endif
+
+#define DEFAULT_NTHREAD 4
+#define MAX_NTHREAD     64
+
+#define JOB_GETADDRINFO 0
+#define JOB_GETNAMEINFO 1
+
+#define JOB_PENDING 0
+#define JOB_RUNNING 1
+#define JOB_DONE    2
+
+// user values of the resolver
+#define UV_PENDING 1
+#define NUV        1
+
+// user values of the request
+#define REQ_UV_RESOLVER 1
+#define REQ_UV_RESULT   2
+#define REQ_UV_ERROR    3
+#define REQ_NUV         3
+
+typedef struct lls_resolver_job_st {
+    struct lls_resolver_job_st *next;
+    int type;
+    int state;
+    // getaddrinfo
+    const char *node;
+    const char *service;
+    struct addrinfo hints;
+    struct addrinfo *list;
+    // getnameinfo
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    int flags;
+    char host[NI_MAXHOST];
+    char serv[NI_MAXSERV];
+    // result
+    int rc;
+    int err;
+    char buf[];
+} lls_resolver_job_t;
+
+typedef struct {
+    struct lls_resolver_pool_st *pool;
+    pthread_t th;
+    // the worker is running a job
+    int busy;
+} lls_resolver_worker_t;
+
+/**
+ * the pool is shared with the worker threads. it is released by the last one
+ * of the owner and the workers, so that the owner never waits for the
+ * running lookups on close.
+ */
+typedef struct lls_resolver_pool_st {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    // queued jobs
+    lls_resolver_job_t *head;
+    lls_resolver_job_t *tail;
+    // completed jobs
+    lls_resolver_job_t *done;
+    int closed;
+    int refs;
+    // completion notification
+    int rfd;
+    int wfd;
+    // worker threads
+    int nworker;
+    lls_resolver_worker_t workers[];
+} lls_resolver_pool_t;
+
+typedef struct {
+    lls_resolver_pool_t *pool;
+} lls_resolver_t;
+
+typedef struct {
+    // NULL if the request is completed or cancelled
+    lls_resolver_job_t *job;
+    // the job is owned by the pool
+    int queued;
+} lls_resreq_t;
+
+static inline void freejobs(lls_resolver_job_t *job)
+{
+    while (job) {
+        lls_resolver_job_t *next = job->next;
+
+        if (job->list) {
+            freeaddrinfo(job->list);
+        }
+        free(job);
+        job = next;
+    }
+}
+
+// must be called with the mutex locked
+static void release(lls_resolver_pool_t *p)
+{
+    int last = 0;
+
+    last = --p->refs == 0;
+    pthread_mutex_unlock(&p->mutex);
+    if (last) {
+        freejobs(p->head);
+        freejobs(p->done);
+        pthread_cond_destroy(&p->cond);
+        pthread_mutex_destroy(&p->mutex);
+        free(p);
+    }
+}
+
+static inline void notify(lls_resolver_pool_t *p)
+{
+#if defined(__linux__)
+    uint64_t v = 1;
+    ssize_t rv = write(p->wfd, &v, sizeof(v));
+#else
+    char v     = 1;
+    ssize_t rv = write(p->wfd, &v, sizeof(v));
+#endif
+
+    // EAGAIN: the descriptor is already readable
+    (void)rv;
+}
+
+static void *worker(void *arg)
+{
+    lls_resolver_worker_t *w = (lls_resolver_worker_t *)arg;
+    lls_resolver_pool_t *p   = w->pool;
+
+    pthread_mutex_lock(&p->mutex);
+    for (;;) {
+        lls_resolver_job_t *job = NULL;
+
+        while (!p->closed && !p->head) {
+            pthread_cond_wait(&p->cond, &p->mutex);
+        }
+        if (p->closed) {
+            break;
+        }
+        job     = p->head;
+        p->head = job->next;
+        if (!p->head) {
+            p->tail = NULL;
+        }
+        job->state = JOB_RUNNING;
+        w->busy    = 1;
+        pthread_mutex_unlock(&p->mutex);
+
+        if (job->type == JOB_GETADDRINFO) {
+            job->rc = getaddrinfo(job->node, job->service, &job->hints,
+                                  &job->list);
+        } else {
+            job->rc = getnameinfo((struct sockaddr *)&job->addr, job->addrlen,
+                                  job->host, NI_MAXHOST, job->serv,
+                                  NI_MAXSERV, job->flags);
+        }
+        job->err = errno;
+
+        pthread_mutex_lock(&p->mutex);
+        w->busy    = 0;
+        job->state = JOB_DONE;
+        job->next  = p->done;
+        p->done    = job;
+        if (!p->closed) {
+            notify(p);
+        }
+    }
+    release(p);
+
+    return NULL;
+}
+
+static inline lls_resolver_pool_t *checkopen(lua_State *L)
+{
+    lls_resolver_t *r = lauxh_checkudata(L, 1, RESOLVER_MT);
+
+    if (!r->pool) {
+        luaL_error(L, "attempt to use a closed resolver");
+    }
+    return r->pool;
+}
+
+static inline lls_resreq_t *newjob(lua_State *L, int type, size_t len)
+{
+    // the request frees the job if it is not queued
+    lls_resreq_t *req = lls_newuserdata(L, sizeof(lls_resreq_t), REQ_NUV);
+
+    req->job    = NULL;
+    req->queued = 0;
+    lauxh_setmetatable(L, RESREQ_MT);
+    if (!(req->job = calloc(1, sizeof(lls_resolver_job_t) + len))) {
+        luaL_error(L, "failed to allocate a resolver job: %s",
+                   strerror(errno));
+    }
+    req->job->type = type;
+    return req;
+}
+
+// the request returned by newjob must be at the top of the stack
+static void submit(lua_State *L, lls_resreq_t *req)
+{
+    lls_resolver_pool_t *p  = checkopen(L);
+    lls_resolver_job_t *job = req->job;
+
+    lua_pushvalue(L, 1);
+    lls_setuservalue(L, -2, REQ_UV_RESOLVER);
+
+    // keep the request until it is completed
+    lls_getuservalue(L, 1, UV_PENDING);
+    lua_pushlightuserdata(L, (void *)job);
+    lua_pushvalue(L, -3);
+    lua_rawset(L, -3);
+    lua_pop(L, 1);
+
+    pthread_mutex_lock(&p->mutex);
+    job->state = JOB_PENDING;
+    job->next  = NULL;
+    if (p->tail) {
+        p->tail->next = job;
+    } else {
+        p->head = job;
+    }
+    p->tail     = job;
+    req->queued = 1;
+    pthread_cond_signal(&p->cond);
+    pthread_mutex_unlock(&p->mutex);
+}
+
+static int getnameinfo_lua(lua_State *L)
+{
+    lls_addrinfo_t *info    = lauxh_checkudata(L, 2, ADDRINFO_MT);
+    int flags               = lauxh_optflags(L, 3);
+    lls_resreq_t *req       = NULL;
+    lls_resolver_job_t *job = NULL;
+
+    checkopen(L);
+    req = newjob(L, JOB_GETNAMEINFO, 0);
+    job = req->job;
+    memcpy((void *)&job->addr, info->ai.ai_addr, info->ai.ai_addrlen);
+    job->addrlen = info->ai.ai_addrlen;
+    job->flags   = flags;
+    submit(L, req);
+
+    return 1;
+}
+
+static int getaddrinfo_lua(lua_State *L)
+{
+    size_t nodelen          = 0;
+    const char *node        = lauxh_optlstring(L, 2, NULL, &nodelen);
+    size_t servicelen       = 0;
+    const char *service     = lauxh_optlstring(L, 3, NULL, &servicelen);
+    int family              = (int)lauxh_optinteger(L, 4, AF_UNSPEC);
+    // SOCK_STREAM:tcp | SOCK_DGRAM:udp | SOCK_SEQPACKET
+    int socktype            = (int)lauxh_optinteger(L, 5, 0);
+    // IPPROTO_TCP:tcp | IPPROTO_UDP:udp | 0:automatic
+    int protocol            = (int)lauxh_optinteger(L, 6, 0);
+    // AI_PASSIVE:bind socket if node is null
+    int flags               = lauxh_optflags(L, 7);
+    lls_resreq_t *req       = NULL;
+    lls_resolver_job_t *job = NULL;
+
+    checkopen(L);
+    // copy the strings into the job
+    req = newjob(L, JOB_GETADDRINFO, nodelen + servicelen + 2);
+    job = req->job;
+    if (nodelen) {
+        memcpy(job->buf, node, nodelen);
+        job->node = job->buf;
+    }
+    if (servicelen) {
+        memcpy(job->buf + nodelen + 1, service, servicelen);
+        job->service = job->buf + nodelen + 1;
+    }
+    job->hints = (struct addrinfo){.ai_family    = family,
+                                   .ai_socktype  = socktype,
+                                   .ai_protocol  = protocol,
+                                   .ai_flags     = flags,
+                                   .ai_addrlen   = 0,
+                                   .ai_addr      = NULL,
+                                   .ai_canonname = NULL,
+                                   .ai_next      = NULL};
+    submit(L, req);
+
+    return 1;
+}
+
+static void complete(lua_State *L, lls_resreq_t *req, lls_resolver_job_t *job)
+{
+    // result
+    if (job->rc != 0) {
+        lua_pushnil(L);
+    } else if (job->type == JOB_GETADDRINFO) {
+        lls_addrinfo_pushlist(L, job->list);
+    } else {
+        lua_createtable(L, 0, 2);
+        lauxh_pushstr2tbl(L, "host", job->host);
+        lauxh_pushstr2tbl(L, "service", job->serv);
+    }
+    lls_setuservalue(L, -2, REQ_UV_RESULT);
+
+    // error
+    if (job->rc != 0) {
+        errno = job->err;
+        lua_errno_eai_new(L, job->rc, (job->type == JOB_GETADDRINFO) ?
+                                          "getaddrinfo" :
+                                          "getnameinfo");
+        lls_setuservalue(L, -2, REQ_UV_ERROR);
+    }
+    req->job = NULL;
+}
+
+static int results_lua(lua_State *L)
+{
+    lls_resolver_pool_t *p  = checkopen(L);
+    lls_resolver_job_t *job = NULL;
+    int idx                 = 1;
+#if defined(__linux__)
+    uint64_t v = 0;
+#else
+    char v[64];
+#endif
+
+    lua_settop(L, 1);
+    // consume the notification before taking the completed jobs
+    while (read(p->rfd, &v, sizeof(v)) > 0) {
+    }
+    pthread_mutex_lock(&p->mutex);
+    job     = p->done;
+    p->done = NULL;
+    pthread_mutex_unlock(&p->mutex);
+
+    lls_getuservalue(L, 1, UV_PENDING);
+    lua_newtable(L);
+    while (job) {
+        lls_resolver_job_t *next = job->next;
+
+        lua_pushlightuserdata(L, (void *)job);
+        lua_rawget(L, 2);
+        if (lua_isuserdata(L, -1)) {
+            complete(L, lua_touserdata(L, -1), job);
+            lua_rawseti(L, -2, idx++);
+        } else {
+            lua_pop(L, 1);
+        }
+        // remove from the pending list
+        lua_pushlightuserdata(L, (void *)job);
+        lua_pushnil(L);
+        lua_rawset(L, 2);
+
+        job->next = NULL;
+        freejobs(job);
+        job = next;
+    }
+
+    return 1;
+}
+
+static int fd_lua(lua_State *L)
+{
+    lls_resolver_pool_t *p = checkopen(L);
+
+    lua_pushinteger(L, p->rfd);
+    return 1;
+}
+
+/**
+ * pin the shared object that contains the workers, so that the busy workers
+ * can keep running after the module is unloaded by lua_close. the reference
+ * is never released, because a worker that drops the last reference would
+ * return into the unmapped code.
+ */
+static void pinmodule(void)
+{
+    static int pinned = 0;
+    Dl_info info;
+
+    if (!pinned && dladdr((void *)worker, &info) && info.dli_fname) {
+        pinned = dlopen(info.dli_fname,
+                        RTLD_NOW | RTLD_NOLOAD | RTLD_NODELETE) != NULL;
+    }
+}
+
+static int close_lua(lua_State *L)
+{
+    lls_resolver_t *r      = lauxh_checkudata(L, 1, RESOLVER_MT);
+    lls_resolver_pool_t *p = r->pool;
+    pthread_t idle[MAX_NTHREAD];
+    int nidle = 0;
+    int nbusy = 0;
+
+    if (!p) {
+        return 0;
+    }
+    r->pool = NULL;
+
+    // the running jobs will be released by the last worker
+    pthread_mutex_lock(&p->mutex);
+    p->closed = 1;
+    close(p->rfd);
+    if (p->wfd != p->rfd) {
+        close(p->wfd);
+    }
+    pthread_cond_broadcast(&p->cond);
+    for (int i = 0; i < p->nworker; i++) {
+        if (p->workers[i].busy) {
+            // the lookup in flight cannot be interrupted
+            pthread_detach(p->workers[i].th);
+            nbusy++;
+        } else {
+            idle[nidle++] = p->workers[i].th;
+        }
+    }
+    if (nbusy) {
+        pinmodule();
+    }
+    release(p);
+    // the idle workers exit without running any more jobs
+    for (int i = 0; i < nidle; i++) {
+        pthread_join(idle[i], NULL);
+    }
+
+    // cancel the pending requests
+    lua_settop(L, 1);
+    lls_getuservalue(L, 1, UV_PENDING);
+    lua_pushnil(L);
+    while (lua_next(L, 2)) {
+        lls_resreq_t *req = lua_touserdata(L, -1);
+
+        req->job = NULL;
+        lua_pushnil(L);
+        lls_setuservalue(L, -2, REQ_UV_RESULT);
+        errno = ECANCELED;
+        lua_errno_new(L, errno, "close");
+        lls_setuservalue(L, -2, REQ_UV_ERROR);
+        lua_pop(L, 1);
+    }
+    lua_newtable(L);
+    lls_setuservalue(L, 1, UV_PENDING);
+
+    return 0;
+}
+
+static int tostring_lua(lua_State *L)
+{
+    lua_pushfstring(L, RESOLVER_MT ": %p", lua_touserdata(L, 1));
+    return 1;
+}
+
+static int req_cancel_lua(lua_State *L)
+{
+    lls_resreq_t *req       = lauxh_checkudata(L, 1, RESREQ_MT);
+    lls_resolver_job_t *job = req->job;
+    lls_resolver_t *r       = NULL;
+    int cancelled           = 0;
+
+    if (!job) {
+        lua_pushboolean(L, 0);
+        return 1;
+    }
+
+    lua_settop(L, 1);
+    lls_getuservalue(L, 1, REQ_UV_RESOLVER);
+    r = lua_touserdata(L, 2);
+    pthread_mutex_lock(&r->pool->mutex);
+    if (job->state == JOB_PENDING) {
+        // unlink from the queue
+        lls_resolver_job_t **ptr = &r->pool->head;
+        lls_resolver_job_t *prev = NULL;
+
+        while (*ptr != job) {
+            prev = *ptr;
+            ptr  = &prev->next;
+        }
+        *ptr = job->next;
+        if (r->pool->tail == job) {
+            r->pool->tail = prev;
+        }
+        cancelled = 1;
+    }
+    pthread_mutex_unlock(&r->pool->mutex);
+
+    if (cancelled) {
+        req->job = NULL;
+        lls_getuservalue(L, 2, UV_PENDING);
+        lua_pushlightuserdata(L, (void *)job);
+        lua_pushnil(L);
+        lua_rawset(L, -3);
+        free(job);
+        errno = ECANCELED;
+        lua_errno_new(L, errno, "cancel");
+        lls_setuservalue(L, 1, REQ_UV_ERROR);
+    }
+    lua_pushboolean(L, cancelled);
+
+    return 1;
+}
+
+static int req_result_lua(lua_State *L)
+{
+    lls_resreq_t *req = lauxh_checkudata(L, 1, RESREQ_MT);
+
+    if (req->job) {
+        // not completed yet
+        lua_pushnil(L);
+        lua_pushnil(L);
+        lua_pushboolean(L, 1);
+        return 3;
+    }
+    lls_getuservalue(L, 1, REQ_UV_RESULT);
+    lls_getuservalue(L, 1, REQ_UV_ERROR);
+
+    return 2;
+}
+
+static int req_gc_lua(lua_State *L)
+{
+    lls_resreq_t *req = lua_touserdata(L, 1);
+
+    // the job that failed to be submitted
+    if (!req->queued) {
+        free(req->job);
+        req->job = NULL;
+    }
+    return 0;
+}
+
+static int req_tostring_lua(lua_State *L)
+{
+    lua_pushfstring(L, RESREQ_MT ": %p", lua_touserdata(L, 1));
+    return 1;
+}
+
+static int new_lua(lua_State *L)
+{
+    lua_Integer nthread    = lauxh_optinteger(L, 1, DEFAULT_NTHREAD);
+    lls_resolver_t *r      = NULL;
+    lls_resolver_pool_t *p = NULL;
+    sigset_t all;
+    sigset_t old;
+    int fds[2] = {-1, -1};
+    int rc     = 0;
+
+    if (nthread < 1 || nthread > MAX_NTHREAD) {
+        return luaL_argerror(L, 1, "nthread must be between 1 and 64");
+    }
+
+    lua_settop(L, 0);
+    r       = lls_newuserdata(L, sizeof(lls_resolver_t), NUV);
+    r->pool = NULL;
+    lauxh_setmetatable(L, RESOLVER_MT);
+    lua_newtable(L);
+    lls_setuservalue(L, 1, UV_PENDING);
+
+#if defined(__linux__)
+    fds[0] = fds[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fds[0] == -1) {
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "eventfd");
+        return 2;
+    }
+#else
+    if (pipe(fds) == -1) {
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "pipe");
+        return 2;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+#endif
+
+    if (!(p = calloc(1, sizeof(lls_resolver_pool_t) +
+                             sizeof(lls_resolver_worker_t) * nthread))) {
+        rc = errno;
+        goto FAIL;
+    }
+    pthread_mutex_init(&p->mutex, NULL);
+    pthread_cond_init(&p->cond, NULL);
+    p->rfd  = fds[0];
+    p->wfd  = fds[1];
+    p->refs = 1;
+    r->pool = p;
+
+    // the workers must not handle the signals
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (lua_Integer i = 0; i < nthread && !rc; i++) {
+        lls_resolver_worker_t *w = &p->workers[i];
+
+        pthread_mutex_lock(&p->mutex);
+        w->pool = p;
+        if ((rc = pthread_create(&w->th, NULL, worker, w)) == 0) {
+            p->nworker++;
+            p->refs++;
+        }
+        pthread_mutex_unlock(&p->mutex);
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc) {
+        lua_pushcfunction(L, close_lua);
+        lua_pushvalue(L, 1);
+        lua_call(L, 1, 0);
+        lua_pushnil(L);
+        lua_errno_new(L, rc, "pthread_create");
+        return 2;
+    }
+
+    return 1;
+
+FAIL:
+    close(fds[0]);
+    if (fds[1] != fds[0]) {
+        close(fds[1]);
+    }
+    lua_pushnil(L);
+    lua_errno_new(L, rc, "calloc");
+    return 2;
+}
+
+LUALIB_API int luaopen_llsocket_resolver(lua_State *L)
+{
+    // create metatable
+    if (luaL_newmetatable(L, RESOLVER_MT)) {
+        struct luaL_Reg mmethod[] = {
+            {"__gc",       close_lua   },
+            {"__tostring", tostring_lua},
+            {NULL,         NULL        }
+        };
+        struct luaL_Reg method[] = {
+            {"fd",          fd_lua         },
+            {"getaddrinfo", getaddrinfo_lua},
+            {"getnameinfo", getnameinfo_lua},
+            {"results",     results_lua    },
+            {"close",       close_lua      },
+            {NULL,          NULL           }
+        };
+        struct luaL_Reg *ptr = mmethod;
+
+        // metamethods
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        // methods
+        lua_pushstring(L, "__index");
+        lua_newtable(L);
+        ptr = method;
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        lua_rawset(L, -3);
+    }
+    lua_pop(L, 1);
+
+    if (luaL_newmetatable(L, RESREQ_MT)) {
+        struct luaL_Reg mmethod[] = {
+            {"__gc",       req_gc_lua      },
+            {"__tostring", req_tostring_lua},
+            {NULL,         NULL            }
+        };
+        struct luaL_Reg method[] = {
+            {"result", req_result_lua},
+            {"cancel", req_cancel_lua},
+            {NULL,     NULL          }
+        };
+        struct luaL_Reg *ptr = mmethod;
+
+        // metamethods
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        // methods
+        lua_pushstring(L, "__index");
+        lua_newtable(L);
+        ptr = method;
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        lua_rawset(L, -3);
+    }
+    lua_pop(L, 1);
+
+    // create module table
+    lua_newtable(L);
+    lauxh_pushfn2tbl(L, "new", new_lua);
+
+    return 1;
+}
@@ -28,14 +28,546 @@
 #include "llsocket.h"
 
 #define DEFAULT_RECVSIZE 4096
+// minimum size of message to be sent by vmsplice
+#define VMSPLICE_THRESHOLD (256 * 1024)
+// preferred size of pipe for vmsplice
+#define VMSPLICE_PIPESIZE  (1024 * 1024)
+
+#if defined(__linux__) && !defined(IP_LOCAL_PORT_RANGE)
+// linux 6.3 or later, not defined by the old libc headers
+# define IP_LOCAL_PORT_RANGE 51
+#endif
+
+// MARK: descriptor pressure
+
+// registry key of the pressure hook of this lua_State
+#define PRESSURE_HOOK SOCKET_MT ".pressure"
+// default ratio of the soft limit of RLIMIT_NOFILE
+#define DEFAULT_PRESSURE 0.9
+
+// number of descriptors held by the socket objects in this process.
+// RLIMIT_NOFILE is the limit of the process, so the counter is shared by all
+// lua_States while the threshold and the hook belong to each lua_State.
+static size_t NOPEN = 0;
+
+typedef struct {
+    // number of descriptors to fire the hook
+    size_t threshold;
+    // the hook is fired when the counter reaches the threshold
+    int armed;
+} pressure_t;
+
+static inline size_t nofile(void)
+{
+    struct rlimit rl;
+
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur == RLIM_INFINITY) {
+        return 0;
+    }
+    return (size_t)rl.rlim_cur;
+}
+
+static inline pressure_t *getpressure(lua_State *L)
+{
+    lua_getfield(L, LUA_REGISTRYINDEX, PRESSURE_HOOK);
+    return lua_touserdata(L, -1);
+}
+
+static inline void opened(lua_State *L)
+{
+    size_t n      = __atomic_add_fetch(&NOPEN, 1, __ATOMIC_RELAXED);
+    pressure_t *p = getpressure(L);
+
+    if (p) {
+        if (n < p->threshold) {
+            p->armed = 1;
+        } else if (p->armed) {
+            // fire only when the counter crosses the threshold, and let the
+            // application release the unreachable sockets.
+            // the caller may be holding the descriptors that are not yet
+            // owned by the socket objects, so the error of the hook must not
+            // unwind the stack
+            p->armed = 0;
+            lls_getuservalue(L, -1, 1);
+            lua_pushinteger(L, n);
+            lua_pushinteger(L, nofile());
+            if (lua_pcall(L, 2, 0, 0) != 0) {
+                // ignore the error
+                lua_pop(L, 1);
+            }
+        }
+    }
+    lua_pop(L, 1);
+}
+
+static inline void released(lua_State *L)
+{
+    size_t n      = __atomic_sub_fetch(&NOPEN, 1, __ATOMIC_RELAXED);
+    pressure_t *p = getpressure(L);
+
+    if (p && n < p->threshold) {
+        // re-arm the hook
+        p->armed = 1;
+    }
+    lua_pop(L, 1);
+}
+
+// MARK: ephemeral port exhaustion
+
+// number of EADDRNOTAVAIL failures of bind and connect in this process
+static size_t NBIND_ADDRNOTAVAIL    = 0;
+static size_t NCONNECT_ADDRNOTAVAIL = 0;
+
+static inline void addrnotavail(int err, size_t *counter)
+{
+    if (err == EADDRNOTAVAIL) {
+        __atomic_add_fetch(counter, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static int addrnotavail_lua(lua_State *L)
+{
+    lua_pushinteger(L,
+                    __atomic_load_n(&NBIND_ADDRNOTAVAIL, __ATOMIC_RELAXED));
+    lua_pushinteger(L,
+                    __atomic_load_n(&NCONNECT_ADDRNOTAVAIL, __ATOMIC_RELAXED));
+    return 2;
+}
+
+static int nopen_lua(lua_State *L)
+{
+    lua_pushinteger(L, __atomic_load_n(&NOPEN, __ATOMIC_RELAXED));
+    lua_pushinteger(L, nofile());
+    return 2;
+}
+
+static int onpressure_lua(lua_State *L)
+{
+    lua_Number ratio = lauxh_optnumber(L, 2, DEFAULT_PRESSURE);
+    pressure_t *p    = NULL;
+
+    if (lua_isnoneornil(L, 1)) {
+        // disable
+        lua_pushnil(L);
+        lua_setfield(L, LUA_REGISTRYINDEX, PRESSURE_HOOK);
+        return 0;
+    }
+    luaL_checktype(L, 1, LUA_TFUNCTION);
+    if (!(ratio > 0 && ratio <= 1)) {
+        return luaL_argerror(L, 2, "ratio must be in the range of (0, 1]");
+    }
+
+    lua_settop(L, 1);
+    p  = lls_newuserdata(L, sizeof(pressure_t), 1);
+    *p = (pressure_t){
+        .threshold = (size_t)((lua_Number)nofile() * ratio),
+        .armed     = 1,
+    };
+    if (!p->threshold) {
+        // RLIMIT_NOFILE is unlimited
+        p->threshold = SIZE_MAX;
+    }
+    lua_pushvalue(L, 1);
+    lls_setuservalue(L, -2, 1);
+    lua_setfield(L, LUA_REGISTRYINDEX, PRESSURE_HOOK);
+    return 0;
+}
+
+static inline lls_socket_t *newsocket(lua_State *L, int fd, int family,
+                                      int socktype, int protocol)
+{
+    lls_socket_t *s = lua_newuserdata(L, sizeof(lls_socket_t));
+
+    *s = (lls_socket_t){
+        .fd         = fd,
+        .family     = family,
+        .socktype   = socktype,
+        .protocol   = protocol,
+        .gcfunc     = NULL,
+        .pipefd     = {-1, -1},
+        .npipe      = 0,
+        .pipe_ref   = LUA_NOREF,
+        .pin_head   = 0,
+        .pin_tail   = 0,
+        .spliced    = 0,
+        .budget     = lls_budget_global(L),
+        .budget_ref = LUA_NOREF,
+        .timer      = NULL,
+    };
+    lauxh_setmetatable(L, SOCKET_MT);
+    opened(L);
+
+    return s;
+}
+
+lls_socket_t *lls_socket_new(lua_State *L, int fd, int family, int socktype,
+                             int protocol)
+{
+    return newsocket(L, fd, family, socktype, protocol);
+}
+
+static inline lls_budget_t *ownbudget(lua_State *L, lls_socket_t *s)
+{
+    if (s->budget_ref == LUA_NOREF) {
+        // create the budget of this socket
+        s->budget     = lls_budget_new(L);
+        s->budget_ref = lauxh_ref(L);
+    }
+    return s->budget;
+}
+
+static inline int checkbudget(lua_State *L, lls_socket_t *s, size_t len)
+{
+    if (lls_budget_check(s->budget, len)) {
+        return 0;
+    }
+    // budget exceeded
+    lua_pushnil(L);
+    lua_errno_new(L, errno, "rcvbudget");
+    return 2;
+}
+
+// MARK: pipe for vmsplice
+
+#if defined(HAVE_VMSPLICE) && defined(HAVE_SPLICE)
+
+// registry key of the idle pipes shared by the sockets
+# define PIPE_POOL SOCKET_MT ".pipes"
+// maximum number of idle pipes
+# define PIPE_POOL_SIZE 4
+// user value of the pipe pool that maps the descriptors of the closed
+// sockets to the messages that are not yet sent
+# define PIPE_UV_LINGER 1
 
 typedef struct {
-    int fd;
-    int family;
-    int socktype;
-    int protocol;
-    lls_gcfn_t *gcfunc;
-} lls_socket_t;
+    int npipe;
+    int pipes[PIPE_POOL_SIZE][2];
+} lls_pipepool_t;
+
+static int pipepool_gc_lua(lua_State *L)
+{
+    lls_pipepool_t *p = lua_touserdata(L, 1);
+
+    while (p->npipe) {
+        p->npipe--;
+        close(p->pipes[p->npipe][0]);
+        close(p->pipes[p->npipe][1]);
+    }
+
+    // close the lingering descriptors
+    lls_getuservalue(L, 1, PIPE_UV_LINGER);
+    if (lua_istable(L, -1)) {
+        lua_pushnil(L);
+        while (lua_next(L, -2)) {
+            close((int)lua_tointeger(L, -2));
+            lua_pop(L, 1);
+        }
+    }
+    return 0;
+}
+
+static lls_pipepool_t *pipepool(lua_State *L)
+{
+    lls_pipepool_t *p = NULL;
+
+    lua_getfield(L, LUA_REGISTRYINDEX, PIPE_POOL);
+    p = lua_touserdata(L, -1);
+    lua_pop(L, 1);
+    if (!p) {
+        // create the pipe pool of this state
+        p        = lls_newuserdata(L, sizeof(lls_pipepool_t), 1);
+        p->npipe = 0;
+        lua_createtable(L, 0, 1);
+        lauxh_pushfn2tbl(L, "__gc", pipepool_gc_lua);
+        lua_setmetatable(L, -2);
+        lua_newtable(L);
+        lls_setuservalue(L, -2, PIPE_UV_LINGER);
+        lua_setfield(L, LUA_REGISTRYINDEX, PIPE_POOL);
+    }
+    return p;
+}
+
+static inline int openpipe(lua_State *L, lls_socket_t *s)
+{
+    lls_pipepool_t *p = NULL;
+
+    if (s->pipefd[0] != -1) {
+        return 0;
+    }
+
+    // reuse the idle pipe
+    p = pipepool(L);
+    if (p->npipe) {
+        p->npipe--;
+        s->pipefd[0] = p->pipes[p->npipe][0];
+        s->pipefd[1] = p->pipes[p->npipe][1];
+        return 0;
+    }
+
+    if (pipe2(s->pipefd, O_CLOEXEC | O_NONBLOCK) != 0) {
+        s->pipefd[0] = -1;
+        s->pipefd[1] = -1;
+        return -1;
+    }
+# if defined(F_SETPIPE_SZ)
+    // the pipe size is only a hint
+    fcntl(s->pipefd[1], F_SETPIPE_SZ, VMSPLICE_PIPESIZE);
+# endif
+    return 0;
+}
+
+static inline void putpipe(lua_State *L, lls_socket_t *s)
+{
+    lls_pipepool_t *p = NULL;
+
+    if (s->pipefd[0] == -1) {
+        return;
+    }
+
+    p = pipepool(L);
+    if (!s->npipe && p->npipe < PIPE_POOL_SIZE) {
+        // return the drained pipe to the pool
+        p->pipes[p->npipe][0] = s->pipefd[0];
+        p->pipes[p->npipe][1] = s->pipefd[1];
+        p->npipe++;
+    } else {
+        close(s->pipefd[0]);
+        close(s->pipefd[1]);
+    }
+    s->pipefd[0] = -1;
+    s->pipefd[1] = -1;
+    s->npipe     = 0;
+}
+
+// number of bytes in the send queue that not yet sent or acknowledged, or -1
+// on error
+static inline int unsent(int fd)
+{
+    int n = 0;
+
+    if (ioctl(fd, SIOCOUTQ, &n) != 0) {
+        return -1;
+    }
+    return n;
+}
+
+/**
+ * close the descriptors of the closed sockets that their send queue have been
+ * drained, and release their messages.
+ */
+static void sweeplinger(lua_State *L)
+{
+    lua_getfield(L, LUA_REGISTRYINDEX, PIPE_POOL);
+    if (!lua_isuserdata(L, -1)) {
+        lua_pop(L, 1);
+        return;
+    }
+    lls_getuservalue(L, -1, PIPE_UV_LINGER);
+    lua_pushnil(L);
+    while (lua_next(L, -2)) {
+        int fd = (int)lua_tointeger(L, -2);
+
+        lua_pop(L, 1);
+        if (unsent(fd) <= 0) {
+            close(fd);
+            lua_pushvalue(L, -1);
+            lua_pushnil(L);
+            lua_rawset(L, -4);
+        }
+    }
+    lua_pop(L, 2);
+}
+
+static inline void pinmsg(lua_State *L, lls_socket_t *s, int idx)
+{
+    if (!lauxh_isref(s->pipe_ref)) {
+        lua_createtable(L, 2, 0);
+        s->pipe_ref = lauxh_ref(L);
+        s->pin_head = 0;
+        s->pin_tail = 0;
+    }
+    lauxh_pushref(L, s->pipe_ref);
+    s->pin_tail++;
+    lua_pushvalue(L, idx);
+    lua_rawseti(L, -2, s->pin_tail * 2 - 1);
+    // the pipe holds only this message, so its last byte is moved into the
+    // send queue when the bytes in the pipe are spliced
+    lua_pushinteger(L, (lua_Integer)(s->spliced + s->npipe));
+    lua_rawseti(L, -2, s->pin_tail * 2);
+    lua_pop(L, 1);
+}
+
+static inline void unpinmsg(lua_State *L, lls_socket_t *s)
+{
+    int n = 0;
+
+    // splice only moves the references of the pages into the send queue, so
+    // the messages must be kept until the queued data is sent
+    if (!lauxh_isref(s->pipe_ref) || (n = unsent(s->fd)) < 0) {
+        return;
+    }
+
+    lauxh_pushref(L, s->pipe_ref);
+    while (s->pin_head < s->pin_tail) {
+        int i        = s->pin_head + 1;
+        uint64_t end = 0;
+
+        lua_rawgeti(L, -1, i * 2);
+        end = (uint64_t)lua_tointeger(L, -1);
+        lua_pop(L, 1);
+        // the message has left the send queue if the queue holds only the
+        // bytes that spliced after the message
+        if (end > s->spliced || s->spliced - end < (uint64_t)n) {
+            break;
+        }
+        lua_pushnil(L);
+        lua_rawseti(L, -2, i * 2 - 1);
+        lua_pushnil(L);
+        lua_rawseti(L, -2, i * 2);
+        s->pin_head = i;
+    }
+    lua_pop(L, 1);
+
+    if (s->pin_head == s->pin_tail) {
+        s->pipe_ref = lauxh_unref(L, s->pipe_ref);
+    }
+}
+
+static inline void closepipe(lua_State *L, lls_socket_t *s)
+{
+    unpinmsg(L, s);
+    if (lauxh_isref(s->pipe_ref)) {
+        // the kernel still sends the pages after the descriptor is closed, so
+        // the duplicated descriptor keeps the socket open with the messages
+        // until its send queue is drained
+        int fd = fcntl(s->fd, F_DUPFD_CLOEXEC, 0);
+
+        if (fd != -1) {
+            shutdown(fd, SHUT_WR);
+            pipepool(L);
+            lua_getfield(L, LUA_REGISTRYINDEX, PIPE_POOL);
+            lls_getuservalue(L, -1, PIPE_UV_LINGER);
+            lauxh_pushref(L, s->pipe_ref);
+            lua_rawseti(L, -2, fd);
+            lua_pop(L, 2);
+        }
+        s->pipe_ref = lauxh_unref(L, s->pipe_ref);
+    }
+    putpipe(L, s);
+    sweeplinger(L);
+}
+
+#else
+
+static inline void closepipe(lua_State *L, lls_socket_t *s)
+{
+    (void)L;
+    (void)s;
+}
+
+#endif
+
+// MARK: coroutine
+
+// registry key of the scheduler hook
+#define YIELD_HOOK SOCKET_MT ".hook"
+
+#if LUA_VERSION_NUM >= 502
+
+static inline int canyield(lua_State *L)
+{
+    int rv = 0;
+
+# if LUA_VERSION_NUM >= 503
+    if (!lua_isyieldable(L)) {
+        return 0;
+    }
+# else
+    // main thread cannot yield
+    rv = lua_pushthread(L);
+    lua_pop(L, 1);
+    if (rv) {
+        return 0;
+    }
+# endif
+
+    lua_getfield(L, LUA_REGISTRYINDEX, YIELD_HOOK);
+    rv = lua_isfunction(L, -1);
+    lua_pop(L, 1);
+    return rv;
+}
+
+static inline int resume(lua_State *L, int base)
+{
+    lua_CFunction fn = lua_tocfunction(L, base);
+
+    // discard the values passed to coroutine.resume
+    lua_settop(L, base - 1);
+    return fn(L);
+}
+
+# if LUA_VERSION_NUM >= 503
+static int resume_k(lua_State *L, int status, lua_KContext ctx)
+{
+    (void)status;
+    return resume(L, (int)ctx);
+}
+# else
+static int resume_k(lua_State *L)
+{
+    int ctx = 0;
+
+    lua_getctx(L, &ctx);
+    return resume(L, ctx);
+}
+# endif
+
+/**
+ * call the scheduler hook with the socket and the event name, and yield the
+ * values returned by the hook. the fn will be called with the stack that
+ * truncated to the top when the coroutine is resumed.
+ */
+static int waitio(lua_State *L, int top, const char *event, lua_CFunction fn)
+{
+    lua_settop(L, top);
+    lua_pushcfunction(L, fn);
+    lua_getfield(L, LUA_REGISTRYINDEX, YIELD_HOOK);
+    lua_pushvalue(L, 1);
+    lua_pushstring(L, event);
+    lua_call(L, 2, LUA_MULTRET);
+    return lua_yieldk(L, lua_gettop(L) - top - 1, top + 1, resume_k);
+}
+
+#else
+
+// lua_yieldk is not supported
+static inline int canyield(lua_State *L)
+{
+    (void)L;
+    return 0;
+}
+
+static inline int waitio(lua_State *L, int top, const char *event,
+                         lua_CFunction fn)
+{
+    (void)L;
+    (void)top;
+    (void)event;
+    (void)fn;
+    return 0;
+}
+
+#endif
+
+static int sethook_lua(lua_State *L)
+{
+    if (!lua_isnoneornil(L, 1)) {
+        luaL_checktype(L, 1, LUA_TFUNCTION);
+    }
+    lua_settop(L, 1);
+    lua_setfield(L, LUA_REGISTRYINDEX, YIELD_HOOK);
+    return 0;
+}
 
 // MARK: fd option
 static int cloexec_lua(lua_State *L)
@@ -696,6 +1228,73 @@ static int reuseport_lua(lua_State *L)
 #endif
 }
 
+static int bindnoport_lua(lua_State *L)
+{
+#if defined(IP_BIND_ADDRESS_NO_PORT)
+    return sockopt_int_lua(L, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT,
+                           LUA_TBOOLEAN);
+
+#else
+    lua_pushnil(L);
+    errno = EOPNOTSUPP;
+    lua_errno_new(L, errno, "bindnoport_lua");
+    return 2;
+
+#endif
+}
+
+static int localportrange_lua(lua_State *L)
+{
+#if defined(IP_LOCAL_PORT_RANGE)
+    lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
+    uint32_t range  = 0;
+    socklen_t len   = sizeof(range);
+    uint16_t lo     = 0;
+    uint16_t hi     = 0;
+
+    if (getsockopt(s->fd, IPPROTO_IP, IP_LOCAL_PORT_RANGE, (void *)&range,
+                   &len) != 0) {
+        lua_pushnil(L);
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "getsockopt");
+        return 3;
+    }
+    // the lower 16 bits are the lower bound of the range
+    lua_pushinteger(L, range & 0xffff);
+    lua_pushinteger(L, range >> 16);
+
+    // no-change
+    if (lua_isnoneornil(L, 2) && lua_isnoneornil(L, 3)) {
+        return 2;
+    }
+
+    lo = lauxh_checkuint16(L, 2);
+    hi = lauxh_checkuint16(L, 3);
+    if (lo && hi && lo > hi) {
+        return luaL_argerror(L, 3, "hi must be greater than or equal to lo");
+    }
+    range = ((uint32_t)hi << 16) | lo;
+    if (setsockopt(s->fd, IPPROTO_IP, IP_LOCAL_PORT_RANGE, (void *)&range,
+                   len) == 0) {
+        return 2;
+    }
+
+    // got error
+    lua_pushnil(L);
+    lua_pushnil(L);
+    lua_errno_new(L, errno, "setsockopt");
+    return 3;
+
+#else
+    lua_pushnil(L);
+    lua_pushnil(L);
+    errno = EOPNOTSUPP;
+    lua_errno_new(L, errno, "localportrange_lua");
+    return 3;
+
+#endif
+}
+
 static int reuseaddr_lua(lua_State *L)
 {
     return sockopt_int_lua(L, SOL_SOCKET, SO_REUSEADDR, LUA_TBOOLEAN);
@@ -825,29 +1424,105 @@ static int atmark_lua(lua_State *L)
 
 // MARK: address info
 
-static int getsockname_lua(lua_State *L)
-{
-    lls_socket_t *s              = lauxh_checkudata(L, 1, SOCKET_MT);
-    struct sockaddr_storage addr = {0};
-    socklen_t addrlen            = sizeof(struct sockaddr_storage);
-    struct addrinfo wrap;
+// output forms of the address
+#define ADDR_NEW    0
+#define ADDR_REUSE  1
+#define ADDR_PACKED 2
+#define ADDR_PEER   3
+
+/**
+ * the address is returned as a new llsocket.addrinfo by default. if the
+ * argument is llsocket.addrinfo, it is overwritten and returned. if the
+ * argument is 'packed', the address is returned in the same form as
+ * addrinfo:pack().
+ */
+static inline int optaddrout(lua_State *L, int idx)
+{
+    switch (lua_type(L, idx)) {
+    case LUA_TUSERDATA:
+        lauxh_checkudata(L, idx, ADDRINFO_MT);
+        return ADDR_REUSE;
+
+    case LUA_TSTRING:
+        if (strcmp(lua_tostring(L, idx), "packed") == 0) {
+            return ADDR_PACKED;
+        }
+        return luaL_argerror(L, idx,
+                             "out must be llsocket.addrinfo or 'packed'");
+
+    default:
+        return ADDR_NEW;
+    }
+}
+
+/**
+ * push the address encoded by lls_addr_pack, or the raw sockaddr if the
+ * address family is neither AF_INET nor AF_INET6.
+ */
+static inline void pushpacked(lua_State *L, struct sockaddr *addr,
+                              socklen_t addrlen)
+{
+    uint8_t buf[LLS_PACKED_INET6_LEN];
+    size_t len = lls_addr_pack(buf, addr, addrlen);
+
+    if (len) {
+        lua_pushlstring(L, (const char *)buf, len);
+        return;
+    }
+    lua_pushlstring(L, (const char *)addr, addrlen);
+}
+
+static inline int pushaddr(lua_State *L, lls_socket_t *s, int out, int idx,
+                           struct sockaddr *addr, socklen_t addrlen)
+{
+    struct addrinfo wrap = {.ai_flags     = 0,
+                            .ai_family    = s->family,
+                            .ai_socktype  = s->socktype,
+                            .ai_protocol  = s->protocol,
+                            .ai_addrlen   = addrlen,
+                            .ai_addr      = addr,
+                            .ai_canonname = NULL,
+                            .ai_next      = NULL};
+
+    switch (out) {
+    case ADDR_REUSE:
+        lls_addrinfo_copy(L, idx, &wrap);
+        lua_pushvalue(L, idx);
+        return 1;
+
+    case ADDR_PACKED:
+        pushpacked(L, addr, addrlen);
+        return 1;
+
+    case ADDR_PEER:
+        // push the value associated with the address, or nil and the packed
+        // address if not found
+        if (lls_peermap_get(L, idx, addr, addrlen)) {
+            return 1;
+        }
+        pushpacked(L, addr, addrlen);
+        return 2;
+
+    default:
+        // push llsocket.addr udata
+        lls_addrinfo_alloc(L, &wrap);
+        return 1;
+    }
+}
+
+static int getsockname_lua(lua_State *L)
+{
+    lls_socket_t *s              = lauxh_checkudata(L, 1, SOCKET_MT);
+    int out                      = optaddrout(L, 2);
+    struct sockaddr_storage addr = {0};
+    socklen_t addrlen            = sizeof(struct sockaddr_storage);
 
     if (getsockname(s->fd, (struct sockaddr *)&addr, &addrlen) != 0) {
         lua_pushnil(L);
         lua_errno_new(L, errno, "getsockname");
         return 2;
     }
-
-    wrap = (struct addrinfo){.ai_flags     = 0,
-                             .ai_family    = s->family,
-                             .ai_socktype  = s->socktype,
-                             .ai_protocol  = s->protocol,
-                             .ai_addrlen   = addrlen,
-                             .ai_addr      = (struct sockaddr *)&addr,
-                             .ai_canonname = NULL,
-                             .ai_next      = NULL};
-    // push llsocket.addr udata
-    lls_addrinfo_alloc(L, &wrap);
+    pushaddr(L, s, out, 2, (struct sockaddr *)&addr, addrlen);
 
     return 1;
 }
@@ -855,29 +1530,316 @@ static int getsockname_lua(lua_State *L)
 static int getpeername_lua(lua_State *L)
 {
     lls_socket_t *s              = lauxh_checkudata(L, 1, SOCKET_MT);
+    int out                      = optaddrout(L, 2);
     socklen_t len                = sizeof(struct sockaddr_storage);
     struct sockaddr_storage addr = {0};
-    struct addrinfo wrap;
 
     if (getpeername(s->fd, (struct sockaddr *)&addr, &len) != 0) {
         lua_pushnil(L);
         lua_errno_new(L, errno, "getpeername");
         return 2;
     }
+    pushaddr(L, s, out, 2, (struct sockaddr *)&addr, len);
+
+    return 1;
+}
+
+// path mtu discovery
+
+static int mtudiscover_lua(lua_State *L)
+{
+#if defined(IP_MTU_DISCOVER) && defined(IPV6_MTU_DISCOVER)
+    lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
+
+    switch (s->family) {
+    case AF_INET:
+        return lls_sockopt_int_lua(L, s->fd, IPPROTO_IP, IP_MTU_DISCOVER,
+                                   LUA_TNUMBER);
+
+    case AF_INET6:
+        return lls_sockopt_int_lua(L, s->fd, IPPROTO_IPV6, IPV6_MTU_DISCOVER,
+                                   LUA_TNUMBER);
+
+    default:
+        lua_pushnil(L);
+        errno = EAFNOSUPPORT;
+        lua_errno_new(L, errno, "mtudiscover_lua");
+        return 2;
+    }
+
+#else
+    lua_pushnil(L);
+    errno = EOPNOTSUPP;
+    lua_errno_new(L, errno, "mtudiscover_lua");
+    return 2;
+
+#endif
+}
+
+static int recverr_lua(lua_State *L)
+{
+#if defined(IP_RECVERR) && defined(IPV6_RECVERR)
+    lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
+
+    switch (s->family) {
+    case AF_INET:
+        return lls_sockopt_int_lua(L, s->fd, IPPROTO_IP, IP_RECVERR,
+                                   LUA_TBOOLEAN);
+
+    case AF_INET6:
+        return lls_sockopt_int_lua(L, s->fd, IPPROTO_IPV6, IPV6_RECVERR,
+                                   LUA_TBOOLEAN);
+
+    default:
+        lua_pushnil(L);
+        errno = EAFNOSUPPORT;
+        lua_errno_new(L, errno, "recverr_lua");
+        return 2;
+    }
+
+#else
+    lua_pushnil(L);
+    errno = EOPNOTSUPP;
+    lua_errno_new(L, errno, "recverr_lua");
+    return 2;
+
+#endif
+}
+
+static int recverror_lua(lua_State *L)
+{
+#if defined(IP_RECVERR) && defined(IPV6_RECVERR)
+    lls_socket_t *s              = lauxh_checkudata(L, 1, SOCKET_MT);
+    struct sockaddr_storage addr = {0};
+    union {
+        struct cmsghdr hdr;
+        unsigned char buf[CMSG_SPACE(sizeof(struct sock_extended_err) +
+                                     sizeof(struct sockaddr_storage))];
+    } control;
+    struct msghdr data = {.msg_name       = (void *)&addr,
+                          .msg_namelen    = sizeof(addr),
+                          .msg_iov        = NULL,
+                          .msg_iovlen     = 0,
+                          .msg_control    = control.buf,
+                          .msg_controllen = sizeof(control.buf),
+                          .msg_flags      = 0};
+    struct cmsghdr *cmsg = NULL;
+
+    // the queued error does not wake up the blocking recvmsg
+    if (recvmsg(s->fd, &data, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+        lua_pushnil(L);
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            // again
+            lua_pushnil(L);
+            lua_pushboolean(L, 1);
+            return 3;
+        }
+        lua_errno_new(L, errno, "recvmsg");
+        return 2;
+    }
+
+    for (cmsg = CMSG_FIRSTHDR(&data); cmsg; cmsg = CMSG_NXTHDR(&data, cmsg)) {
+        if ((cmsg->cmsg_level == IPPROTO_IP &&
+             cmsg->cmsg_type == IP_RECVERR) ||
+            (cmsg->cmsg_level == IPPROTO_IPV6 &&
+             cmsg->cmsg_type == IPV6_RECVERR)) {
+            struct sock_extended_err *ee =
+                (struct sock_extended_err *)CMSG_DATA(cmsg);
+            struct sockaddr *offender = SO_EE_OFFENDER(ee);
+
+            lua_createtable(L, 0, 7);
+            lua_pushliteral(L, "error");
+            lua_errno_new(L, ee->ee_errno, "recverror");
+            lua_rawset(L, -3);
+            lauxh_pushint2tbl(L, "origin", ee->ee_origin);
+            lauxh_pushint2tbl(L, "type", ee->ee_type);
+            lauxh_pushint2tbl(L, "code", ee->ee_code);
+            // next-hop mtu of EMSGSIZE
+            lauxh_pushint2tbl(L, "info", ee->ee_info);
+            if (data.msg_namelen) {
+                // destination of the original datagram
+                lua_pushliteral(L, "addr");
+                pushaddr(L, s, ADDR_NEW, 0, (struct sockaddr *)&addr,
+                         data.msg_namelen);
+                lua_rawset(L, -3);
+            }
+            // address of the node that generated the error
+            switch (offender->sa_family) {
+            case AF_INET:
+                lua_pushliteral(L, "offender");
+                pushaddr(L, s, ADDR_NEW, 0, offender,
+                         sizeof(struct sockaddr_in));
+                lua_rawset(L, -3);
+                break;
+            case AF_INET6:
+                lua_pushliteral(L, "offender");
+                pushaddr(L, s, ADDR_NEW, 0, offender,
+                         sizeof(struct sockaddr_in6));
+                lua_rawset(L, -3);
+                break;
+            }
+            return 1;
+        }
+    }
+
+    // no extended error
+    lua_pushnil(L);
+    errno = ENOMSG;
+    lua_errno_new(L, errno, "recverror_lua");
+    return 2;
+
+#else
+    lua_pushnil(L);
+    errno = EOPNOTSUPP;
+    lua_errno_new(L, errno, "recverror_lua");
+    return 2;
+
+#endif
+}
+
+static inline int pathmtu(int fd, int family)
+{
+#if defined(IP_MTU) && defined(IPV6_MTU)
+    int mtu       = 0;
+    socklen_t len = sizeof(mtu);
+    int rv        = 0;
+
+    switch (family) {
+    case AF_INET:
+        rv = getsockopt(fd, IPPROTO_IP, IP_MTU, (void *)&mtu, &len);
+        break;
+    case AF_INET6:
+        rv = getsockopt(fd, IPPROTO_IPV6, IPV6_MTU, (void *)&mtu, &len);
+        break;
+    default:
+        errno = EAFNOSUPPORT;
+        return -1;
+    }
+    return (rv == 0) ? mtu : -1;
+
+#else
+    (void)fd;
+    (void)family;
+    errno = EOPNOTSUPP;
+    return -1;
+
+#endif
+}
+
+static int mtu_lua(lua_State *L)
+{
+    lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
+    int mtu         = pathmtu(s->fd, s->family);
+
+    if (mtu == -1) {
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "mtu");
+        return 2;
+    }
+    lua_pushinteger(L, mtu);
+    return 1;
+}
+
+static int maxpayload_lua(lua_State *L)
+{
+    lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
+    int family      = s->family;
+    int mtu         = 0;
+    int hdrlen      = 0;
+
+    if (lua_isnoneornil(L, 2)) {
+        mtu = pathmtu(s->fd, family);
+    } else {
+        lls_addrinfo_t *info = lauxh_checkudata(L, 2, ADDRINFO_MT);
+        int fd               = -1;
+        int err              = 0;
+
+        // look up the path mtu of the route to the destination by the
+        // temporary connected socket
+        family = info->ai.ai_family;
+        fd     = socket(family, SOCK_DGRAM, 0);
+        if (fd == -1) {
+            lua_pushnil(L);
+            lua_errno_new(L, errno, "socket");
+            return 2;
+        }
+        mtu = -1;
+        if (connect(fd, info->ai.ai_addr, info->ai.ai_addrlen) == 0) {
+            mtu = pathmtu(fd, family);
+        }
+        err = errno;
+        close(fd);
+        errno = err;
+    }
 
-    wrap = (struct addrinfo){.ai_flags     = 0,
-                             .ai_family    = s->family,
-                             .ai_socktype  = s->socktype,
-                             .ai_protocol  = s->protocol,
-                             .ai_addrlen   = len,
-                             .ai_addr      = (struct sockaddr *)&addr,
-                             .ai_canonname = NULL,
-                             .ai_next      = NULL};
-    lls_addrinfo_alloc(L, &wrap);
+    // use the minimum mtu if the path mtu is unknown
+    if (mtu == 0 || (mtu == -1 && errno == EOPNOTSUPP)) {
+        mtu = (family == AF_INET6) ? 1280 : 576;
+    }
+    // header size of the network and transport layer
+    switch (family) {
+    case AF_INET:
+        hdrlen = 20;
+        break;
+    case AF_INET6:
+        hdrlen = 40;
+        break;
+    default:
+        lua_pushnil(L);
+        errno = EAFNOSUPPORT;
+        lua_errno_new(L, errno, "maxpayload_lua");
+        return 2;
+    }
+    if (mtu == -1) {
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "maxpayload");
+        return 2;
+    }
+    switch (s->socktype) {
+    case SOCK_DGRAM:
+        hdrlen += 8;
+        break;
+    case SOCK_STREAM:
+        hdrlen += 20;
+        break;
+    }
 
+    lua_pushinteger(L, (mtu > hdrlen) ? mtu - hdrlen : 0);
     return 1;
 }
 
+// packet info
+
+static int pktinfo_lua(lua_State *L)
+{
+#if defined(IP_PKTINFO) && defined(IPV6_RECVPKTINFO)
+    lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
+
+    switch (s->family) {
+    case AF_INET:
+        return lls_sockopt_int_lua(L, s->fd, IPPROTO_IP, IP_PKTINFO,
+                                   LUA_TBOOLEAN);
+
+    case AF_INET6:
+        return lls_sockopt_int_lua(L, s->fd, IPPROTO_IPV6, IPV6_RECVPKTINFO,
+                                   LUA_TBOOLEAN);
+
+    default:
+        lua_pushnil(L);
+        errno = EAFNOSUPPORT;
+        lua_errno_new(L, errno, "pktinfo_lua");
+        return 2;
+    }
+
+#else
+    lua_pushnil(L);
+    errno = EOPNOTSUPP;
+    lua_errno_new(L, errno, "pktinfo_lua");
+    return 2;
+
+#endif
+}
+
 // MARK: method
 
 static inline int shutdownfd(lua_State *L, int fd, int how)
@@ -947,20 +1909,100 @@ static inline int closefd(lua_State *L, int fd, int how, int with_shutdown)
     return 2;
 }
 
+/**
+ * release the resources associated with the socket and return the descriptor
+ * that the caller must close.
+ */
+static inline int release(lua_State *L, lls_socket_t *s)
+{
+    int fd = s->fd;
+
+    call_gcfn(L, s);
+    closepipe(L, s);
+    lls_timer_detach(L, s);
+    released(L);
+    s->fd = -1;
+
+    return fd;
+}
+
 static int close_lua(lua_State *L)
 {
     lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
     int how         = (int)lauxh_optinteger(L, 2, -1);
-    int fd          = s->fd;
 
-    if (fd == -1) {
+    if (s->fd == -1) {
         lua_pushboolean(L, 1);
         return 1;
     }
-    call_gcfn(L, s);
-    s->fd = -1;
 
-    return closefd(L, fd, how, !lua_isnoneornil(L, 2));
+    return closefd(L, release(L, s), how, !lua_isnoneornil(L, 2));
+}
+
+static int closescope_lua(lua_State *L)
+{
+    lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
+
+    // ignore the error object passed to the __close metamethod
+    if (s->fd != -1) {
+        close(release(L, s));
+    }
+    return 0;
+}
+
+static int scope_k(lua_State *L, int status, int base)
+{
+    lls_socket_t *s = lua_touserdata(L, 1);
+
+    if (s->fd != -1) {
+        close(release(L, s));
+    }
+    if (status && status != LUA_YIELD) {
+        // rethrow
+        return lua_error(L);
+    }
+    return lua_gettop(L) - base;
+}
+
+#if LUA_VERSION_NUM >= 503
+static int scope_resume(lua_State *L, int status, lua_KContext ctx)
+{
+    return scope_k(L, status, (int)ctx);
+}
+#elif LUA_VERSION_NUM == 502
+static int scope_resume(lua_State *L)
+{
+    int ctx    = 0;
+    int status = lua_getctx(L, &ctx);
+
+    return scope_k(L, status, ctx);
+}
+#endif
+
+/**
+ * call the function with the socket and the rest of arguments, and then
+ * close the socket even if the function throws an error.
+ */
+static int scope_lua(lua_State *L)
+{
+    int top = 0;
+
+    lauxh_checkudata(L, 1, SOCKET_MT);
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+
+    top = lua_gettop(L);
+    lua_pushvalue(L, 2);
+    lua_pushvalue(L, 1);
+    for (int i = 3; i <= top; i++) {
+        lua_pushvalue(L, i);
+    }
+#if LUA_VERSION_NUM >= 502
+    return scope_k(L,
+                   lua_pcallk(L, top - 1, LUA_MULTRET, 0, top, scope_resume),
+                   top);
+#else
+    return scope_k(L, lua_pcall(L, top - 1, LUA_MULTRET, 0), top);
+#endif
 }
 
 static int listen_lua(lua_State *L)
@@ -1029,46 +2071,36 @@ static int acceptfd_lua(lua_State *L)
 static int accept_lua(lua_State *L)
 {
     lls_socket_t *s               = lauxh_checkudata(L, 1, SOCKET_MT);
-    int with_addr                 = lauxh_optboolean(L, 2, 0);
+    int out                       = optaddrout(L, 2);
+    int with_addr                 = 0;
     struct sockaddr_storage saddr = {0};
     socklen_t saddrlen            = sizeof(struct sockaddr_storage);
     struct sockaddr *addr         = NULL;
     socklen_t *addrlen            = NULL;
     int fd                        = 0;
 
+    // the address is returned if with_addr is true or out is specified
+    with_addr = (out != ADDR_NEW) || lauxh_optboolean(L, 2, 0);
     if (with_addr) {
         addr    = (struct sockaddr *)&saddr;
         addrlen = &saddrlen;
     }
     fd = acceptfd(s->fd, addr, addrlen);
     if (fd != -1) {
-        lls_socket_t *cs = lua_newuserdata(L, sizeof(lls_socket_t));
-
-        cs->fd       = fd;
-        cs->family   = s->family;
-        cs->socktype = s->socktype;
-        cs->protocol = s->protocol;
-        cs->gcfunc   = NULL;
-        lauxh_setmetatable(L, SOCKET_MT);
+        newsocket(L, fd, s->family, s->socktype, s->protocol);
         if (with_addr) {
-            struct addrinfo wrap = {.ai_flags     = 0,
-                                    .ai_family    = s->family,
-                                    .ai_socktype  = s->socktype,
-                                    .ai_protocol  = s->protocol,
-                                    .ai_addrlen   = saddrlen,
-                                    .ai_addr      = addr,
-                                    .ai_canonname = NULL,
-                                    .ai_next      = NULL};
             lua_pushnil(L);
             lua_pushnil(L);
-            // push llsocket.addr udata
-            lls_addrinfo_alloc(L, &wrap);
+            pushaddr(L, s, out, 2, addr, saddrlen);
             return 4;
         }
 
         return 1;
     } else if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ||
                errno == ECONNABORTED) {
+        if (canyield(L)) {
+            return waitio(L, lua_gettop(L), "read", accept_lua);
+        }
         lua_pushnil(L);
         lua_pushnil(L);
         lua_pushboolean(L, 1);
@@ -1085,7 +2117,7 @@ static int send_lua(lua_State *L)
 {
     lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
     size_t len      = 0;
-    const char *buf = lauxh_checklstring(L, 2, &len);
+    const char *buf = lls_checkbytes(L, 2, &len);
     int flg         = lauxh_optflags(L, 3);
     ssize_t rv      = 0;
 
@@ -1101,6 +2133,9 @@ static int send_lua(lua_State *L)
     switch (rv) {
     case -1:
         if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            if (canyield(L)) {
+                return waitio(L, lua_gettop(L), "write", send_lua);
+            }
             // again
             lua_pushinteger(L, 0);
             lua_pushnil(L);
@@ -1114,6 +2149,7 @@ static int send_lua(lua_State *L)
         return 2;
 
     default:
+        lls_timer_touch(s, LLS_TOUCH_WRITE);
         lua_pushinteger(L, rv);
         lua_pushnil(L);
         lua_pushboolean(L, len - (size_t)rv);
@@ -1125,7 +2161,7 @@ static int sendto_lua(lua_State *L)
 {
     lls_socket_t *s      = lauxh_checkudata(L, 1, SOCKET_MT);
     size_t len           = 0;
-    const char *buf      = lauxh_checklstring(L, 2, &len);
+    const char *buf      = lls_checkbytes(L, 2, &len);
     lls_addrinfo_t *info = lauxh_checkudata(L, 3, ADDRINFO_MT);
     int flg              = lauxh_optflags(L, 4);
     ssize_t rv           = 0;
@@ -1156,6 +2192,7 @@ static int sendto_lua(lua_State *L)
         return 2;
 
     default:
+        lls_timer_touch(s, LLS_TOUCH_WRITE);
         lua_pushinteger(L, rv);
         lua_pushnil(L);
         lua_pushboolean(L, len - (size_t)rv);
@@ -1163,6 +2200,248 @@ static int sendto_lua(lua_State *L)
     }
 }
 
+static int sendtofrom_lua(lua_State *L)
+{
+#if defined(IP_PKTINFO) && defined(IPV6_PKTINFO)
+    lls_socket_t *s      = lauxh_checkudata(L, 1, SOCKET_MT);
+    size_t len           = 0;
+    const char *buf      = lls_checkbytes(L, 2, &len);
+    lls_addrinfo_t *info = lauxh_checkudata(L, 3, ADDRINFO_MT);
+    lls_addrinfo_t *src  = lauxh_checkudata(L, 4, ADDRINFO_MT);
+    uint32_t ifindex     = lauxh_optuint32(L, 5, 0);
+    int flg              = lauxh_optflags(L, 6);
+    union {
+        struct cmsghdr hdr;
+        unsigned char buf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+    } control;
+    struct iovec iov     = {.iov_base = (void *)buf, .iov_len = len};
+    struct msghdr data   = {.msg_name       = (void *)info->ai.ai_addr,
+                            .msg_namelen    = info->ai.ai_addrlen,
+                            .msg_iov        = &iov,
+                            .msg_iovlen     = 1,
+                            .msg_control    = control.buf,
+                            .msg_controllen = 0,
+                            .msg_flags      = 0};
+    struct cmsghdr *cmsg = &control.hdr;
+    ssize_t rv           = 0;
+
+    // invalid length
+    if (!len) {
+        lua_pushnil(L);
+        errno = EINVAL;
+        lua_errno_new(L, errno, "sendtofrom_lua");
+        return 2;
+    }
+
+    // set the source address and the outgoing interface
+    switch (src->ai.ai_family) {
+    case AF_INET: {
+        struct in_pktinfo pi = {
+            .ipi_ifindex  = (int)ifindex,
+            .ipi_spec_dst = ((struct sockaddr_in *)src->ai.ai_addr)->sin_addr,
+        };
+        data.msg_controllen = CMSG_SPACE(sizeof(pi));
+        cmsg->cmsg_level    = IPPROTO_IP;
+        cmsg->cmsg_type     = IP_PKTINFO;
+        cmsg->cmsg_len      = CMSG_LEN(sizeof(pi));
+        memcpy(CMSG_DATA(cmsg), (void *)&pi, sizeof(pi));
+    } break;
+
+    case AF_INET6: {
+        struct in6_pktinfo pi = {
+            .ipi6_addr    = ((struct sockaddr_in6 *)src->ai.ai_addr)->sin6_addr,
+            .ipi6_ifindex = ifindex,
+        };
+        data.msg_controllen = CMSG_SPACE(sizeof(pi));
+        cmsg->cmsg_level    = IPPROTO_IPV6;
+        cmsg->cmsg_type     = IPV6_PKTINFO;
+        cmsg->cmsg_len      = CMSG_LEN(sizeof(pi));
+        memcpy(CMSG_DATA(cmsg), (void *)&pi, sizeof(pi));
+    } break;
+
+    default:
+        lua_pushnil(L);
+        errno = EAFNOSUPPORT;
+        lua_errno_new(L, errno, "sendtofrom_lua");
+        return 2;
+    }
+
+    rv = sendmsg(s->fd, &data, flg);
+    switch (rv) {
+    case -1:
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            // again
+            lua_pushinteger(L, 0);
+            lua_pushnil(L);
+            lua_pushboolean(L, 1);
+            return 3;
+        }
+        // got error
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "sendmsg");
+        return 2;
+
+    default:
+        lls_timer_touch(s, LLS_TOUCH_WRITE);
+        lua_pushinteger(L, rv);
+        lua_pushnil(L);
+        lua_pushboolean(L, len - (size_t)rv);
+        return 3;
+    }
+
+#else
+    lua_pushnil(L);
+    errno = EOPNOTSUPP;
+    lua_errno_new(L, errno, "sendtofrom_lua");
+    return 2;
+
+#endif
+}
+
+#define SENDMANY_BATCH 64
+
+static inline int sendmany(lls_socket_t *s, lls_mmsghdr_t *msgs,
+                           unsigned int vlen, int flg)
+{
+#if defined(HAVE_SENDMMSG)
+    // lls_mmsghdr_t has the same layout as struct mmsghdr
+    return sendmmsg(s->fd, (struct mmsghdr *)msgs, vlen, flg);
+
+#else
+    int n = 0;
+
+    // send the messages one by one
+    for (; n < (int)vlen; n++) {
+        if (sendmsg(s->fd, &msgs[n].msg_hdr, flg) == -1) {
+            return (n) ? n : -1;
+        }
+    }
+    return n;
+
+#endif
+}
+
+static int sendtomany_lua(lua_State *L)
+{
+    lls_socket_t *s    = lauxh_checkudata(L, 1, SOCKET_MT);
+    size_t len         = 0;
+    const char *buf    = lls_checkbytes(L, 2, &len);
+    size_t plen        = 0;
+    const uint8_t *pkd = NULL;
+    lua_Integer i      = lauxh_optinteger(L, 4, 1);
+    int flg            = lauxh_optflags(L, 5);
+    struct iovec iov   = {.iov_base = (void *)buf, .iov_len = len};
+    size_t pos         = 0;
+    lua_Integer total  = 0;
+    struct sockaddr_storage addrs[SENDMANY_BATCH];
+    size_t offs[SENDMANY_BATCH];
+    lls_mmsghdr_t msgs[SENDMANY_BATCH];
+
+    if (lua_type(L, 3) == LUA_TSTRING) {
+        pkd = (const uint8_t *)lua_tolstring(L, 3, &plen);
+    } else {
+        luaL_checktype(L, 3, LUA_TTABLE);
+    }
+    if (i < 1) {
+        return luaL_argerror(L, 4, "i must be greater than 0");
+    } else if (!len) {
+        // invalid length
+        lua_pushnil(L);
+        errno = EINVAL;
+        lua_errno_new(L, errno, "sendtomany_lua");
+        return 2;
+    }
+
+    // skip the packed addresses before the i-th
+    for (lua_Integer n = 1; pkd && n < i && pos < plen; n++) {
+        pos += (pkd[pos] == 6) ? LLS_PACKED_INET6_LEN : LLS_PACKED_INET_LEN;
+    }
+
+    for (;;) {
+        unsigned int vlen = 0;
+        int rv            = 0;
+
+        // fill the batch with the destinations
+        for (; vlen < SENDMANY_BATCH; vlen++) {
+            struct sockaddr *sa = (struct sockaddr *)&addrs[vlen];
+            socklen_t salen     = 0;
+
+            if (pkd) {
+                size_t n = 0;
+
+                if (pos >= plen) {
+                    break;
+                }
+                n = lls_addr_unpack(pkd + pos, plen - pos, &addrs[vlen],
+                                    &salen);
+                if (!n) {
+                    return luaL_argerror(L, 3,
+                                         "dests must be the packed address "
+                                         "list");
+                }
+                offs[vlen] = pos;
+                pos += n;
+            } else {
+                lls_addrinfo_t *info = NULL;
+
+                lua_rawgeti(L, 3, i + total + vlen);
+                if (lua_isnil(L, -1)) {
+                    lua_pop(L, 1);
+                    break;
+                } else if (!lauxh_isuserdataof(L, -1, ADDRINFO_MT)) {
+                    return luaL_argerror(L, 3,
+                                         "dests must be the list of "
+                                         "llsocket.addrinfo");
+                }
+                // the addrinfo is kept alive by the dests table
+                info  = lua_touserdata(L, -1);
+                sa    = info->ai.ai_addr;
+                salen = info->ai.ai_addrlen;
+                lua_pop(L, 1);
+            }
+            msgs[vlen] = (lls_mmsghdr_t){
+                .msg_hdr = {.msg_name       = (void *)sa,
+                            .msg_namelen    = salen,
+                            .msg_iov        = &iov,
+                            .msg_iovlen     = 1,
+                            .msg_control    = NULL,
+                            .msg_controllen = 0,
+                            .msg_flags      = 0},
+                .msg_len = 0,
+            };
+        }
+        if (!vlen) {
+            break;
+        }
+
+        rv = sendmany(s, msgs, vlen, flg);
+        if (rv == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                // again
+                lua_pushinteger(L, total);
+                lua_pushnil(L);
+                lua_pushboolean(L, 1);
+                return 3;
+            }
+            // got error at the (i + total)-th destination
+            lua_pushnil(L);
+            lua_errno_new(L, errno, "sendmmsg");
+            lua_pushnil(L);
+            lua_pushinteger(L, total);
+            return 4;
+        }
+        lls_timer_touch(s, LLS_TOUCH_WRITE);
+        total += rv;
+        if (pkd && (unsigned int)rv < vlen) {
+            // resume from the first unsent destination
+            pos = offs[rv];
+        }
+    }
+
+    lua_pushinteger(L, total);
+    return 1;
+}
+
 static int sendfd_lua(lua_State *L)
 {
     lls_socket_t *s        = lauxh_checkudata(L, 1, SOCKET_MT);
@@ -1193,7 +2472,7 @@ static int sendfd_lua(lua_State *L)
 
     // set msg_name
     if (info) {
-        data.msg_name    = (void *)&(info->ai.ai_addr);
+        data.msg_name    = (void *)info->ai.ai_addr;
         data.msg_namelen = info->ai.ai_addrlen;
     }
 
@@ -1213,6 +2492,7 @@ static int sendfd_lua(lua_State *L)
         return 2;
 
     default:
+        lls_timer_touch(s, LLS_TOUCH_WRITE);
         lua_pushinteger(L, 0);
         return 1;
     }
@@ -1237,7 +2517,7 @@ static int sendmsg_lua(lua_State *L)
 
     // set msg_name
     if (lmsg->name) {
-        data.msg_name    = (void *)&(lmsg->name->ai_addr);
+        data.msg_name    = (void *)lmsg->name->ai_addr;
         data.msg_namelen = lmsg->name->ai_addrlen;
     }
     // set msg_iov
@@ -1245,6 +2525,11 @@ static int sendmsg_lua(lua_State *L)
         data.msg_iovlen = IOV_MAX;
         len = lua_iovec_setv(lmsg->iov, iov, (int *)&data.msg_iovlen, 0,
                              lmsg->iov->nbyte);
+    } else if (lmsg->buf && lmsg->buf->len) {
+        // refer to the buffer without copying
+        iov[0] = (struct iovec){.iov_base = (void *)lmsg->buf->data,
+                                .iov_len  = lmsg->buf->len};
+        len    = lmsg->buf->len;
     }
     // set msg_control
     if (lmsg->control && lmsg->control->len) {
@@ -1270,6 +2555,7 @@ static int sendmsg_lua(lua_State *L)
         return 2;
 
     default:
+        lls_timer_touch(s, LLS_TOUCH_WRITE);
         lua_pushinteger(L, rv);
         lua_pushnil(L);
         lua_pushboolean(L, len - (size_t)rv);
@@ -1306,6 +2592,7 @@ static int sendfile_lua(lua_State *L)
         lua_errno_new(L, errno, "sendfile_lua");
         return 2;
     } else if ((rv = sendfile(s->fd, fd, &offset, len)) != -1) {
+        lls_timer_touch(s, LLS_TOUCH_WRITE);
         lua_pushinteger(L, rv);
         if (len - (size_t)rv) {
             lua_pushnil(L);
@@ -1344,6 +2631,7 @@ static int sendfile_lua(lua_State *L)
         lua_errno_new(L, errno, "sendfile_lua");
         return 2;
     } else if (sendfile(fd, s->fd, offset, &len, NULL, 0) != -1) {
+        lls_timer_touch(s, LLS_TOUCH_WRITE);
         lua_pushinteger(L, len);
         return 1;
     } else if (errno == EAGAIN || errno == EINTR) {
@@ -1379,6 +2667,7 @@ static int sendfile_lua(lua_State *L)
         lua_errno_new(L, errno, "sendfile_lua");
         return 2;
     } else if (sendfile(fd, s->fd, offset, len, NULL, &nbytes, 0) != -1) {
+        lls_timer_touch(s, LLS_TOUCH_WRITE);
         lua_pushinteger(L, nbytes);
         return 1;
     } else if (errno == EAGAIN || errno == EINTR) {
@@ -1463,6 +2752,7 @@ static int sendfile_lua(lua_State *L)
         return 2;
 
     default:
+        lls_timer_touch(s, LLS_TOUCH_WRITE);
         lua_pushinteger(L, nbytes);
         if (len - (size_t)nbytes) {
             lua_pushnil(L);
@@ -1473,9 +2763,213 @@ static int sendfile_lua(lua_State *L)
     }
 }
 
-#endif
-
-static int recv_lua(lua_State *L)
+#endif
+
+#if defined(HAVE_VMSPLICE) && defined(HAVE_SPLICE)
+
+static inline ssize_t splicepipe(lua_State *L, lls_socket_t *s, int more)
+{
+    ssize_t rv = splice(s->pipefd[0], NULL, s->fd, NULL, s->npipe,
+                        SPLICE_F_MOVE | SPLICE_F_NONBLOCK |
+                            (more ? SPLICE_F_MORE : 0));
+
+    if (rv > 0) {
+        s->npipe -= (size_t)rv;
+        s->spliced += (uint64_t)rv;
+        if (!s->npipe) {
+            // all pages in the pipe have been moved to the send queue
+            putpipe(L, s);
+        }
+    }
+    return rv;
+}
+
+static int vmsplice_lua(lua_State *L)
+{
+    lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
+    size_t len      = 0;
+    const char *buf = NULL;
+    struct iovec iov;
+    ssize_t rv = 0;
+
+    if (!lua_isnoneornil(L, 2)) {
+        buf = lls_checkbytes(L, 2, &len);
+    }
+    // release the messages that have been sent
+    unpinmsg(L, s);
+    sweeplinger(L);
+
+    // flush the remaining data in the pipe before sending a new message
+    if (s->npipe && splicepipe(L, s, len) == -1 && errno != EAGAIN &&
+        errno != EINTR) {
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "splice");
+        return 2;
+    } else if (s->npipe) {
+        // again
+        lua_pushinteger(L, 0);
+        lua_pushnil(L);
+        lua_pushboolean(L, 1);
+        return 3;
+    } else if (!len) {
+        // flushed
+        lua_pushinteger(L, 0);
+        return 1;
+    } else if (len < VMSPLICE_THRESHOLD) {
+        // small message is cheaper to be copied
+        rv = send(s->fd, buf, len, 0);
+    } else if (openpipe(L, s) != 0) {
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "pipe2");
+        return 2;
+    } else {
+        // move the pages of message into the pipe
+        iov = (struct iovec){.iov_base = (void *)buf, .iov_len = len};
+        rv  = vmsplice(s->pipefd[1], &iov, 1, SPLICE_F_NONBLOCK);
+        if (rv > 0) {
+            // the message must be kept until its pages are sent
+            s->npipe = (size_t)rv;
+            pinmsg(L, s, 2);
+            if (splicepipe(L, s, 0) == -1 && errno != EAGAIN &&
+                errno != EINTR) {
+                lua_pushnil(L);
+                lua_errno_new(L, errno, "splice");
+                return 2;
+            }
+        } else {
+            putpipe(L, s);
+        }
+    }
+
+    switch (rv) {
+    case -1:
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            // again
+            lua_pushinteger(L, 0);
+            lua_pushnil(L);
+            lua_pushboolean(L, 1);
+            return 3;
+        }
+        // got error
+        // closed by peer: EPIPE || ECONNRESET
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "vmsplice");
+        return 2;
+
+    default:
+        lls_timer_touch(s, LLS_TOUCH_WRITE);
+        lua_pushinteger(L, rv);
+        if ((len - (size_t)rv) || s->npipe) {
+            lua_pushnil(L);
+            lua_pushboolean(L, 1);
+            return 3;
+        }
+        return 1;
+    }
+}
+
+#else
+
+// vmsplice implements for unsupported platform
+static int vmsplice_lua(lua_State *L)
+{
+    lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
+    size_t len      = 0;
+    const char *buf = NULL;
+    ssize_t rv      = 0;
+
+    if (!lua_isnoneornil(L, 2)) {
+        buf = lls_checkbytes(L, 2, &len);
+    }
+    if (!len) {
+        // nothing to flush
+        lua_pushinteger(L, 0);
+        return 1;
+    }
+
+    rv = send(s->fd, buf, len, 0);
+    switch (rv) {
+    case -1:
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            // again
+            lua_pushinteger(L, 0);
+            lua_pushnil(L);
+            lua_pushboolean(L, 1);
+            return 3;
+        }
+        // got error
+        // closed by peer: EPIPE || ECONNRESET
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "send");
+        return 2;
+
+    default:
+        lls_timer_touch(s, LLS_TOUCH_WRITE);
+        lua_pushinteger(L, rv);
+        if (len - (size_t)rv) {
+            lua_pushnil(L);
+            lua_pushboolean(L, 1);
+            return 3;
+        }
+        return 1;
+    }
+}
+
+#endif
+
+static int recv_lua(lua_State *L)
+{
+    lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
+    lua_Integer len = lauxh_optinteger(L, 2, DEFAULT_RECVSIZE);
+    int flg         = lauxh_optflags(L, 3);
+    char *buf       = NULL;
+    ssize_t rv      = 0;
+    int top         = lua_gettop(L);
+
+    // invalid length
+    if (len <= 0) {
+        lua_pushnil(L);
+        errno = EINVAL;
+        lua_errno_new(L, errno, "recv_lua");
+        return 2;
+    } else if ((rv = checkbudget(L, s, (size_t)len))) {
+        return rv;
+    }
+
+    buf = lua_newuserdata(L, len);
+    rv  = recv(s->fd, buf, (size_t)len, flg);
+    switch (rv) {
+    case -1:
+        // got error
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            if (canyield(L)) {
+                return waitio(L, top, "read", recv_lua);
+            }
+            // again
+            lua_pushnil(L);
+            lua_pushnil(L);
+            lua_pushboolean(L, 1);
+            return 3;
+        }
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "recv");
+        return 2;
+
+    case 0:
+        // close by peer
+        if (s->socktype != SOCK_DGRAM && s->socktype != SOCK_RAW) {
+            return 0;
+        }
+        // fall through
+
+    default:
+        lls_timer_touch(s, LLS_TOUCH_READ);
+        lua_pushlstring(L, buf, rv);
+        return 1;
+    }
+}
+
+static int recvbuf_lua(lua_State *L)
 {
     lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
     lua_Integer len = lauxh_optinteger(L, 2, DEFAULT_RECVSIZE);
@@ -1489,15 +2983,18 @@ static int recv_lua(lua_State *L)
     if (len <= 0) {
         lua_pushnil(L);
         errno = EINVAL;
-        lua_errno_new(L, errno, "recv_lua");
+        lua_errno_new(L, errno, "recvbuf_lua");
         return 2;
+    } else if ((rv = checkbudget(L, s, (size_t)len))) {
+        return rv;
     }
 
-    buf = lua_newuserdata(L, len);
+    buf = lls_budget_alloc(L, ownbudget(L, s), s->budget_ref, (size_t)len);
     rv  = recv(s->fd, buf, (size_t)len, flg);
     switch (rv) {
     case -1:
         // got error
+        lua_settop(L, 0);
         lua_pushnil(L);
         if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
             // again
@@ -1511,12 +3008,28 @@ static int recv_lua(lua_State *L)
     case 0:
         // close by peer
         if (s->socktype != SOCK_DGRAM && s->socktype != SOCK_RAW) {
+            lua_settop(L, 0);
             return 0;
         }
         // fall through
 
     default:
-        lua_pushlstring(L, buf, rv);
+        lls_timer_touch(s, LLS_TOUCH_READ);
+        if ((size_t)rv < (size_t)len) {
+            // the buffer must not hold more bytes than it is accounted, so
+            // copy the received bytes into the storage of exact size
+            char *data = lls_budget_alloc(L, ownbudget(L, s), s->budget_ref,
+                                          (size_t)rv);
+
+            memcpy(data, buf, (size_t)rv);
+            lua_replace(L, -2);
+            buf = data;
+        }
+        // the read buffer is accounted to the budget by the received bytes
+        // while it is held
+        lls_budget_charge(L, -1, (size_t)rv);
+        // use the working buffer as the storage of llsocket.buffer
+        lls_buffer_alloc(L, buf, rv);
         return 1;
     }
 }
@@ -1525,11 +3038,16 @@ static int recvfrom_lua(lua_State *L)
 {
     lls_socket_t *s             = lauxh_checkudata(L, 1, SOCKET_MT);
     lua_Integer len             = lauxh_optinteger(L, 2, DEFAULT_RECVSIZE);
-    int flg                     = lauxh_optflags(L, 3);
+    int out                     = lauxh_isuserdataof(L, 3, PEERMAP_MT) ?
+                                      ADDR_PEER :
+                                      optaddrout(L, 3);
+    // flags follow the output form of the address
+    int flg                     = lauxh_optflags(L, (out != ADDR_NEW) ? 4 : 3);
     socklen_t slen              = sizeof(struct sockaddr_storage);
     struct sockaddr_storage src = {0};
     ssize_t rv                  = 0;
     char *buf                   = NULL;
+    char sbuf[DEFAULT_RECVSIZE];
 
     // invalid length
     if (len <= 0) {
@@ -1537,9 +3055,12 @@ static int recvfrom_lua(lua_State *L)
         errno = EINVAL;
         lua_errno_new(L, errno, "recvfrom_lua");
         return 2;
+    } else if ((rv = checkbudget(L, s, (size_t)len))) {
+        return rv;
     }
 
-    buf = lua_newuserdata(L, len);
+    // use the stack buffer for the small message
+    buf = (len <= DEFAULT_RECVSIZE) ? sbuf : lua_newuserdata(L, len);
     rv = recvfrom(s->fd, buf, (size_t)len, flg, (struct sockaddr *)&src, &slen);
     switch (rv) {
     case -1:
@@ -1562,29 +3083,143 @@ static int recvfrom_lua(lua_State *L)
         // fall-through
 
     default:
+        lls_timer_touch(s, LLS_TOUCH_READ);
         lua_pushlstring(L, buf, rv);
         if (slen > 0) {
             // with addrinfo
-            struct addrinfo wrap = {.ai_flags     = 0,
-                                    .ai_family    = s->family,
-                                    .ai_socktype  = s->socktype,
-                                    .ai_protocol  = s->protocol,
-                                    .ai_addrlen   = slen,
-                                    .ai_addr      = (struct sockaddr *)&src,
-                                    .ai_canonname = NULL,
-                                    .ai_next      = NULL};
-
             lua_pushnil(L);
             lua_pushnil(L);
-            // push llsocket.addr udata
-            lls_addrinfo_alloc(L, &wrap);
-            return 4;
+            return 3 + pushaddr(L, s, out, 3, (struct sockaddr *)&src, slen);
         }
         // no addrinfo
         return 1;
     }
 }
 
+static int recvfromto_lua(lua_State *L)
+{
+#if defined(IP_PKTINFO) && defined(IPV6_PKTINFO)
+    lls_socket_t *s             = lauxh_checkudata(L, 1, SOCKET_MT);
+    lua_Integer len             = lauxh_optinteger(L, 2, DEFAULT_RECVSIZE);
+    int flg                     = lauxh_optflags(L, 3);
+    struct sockaddr_storage src = {0};
+    struct sockaddr_storage dst = {0};
+    socklen_t dstlen            = 0;
+    unsigned int ifindex        = 0;
+    union {
+        struct cmsghdr hdr;
+        unsigned char buf[CMSG_SPACE(sizeof(struct in_pktinfo)) +
+                          CMSG_SPACE(sizeof(struct in6_pktinfo))];
+    } control;
+    struct iovec iov     = {0};
+    struct msghdr data   = {.msg_name       = (void *)&src,
+                            .msg_namelen    = sizeof(src),
+                            .msg_iov        = &iov,
+                            .msg_iovlen     = 1,
+                            .msg_control    = control.buf,
+                            .msg_controllen = sizeof(control.buf),
+                            .msg_flags      = 0};
+    struct cmsghdr *cmsg = NULL;
+    ssize_t rv           = 0;
+    char *buf            = NULL;
+    char sbuf[DEFAULT_RECVSIZE];
+
+    // invalid length
+    if (len <= 0) {
+        lua_pushnil(L);
+        errno = EINVAL;
+        lua_errno_new(L, errno, "recvfromto_lua");
+        return 2;
+    } else if ((rv = checkbudget(L, s, (size_t)len))) {
+        return rv;
+    }
+
+    // use the stack buffer for the small message
+    buf = (len <= DEFAULT_RECVSIZE) ? sbuf : lua_newuserdata(L, len);
+    iov = (struct iovec){.iov_base = buf, .iov_len = (size_t)len};
+    rv  = recvmsg(s->fd, &data, flg);
+    switch (rv) {
+    case -1:
+        // got error
+        lua_pushnil(L);
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            // again
+            lua_pushnil(L);
+            lua_pushboolean(L, 1);
+            return 3;
+        }
+        lua_errno_new(L, errno, "recvmsg");
+        return 2;
+
+    case 0:
+        // close by peer
+        if (s->socktype != SOCK_DGRAM && s->socktype != SOCK_RAW) {
+            return 0;
+        }
+        // fall-through
+
+    default:
+        // find the destination address and the incoming interface
+        for (cmsg = CMSG_FIRSTHDR(&data); cmsg;
+             cmsg = CMSG_NXTHDR(&data, cmsg)) {
+            if (cmsg->cmsg_level == IPPROTO_IP &&
+                cmsg->cmsg_type == IP_PKTINFO) {
+                struct in_pktinfo pi    = {0};
+                struct sockaddr_in *sin = (struct sockaddr_in *)&dst;
+
+                memcpy((void *)&pi, CMSG_DATA(cmsg), sizeof(pi));
+                sin->sin_family = AF_INET;
+                sin->sin_addr   = pi.ipi_addr;
+                dstlen          = sizeof(struct sockaddr_in);
+                ifindex         = (unsigned int)pi.ipi_ifindex;
+                break;
+            } else if (cmsg->cmsg_level == IPPROTO_IPV6 &&
+                       cmsg->cmsg_type == IPV6_PKTINFO) {
+                struct in6_pktinfo pi     = {0};
+                struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&dst;
+
+                memcpy((void *)&pi, CMSG_DATA(cmsg), sizeof(pi));
+                sin6->sin6_family = AF_INET6;
+                sin6->sin6_addr   = pi.ipi6_addr;
+                dstlen            = sizeof(struct sockaddr_in6);
+                ifindex           = pi.ipi6_ifindex;
+                if (IN6_IS_ADDR_LINKLOCAL(&pi.ipi6_addr) ||
+                    IN6_IS_ADDR_MC_LINKLOCAL(&pi.ipi6_addr)) {
+                    // the link-local address is valid only on the interface
+                    sin6->sin6_scope_id = pi.ipi6_ifindex;
+                }
+                break;
+            }
+        }
+
+        lls_timer_touch(s, LLS_TOUCH_READ);
+        lua_pushlstring(L, buf, rv);
+        lua_pushnil(L);
+        lua_pushnil(L);
+        if (data.msg_namelen) {
+            pushaddr(L, s, ADDR_NEW, 0, (struct sockaddr *)&src,
+                     data.msg_namelen);
+        } else {
+            lua_pushnil(L);
+        }
+        if (dstlen) {
+            pushaddr(L, s, ADDR_NEW, 0, (struct sockaddr *)&dst, dstlen);
+            lua_pushinteger(L, ifindex);
+            return 6;
+        }
+        // pktinfo is not enabled
+        return 4;
+    }
+
+#else
+    lua_pushnil(L);
+    errno = EOPNOTSUPP;
+    lua_errno_new(L, errno, "recvfromto_lua");
+    return 2;
+
+#endif
+}
+
 static int recvfd_lua(lua_State *L)
 {
     lls_socket_t *s        = lauxh_checkudata(L, 1, SOCKET_MT);
@@ -1623,6 +3258,7 @@ static int recvfd_lua(lua_State *L)
     default:
         if (ctrl.data.cmsg_level == SOL_SOCKET &&
             ctrl.data.cmsg_type == SCM_RIGHTS) {
+            lls_timer_touch(s, LLS_TOUCH_READ);
             lua_pushinteger(L, *(int *)CMSG_DATA(&ctrl.data));
             return 1;
         } else if (!rv && s->socktype != SOCK_DGRAM &&
@@ -1657,9 +3293,17 @@ static int recvmsg_lua(lua_State *L)
     size_t len                           = 0;
     size_t clen                          = 0;
 
+    // llsocket.buffer is immutable
+    if (lmsg->buf) {
+        lua_pushnil(L);
+        errno = EINVAL;
+        lua_errno_new(L, errno, "recvmsg_lua");
+        return 2;
+    }
+
     // set msg_name
     if (lmsg->name) {
-        data.msg_name    = (void *)&(lmsg->name->ai_addr);
+        data.msg_name    = (void *)lmsg->name->ai_addr;
         data.msg_namelen = sizeof(struct sockaddr_storage);
     }
     // set msg_iov
@@ -1698,6 +3342,13 @@ static int recvmsg_lua(lua_State *L)
             // close by peer
             return 0;
         }
+        if (data.msg_namelen) {
+            // update the source address
+            lls_getuservalue(L, 2, LLS_MSGHDR_UV_NAME);
+            lls_addrinfo_reset(L, -1, data.msg_namelen);
+            lua_pop(L, 1);
+        }
+        lls_timer_touch(s, LLS_TOUCH_READ);
         lua_pushinteger(L, rv);
         return 1;
     }
@@ -1707,7 +3358,7 @@ static int write_lua(lua_State *L)
 {
     lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
     size_t len      = 0;
-    const char *buf = lauxh_checklstring(L, 2, &len);
+    const char *buf = lls_checkbytes(L, 2, &len);
     ssize_t rv      = 0;
 
     // invalid length
@@ -1735,6 +3386,7 @@ static int write_lua(lua_State *L)
         return 2;
 
     default:
+        lls_timer_touch(s, LLS_TOUCH_WRITE);
         lua_pushinteger(L, rv);
         lua_pushnil(L);
         lua_pushboolean(L, len - (size_t)rv);
@@ -1757,6 +3409,8 @@ static int read_lua(lua_State *L)
         errno = EINVAL;
         lua_errno_new(L, errno, "read_lua");
         return 2;
+    } else if ((rv = checkbudget(L, s, (size_t)len))) {
+        return rv;
     }
 
     buf = lua_newuserdata(L, len);
@@ -1783,15 +3437,192 @@ static int read_lua(lua_State *L)
         // fall through
 
     default:
+        lls_timer_touch(s, LLS_TOUCH_READ);
         lua_pushlstring(L, buf, rv);
         return 1;
     }
 }
 
+static int sendall_resume(lua_State *L)
+{
+    lls_socket_t *s = lua_touserdata(L, 1);
+    size_t len      = 0;
+    const char *buf = lls_checkbytes(L, 2, &len);
+    int flg         = (int)lua_tointeger(L, 3);
+    size_t nsent    = (size_t)lua_tointeger(L, 4);
+
+    while (nsent < len) {
+        ssize_t rv = send(s->fd, buf + nsent, len - nsent, flg);
+
+        if (rv != -1) {
+            lls_timer_touch(s, LLS_TOUCH_WRITE);
+            nsent += (size_t)rv;
+            continue;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (canyield(L)) {
+                // keep the number of bytes sent
+                lua_pushinteger(L, nsent);
+                lua_replace(L, 4);
+                return waitio(L, 4, "write", sendall_resume);
+            }
+            // again
+            lua_pushinteger(L, nsent);
+            lua_pushnil(L);
+            lua_pushboolean(L, 1);
+            return 3;
+        }
+        // got error
+        // closed by peer: EPIPE || ECONNRESET
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "send");
+        return 2;
+    }
+
+    lua_pushinteger(L, nsent);
+    lua_pushnil(L);
+    lua_pushboolean(L, 0);
+    return 3;
+}
+
+static int sendall_lua(lua_State *L)
+{
+    size_t len = 0;
+    int flg    = 0;
+
+    lauxh_checkudata(L, 1, SOCKET_MT);
+    lls_checkbytes(L, 2, &len);
+    flg = lauxh_optflags(L, 3);
+
+    // invalid length
+    if (!len) {
+        lua_pushnil(L);
+        errno = EINVAL;
+        lua_errno_new(L, errno, "sendall_lua");
+        return 2;
+    }
+
+    // sock, msg, flg, nsent
+    lua_settop(L, 2);
+    lua_pushinteger(L, flg);
+    lua_pushinteger(L, 0);
+    return sendall_resume(L);
+}
+
+static int readn_resume(lua_State *L)
+{
+    lls_socket_t *s = lua_touserdata(L, 1);
+    size_t len      = (size_t)lua_tointeger(L, 2);
+    int flg         = (int)lua_tointeger(L, 3);
+    char *buf       = lua_touserdata(L, 4);
+    size_t nread    = (size_t)lua_tointeger(L, 5);
+
+    while (nread < len) {
+        ssize_t rv = recv(s->fd, buf + nread, len - nread, flg);
+
+        if (rv > 0) {
+            lls_timer_touch(s, LLS_TOUCH_READ);
+            nread += (size_t)rv;
+            continue;
+        } else if (rv == 0) {
+            // close by peer
+            if (!nread) {
+                return 0;
+            }
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (canyield(L)) {
+                // keep the number of bytes received
+                lua_pushinteger(L, nread);
+                lua_replace(L, 5);
+                return waitio(L, 5, "read", readn_resume);
+            }
+            // again
+            if (nread) {
+                lua_pushlstring(L, buf, nread);
+            } else {
+                lua_pushnil(L);
+            }
+            lua_pushnil(L);
+            lua_pushboolean(L, 1);
+            return 3;
+        }
+        // got error
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "recv");
+        return 2;
+    }
+
+    lua_pushlstring(L, buf, nread);
+    return 1;
+}
+
+static int readn_lua(lua_State *L)
+{
+    lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
+    lua_Integer len = lauxh_checkinteger(L, 2);
+    int flg         = lauxh_optflags(L, 3);
+    int rv          = 0;
+
+    // invalid length
+    if (len <= 0) {
+        lua_pushnil(L);
+        errno = EINVAL;
+        lua_errno_new(L, errno, "readn_lua");
+        return 2;
+    } else if ((rv = checkbudget(L, s, (size_t)len))) {
+        return rv;
+    }
+
+    // sock, len, flg, buf, nread
+    lua_settop(L, 2);
+    lua_pushinteger(L, flg);
+    lua_newuserdata(L, len);
+    lua_pushinteger(L, 0);
+    return readn_resume(L);
+}
+
+// resume the nonblocking connect
+static int connected_lua(lua_State *L)
+{
+    lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
+    int err         = 0;
+    socklen_t len   = sizeof(int);
+
+    struct sockaddr_storage peer;
+
+    if (getsockopt(s->fd, SOL_SOCKET, SO_ERROR, (void *)&err, &len) != 0) {
+        err = errno;
+    } else if (!err) {
+        // resumed before the connection is established
+        len = sizeof(peer);
+        if (getpeername(s->fd, (struct sockaddr *)&peer, &len) != 0) {
+            err = errno;
+            if (err == ENOTCONN) {
+                err = EINPROGRESS;
+            }
+        }
+    }
+
+    if (err == EINPROGRESS && canyield(L)) {
+        return waitio(L, lua_gettop(L), "write", connected_lua);
+    } else if (err) {
+        lua_pushboolean(L, err == EINPROGRESS);
+        lua_errno_new(L, err, "connect");
+        return 2;
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
 static int connect_lua(lua_State *L)
 {
     lls_socket_t *s      = lauxh_checkudata(L, 1, SOCKET_MT);
     lls_addrinfo_t *info = lauxh_checkudata(L, 2, ADDRINFO_MT);
+    int err              = 0;
 
     if (connect(s->fd, info->ai.ai_addr, info->ai.ai_addrlen) == 0) {
         lua_pushboolean(L, 1);
@@ -1804,11 +3635,160 @@ static int connect_lua(lua_State *L)
     }
 
     // true on nonblocking connect
-    lua_pushboolean(L, errno == EINPROGRESS || errno == EALREADY);
-    lua_errno_new(L, errno, "connect");
+    err = errno;
+    addrnotavail(err, &NCONNECT_ADDRNOTAVAIL);
+    if ((err == EINPROGRESS || err == EALREADY) && canyield(L)) {
+        return waitio(L, lua_gettop(L), "write", connected_lua);
+    }
+    lua_pushboolean(L, err == EINPROGRESS || err == EALREADY);
+    lua_errno_new(L, err, "connect");
     return 2;
 }
 
+// size of the working buffer to receive the datagrams from the other peers
+#define STRAY_BUFSIZE 65536
+
+typedef struct {
+    lua_State *L;
+    lls_socket_t *s;
+    // stack index of the list of the datagrams, or 0 if not created yet
+    int idx;
+    int n;
+    char *buf;
+} strays_t;
+
+static ssize_t recvstray(void *arg, int sfd)
+{
+    strays_t *st                = (strays_t *)arg;
+    lua_State *L                = st->L;
+    struct sockaddr_storage src = {0};
+    socklen_t slen              = sizeof(src);
+    ssize_t rv                  = 0;
+
+    if (!st->idx) {
+        // create the list and the working buffer on demand
+        lua_newtable(L);
+        st->idx = lua_gettop(L);
+        st->buf = lua_newuserdata(L, STRAY_BUFSIZE);
+    }
+
+    rv = recvfrom(sfd, st->buf, STRAY_BUFSIZE, MSG_DONTWAIT,
+                  (struct sockaddr *)&src, &slen);
+    if (rv == -1) {
+        return -1;
+    }
+    // push {msg, ai}
+    lua_createtable(L, 2, 0);
+    lua_pushlstring(L, st->buf, (size_t)rv);
+    lua_rawseti(L, -2, 1);
+    pushaddr(L, st->s, ADDR_NEW, 0, (struct sockaddr *)&src, slen);
+    lua_rawseti(L, -2, 2);
+    lua_rawseti(L, st->idx, ++st->n);
+
+    return rv;
+}
+
+lls_socket_t *lls_socket_connectpeer(lua_State *L, lls_socket_t *s,
+                                     const struct sockaddr *peer,
+                                     socklen_t len)
+{
+    strays_t st      = {.L = L, .s = s, .idx = 0, .n = 0, .buf = NULL};
+    int fd           = lls_connectpeer(s->fd, s->protocol, peer, len);
+    lls_socket_t *ps = NULL;
+
+    if (fd == -1) {
+        return NULL;
+    }
+    // the new socket owns the descriptor before any allocation
+    ps = newsocket(L, fd, s->family, s->socktype, s->protocol);
+    lls_drainstrays(fd, peer, len, recvstray, &st);
+    if (st.idx) {
+        // remove the working buffer
+        lua_pop(L, 1);
+    } else {
+        lua_pushnil(L);
+    }
+
+    return ps;
+}
+
+static int connectpeer_lua(lua_State *L)
+{
+    lls_socket_t *s      = lauxh_checkudata(L, 1, SOCKET_MT);
+    lls_addrinfo_t *info = lauxh_checkudata(L, 2, ADDRINFO_MT);
+
+    if (s->socktype != SOCK_DGRAM) {
+        lua_pushnil(L);
+        errno = EOPNOTSUPP;
+        lua_errno_new(L, errno, "connectpeer");
+        return 2;
+    }
+
+    lua_settop(L, 2);
+    if (!lls_socket_connectpeer(L, s, info->ai.ai_addr,
+                                info->ai.ai_addrlen)) {
+        lua_pushnil(L);
+        lua_errno_new(L, errno, "connectpeer");
+        return 2;
+    } else if (lua_isnil(L, -1)) {
+        lua_pop(L, 1);
+        return 1;
+    }
+    // sock, nil, strays
+    lua_pushnil(L);
+    lua_insert(L, -2);
+
+    return 3;
+}
+
+static int connectfrom_lua(lua_State *L)
+{
+    lls_socket_t *s              = lauxh_checkudata(L, 1, SOCKET_MT);
+    lls_addrinfo_t *src          = lauxh_checkudata(L, 2, ADDRINFO_MT);
+    struct sockaddr_storage addr = {0};
+#if defined(IP_BIND_ADDRESS_NO_PORT)
+    int enable = 1;
+#endif
+
+    lauxh_checkudata(L, 3, ADDRINFO_MT);
+    memcpy((void *)&addr, src->ai.ai_addr, src->ai.ai_addrlen);
+    switch (addr.ss_family) {
+    case AF_INET:
+        ((struct sockaddr_in *)&addr)->sin_port = 0;
+        break;
+    case AF_INET6:
+        ((struct sockaddr_in6 *)&addr)->sin6_port = 0;
+        break;
+    default:
+        lua_pushboolean(L, 0);
+        errno = EAFNOSUPPORT;
+        lua_errno_new(L, errno, "connectfrom");
+        return 2;
+    }
+
+#if defined(IP_BIND_ADDRESS_NO_PORT)
+    // defer the allocation of the local port until connect, so that the
+    // same port can be used for the different destinations
+    if (setsockopt(s->fd, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &enable,
+                   sizeof(enable)) != 0) {
+        lua_pushboolean(L, 0);
+        lua_errno_new(L, errno, "setsockopt");
+        return 2;
+    }
+#endif
+    if (bind(s->fd, (struct sockaddr *)&addr, src->ai.ai_addrlen) != 0) {
+        addrnotavail(errno, &NBIND_ADDRNOTAVAIL);
+        lua_pushboolean(L, 0);
+        lua_errno_new(L, errno, "bind");
+        return 2;
+    }
+
+    // connect to the destination
+    lua_settop(L, 3);
+    lua_remove(L, 2);
+    return connect_lua(L);
+}
+
 static inline int select_lua(lua_State *L, int receivable, int sendable)
 {
     lls_socket_t *s        = lauxh_checkudata(L, 1, SOCKET_MT);
@@ -1891,6 +3871,7 @@ static int bind_lua(lua_State *L)
     }
 
     // got error
+    addrnotavail(errno, &NBIND_ADDRNOTAVAIL);
     lua_pushboolean(L, 0);
     lua_errno_new(L, errno, "bind");
     return 2;
@@ -1923,6 +3904,40 @@ static int family_lua(lua_State *L)
     return 1;
 }
 
+static inline int rcvbudget(lua_State *L, lls_budget_t *b, int idx)
+{
+    lua_Integer limit = lauxh_optinteger(L, idx, -1);
+
+    if (!lua_isnoneornil(L, idx) && limit < 0) {
+        return luaL_argerror(L, idx,
+                             "limit must be greater than or equal to 0");
+    }
+    lua_pushinteger(L, b->used);
+    lua_pushinteger(L, b->limit);
+    lua_pushinteger(L, b->nexceeded);
+    if (limit >= 0) {
+        b->limit = (size_t)limit;
+    }
+    return 3;
+}
+
+static int rcvbudget_lua(lua_State *L)
+{
+    lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
+
+    if (lua_isnoneornil(L, 2)) {
+        if (s->budget_ref == LUA_NOREF) {
+            // this socket has never held the read buffer
+            lua_pushinteger(L, 0);
+            lua_pushinteger(L, 0);
+            lua_pushinteger(L, 0);
+            return 3;
+        }
+        return rcvbudget(L, s->budget, 2);
+    }
+    return rcvbudget(L, ownbudget(L, s), 2);
+}
+
 static int fd_lua(lua_State *L)
 {
     lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
@@ -1943,18 +3958,18 @@ static int gc_lua(lua_State *L)
     lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
 
     if (s->fd != -1) {
-        call_gcfn(L, s);
-        close(s->fd);
+        close(release(L, s));
     }
+    lls_timer_detach(L, s);
+    s->budget_ref = lauxh_unref(L, s->budget_ref);
 
     return 0;
 }
 
 static int dup_lua(lua_State *L)
 {
-    lls_socket_t *s  = lauxh_checkudata(L, 1, SOCKET_MT);
-    lls_socket_t *sd = lua_newuserdata(L, sizeof(lls_socket_t));
-    int fd           = dup(s->fd);
+    lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
+    int fd          = dup(s->fd);
 
     if (fd == -1) {
         lua_pushnil(L);
@@ -1967,14 +3982,7 @@ static int dup_lua(lua_State *L)
         return 2;
     }
 
-    *sd = (lls_socket_t){
-        .fd       = fd,
-        .family   = s->family,
-        .socktype = s->socktype,
-        .protocol = s->protocol,
-        .gcfunc   = NULL,
-    };
-    lauxh_setmetatable(L, SOCKET_MT);
+    newsocket(L, fd, s->family, s->socktype, s->protocol);
 
     return 1;
 }
@@ -2026,14 +4034,17 @@ static int unwrap_lua(lua_State *L)
     lls_socket_t *s = lauxh_checkudata(L, 1, SOCKET_MT);
 
     lua_settop(L, 1);
-    call_gcfn(L, s);
+    s->budget_ref = lauxh_unref(L, s->budget_ref);
 
     // remove metatable
     lua_pushnil(L);
     lua_setmetatable(L, -2);
     // return fd and then disable
-    lua_pushinteger(L, s->fd);
-    s->fd = -1;
+    if (s->fd == -1) {
+        lua_pushinteger(L, -1);
+    } else {
+        lua_pushinteger(L, release(L, s));
+    }
 
     return 1;
 }
@@ -2045,23 +4056,23 @@ static int wrap_lua(lua_State *L)
     int fl       = 0;
     struct sockaddr_storage addr;
     socklen_t addrlen = sizeof(struct sockaddr_storage);
-    lls_socket_t *s   = NULL;
+    int socktype      = 0;
     socklen_t typelen = sizeof(int);
+    int protocol      = 0;
 #if defined(SO_PROTOCOL)
     socklen_t protolen = sizeof(int);
 #endif
 
     lua_settop(L, 1);
-    s = lua_newuserdata(L, sizeof(lls_socket_t));
     if (getsockname(fd, (void *)&addr, &addrlen) != 0) {
         lua_pushnil(L);
         lua_errno_new(L, errno, "getsockname");
         return 2;
     } else if (
 #if defined(SO_PROTOCOL)
-        getsockopt(fd, SOL_SOCKET, SO_PROTOCOL, &s->protocol, &protolen) != 0 ||
+        getsockopt(fd, SOL_SOCKET, SO_PROTOCOL, &protocol, &protolen) != 0 ||
 #endif
-        getsockopt(fd, SOL_SOCKET, SO_TYPE, &s->socktype, &typelen) != 0) {
+        getsockopt(fd, SOL_SOCKET, SO_TYPE, &socktype, &typelen) != 0) {
         lua_pushnil(L);
         lua_errno_new(L, errno, "getsockopt");
         return 2;
@@ -2072,26 +4083,19 @@ static int wrap_lua(lua_State *L)
         return 2;
     }
 
-    lauxh_setmetatable(L, SOCKET_MT);
-    s->fd     = fd;
-    s->family = addr.ss_family;
-#if !defined(SO_PROTOCOL)
-    s->protocol = 0;
-#endif
-    s->gcfunc = NULL;
+    newsocket(L, fd, addr.ss_family, socktype, protocol);
 
     return 1;
 }
 
 static int new_lua(lua_State *L)
 {
-    int family      = lauxh_checkinteger(L, 1);
-    int socktype    = lauxh_checkinteger(L, 2);
-    int protocol    = lauxh_optinteger(L, 3, 0);
-    int nonblock    = lauxh_optboolean(L, 4, 0);
-    int fd          = socket(family, socktype, protocol);
-    lls_socket_t *s = NULL;
-    int fl          = 0;
+    int family   = lauxh_checkinteger(L, 1);
+    int socktype = lauxh_checkinteger(L, 2);
+    int protocol = lauxh_optinteger(L, 3, 0);
+    int nonblock = lauxh_optboolean(L, 4, 0);
+    int fd       = socket(family, socktype, protocol);
+    int fl       = 0;
 
     if (fd == -1) {
         lua_pushnil(L);
@@ -2110,25 +4114,16 @@ static int new_lua(lua_State *L)
         return 2;
     }
 
-    s  = lua_newuserdata(L, sizeof(lls_socket_t));
-    *s = (lls_socket_t){
-        .fd       = fd,
-        .family   = family,
-        .socktype = socktype,
-        .protocol = protocol,
-        .gcfunc   = NULL,
-    };
-    lauxh_setmetatable(L, SOCKET_MT);
+    newsocket(L, fd, family, socktype, protocol);
 
     return 1;
 }
 
 static int pair_lua(lua_State *L)
 {
-    int socktype    = (int)lauxh_checkinteger(L, 1);
-    int protocol    = (int)lauxh_optinteger(L, 2, 0);
-    int nonblock    = lauxh_optboolean(L, 3, 0);
-    lls_socket_t *s = NULL;
+    int socktype = (int)lauxh_checkinteger(L, 1);
+    int protocol = (int)lauxh_optinteger(L, 2, 0);
+    int nonblock = lauxh_optboolean(L, 3, 0);
     int fds[2];
 
     if (socketpair(AF_UNIX, socktype, protocol, fds) != 0) {
@@ -2153,15 +4148,7 @@ static int pair_lua(lua_State *L)
             return 2;
         }
 
-        s  = lua_newuserdata(L, sizeof(lls_socket_t));
-        *s = (lls_socket_t){
-            .fd       = fd,
-            .family   = AF_UNIX,
-            .socktype = socktype,
-            .protocol = protocol,
-            .gcfunc   = NULL,
-        };
-        lauxh_setmetatable(L, SOCKET_MT);
+        newsocket(L, fd, AF_UNIX, socktype, protocol);
         lua_rawseti(L, -2, i + 1);
     }
 
@@ -2176,6 +4163,11 @@ static int shutdownfd_lua(lua_State *L)
     return shutdownfd(L, fd, how);
 }
 
+static int global_rcvbudget_lua(lua_State *L)
+{
+    return rcvbudget(L, lls_budget_global(L), 1);
+}
+
 static int closefd_lua(lua_State *L)
 {
     int fd  = (int)lauxh_checkinteger(L, 1);
@@ -2189,9 +4181,10 @@ LUALIB_API int luaopen_llsocket_socket(lua_State *L)
     // create metatable
     if (luaL_newmetatable(L, SOCKET_MT)) {
         struct luaL_Reg mmethod[] = {
-            {"__gc",       gc_lua      },
-            {"__tostring", tostring_lua},
-            {NULL,         NULL        }
+            {"__gc",       gc_lua        },
+            {"__close",    closescope_lua},
+            {"__tostring", tostring_lua  },
+            {NULL,         NULL          }
         };
         struct luaL_Reg method[] = {
             {"addgcfn",         addgcfn_lua        },
@@ -2206,6 +4199,8 @@ LUALIB_API int luaopen_llsocket_socket(lua_State *L)
             {"recvable",        recvable_lua       },
             {"sendable",        sendable_lua       },
             {"connect",         connect_lua        },
+            {"connectpeer",     connectpeer_lua    },
+            {"connectfrom",     connectfrom_lua    },
             {"shutdown",        shutdown_lua       },
             {"close",           close_lua          },
             {"listen",          listen_lua         },
@@ -2213,15 +4208,23 @@ LUALIB_API int luaopen_llsocket_socket(lua_State *L)
             {"acceptfd",        acceptfd_lua       },
             {"send",            send_lua           },
             {"sendto",          sendto_lua         },
+            {"sendtofrom",      sendtofrom_lua     },
+            {"sendtomany",      sendtomany_lua     },
             {"sendfd",          sendfd_lua         },
             {"sendmsg",         sendmsg_lua        },
             {"sendfile",        sendfile_lua       },
+            {"vmsplice",        vmsplice_lua       },
             {"recv",            recv_lua           },
+            {"recvbuf",         recvbuf_lua        },
             {"recvfrom",        recvfrom_lua       },
+            {"recvfromto",      recvfromto_lua     },
             {"recvfd",          recvfd_lua         },
             {"recvmsg",         recvmsg_lua        },
             {"write",           write_lua          },
             {"read",            read_lua           },
+            {"sendall",         sendall_lua        },
+            {"readn",           readn_lua          },
+            {"rcvbudget",       rcvbudget_lua      },
 
  // state
             {"atmark",          atmark_lua         },
@@ -2244,6 +4247,14 @@ LUALIB_API int luaopen_llsocket_socket(lua_State *L)
             {"tcpkeepalive",    tcpkeepalive_lua   },
             {"tcpcork",         tcpcork_lua        },
             {"reuseport",       reuseport_lua      },
+            {"bindnoport",      bindnoport_lua     },
+            {"localportrange",  localportrange_lua },
+            {"mtudiscover",     mtudiscover_lua    },
+            {"mtu",             mtu_lua            },
+            {"maxpayload",      maxpayload_lua     },
+            {"recverr",         recverr_lua        },
+            {"recverror",       recverror_lua      },
+            {"pktinfo",         pktinfo_lua        },
             {"reuseaddr",       reuseaddr_lua      },
             {"broadcast",       broadcast_lua      },
             {"debug",           debug_lua          },
@@ -2299,6 +4310,12 @@ LUALIB_API int luaopen_llsocket_socket(lua_State *L)
     lauxh_pushfn2tbl(L, "pair", pair_lua);
     lauxh_pushfn2tbl(L, "close", closefd_lua);
     lauxh_pushfn2tbl(L, "shutdown", shutdownfd_lua);
+    lauxh_pushfn2tbl(L, "rcvbudget", global_rcvbudget_lua);
+    lauxh_pushfn2tbl(L, "sethook", sethook_lua);
+    lauxh_pushfn2tbl(L, "scope", scope_lua);
+    lauxh_pushfn2tbl(L, "nopen", nopen_lua);
+    lauxh_pushfn2tbl(L, "addrnotavail", addrnotavail_lua);
+    lauxh_pushfn2tbl(L, "onpressure", onpressure_lua);
 
     return 1;
 }
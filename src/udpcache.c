@@ -0,0 +1,514 @@
+/**
+ *  Copyright (C) 2026 Masatoshi Fukunaga
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ *  udpcache.c
+ *  lua-llsocket
+ */
+
+#include "llsocket.h"
+
+#define DEFAULT_SIZE      64
+#define DEFAULT_THRESHOLD 3
+#define MAX_SIZE          65536
+
+// user values of lls_udpcache_t
+#define UV_SOCKET  1
+#define UV_SOCKETS 2
+// datagrams from the other peers received by the connected sockets
+#define UV_STRAYS  3
+#define NUV        3
+
+// end of the list
+#define NIL -1
+
+typedef struct {
+    lls_peerkey_t key;
+    uint32_t hash;
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    // number of datagrams sent to the peer
+    uint64_t nsend;
+    // connected socket, or NULL if the peer is cold
+    lls_socket_t *s;
+    // 1 if the connected socket cannot be created
+    int failed;
+    // chain of the bucket
+    int next;
+    // list of the peers, the least recently used first
+    int lprev;
+    int lnext;
+} lls_udpslot_t;
+
+typedef struct {
+    lls_socket_t *s;
+    // number of peers
+    int len;
+    int size;
+    uint64_t threshold;
+    uint32_t seed;
+    // number of buckets, power of 2
+    uint32_t nbucket;
+    uint64_t hits;
+    uint64_t misses;
+    int free;
+    int lru_head;
+    int lru_tail;
+    // slots and buckets are allocated with the cache
+    lls_udpslot_t *slots;
+    int *buckets;
+} lls_udpcache_t;
+
+static void checkdest(lua_State *L, int idx, lls_peerkey_t *key,
+                      struct sockaddr_storage *addr, socklen_t *len)
+{
+    if (lua_type(L, idx) == LUA_TSTRING) {
+        // result of addrinfo:pack() or the 'packed' address of socket
+        size_t slen     = 0;
+        const char *str = lua_tolstring(L, idx, &slen);
+
+        *len = 0;
+        if (lls_addr_unpack((const uint8_t *)str, slen, addr, len) != slen) {
+            *len = 0;
+        }
+    } else {
+        lls_addrinfo_t *info = lauxh_checkudata(L, idx, ADDRINFO_MT);
+
+        *len = info->ai.ai_addrlen;
+        memcpy(addr, info->ai.ai_addr, info->ai.ai_addrlen);
+    }
+
+    if (!*len || lls_peerkey_init(key, (struct sockaddr *)addr, *len) != 0) {
+        luaL_argerror(L, idx,
+                      "addr must be the packed address or llsocket.addrinfo "
+                      "of AF_INET or AF_INET6");
+    }
+}
+
+/**
+ * close the socket on the top of the stack by its close method.
+ */
+static inline void closetop(lua_State *L)
+{
+    lua_getfield(L, -1, "close");
+    lua_insert(L, -2);
+    lua_call(L, 1, 0);
+}
+
+/**
+ * release the connected socket of the slot.
+ */
+static void release(lua_State *L, lls_udpcache_t *c, int i)
+{
+    if (c->slots[i].s) {
+        c->slots[i].s = NULL;
+        lls_getuservalue(L, 1, UV_SOCKETS);
+        lua_rawgeti(L, -1, i + 1);
+        lua_pushnil(L);
+        lua_rawseti(L, -3, i + 1);
+        lua_replace(L, -2);
+        closetop(L);
+    }
+}
+
+static void evict(lua_State *L, lls_udpcache_t *c, int i)
+{
+    lls_udpslot_t *slot = c->slots + i;
+    int *prev           = c->buckets + (slot->hash & (c->nbucket - 1));
+
+    release(L, c, i);
+    while (*prev != i) {
+        prev = &c->slots[*prev].next;
+    }
+    *prev = slot->next;
+    if (slot->lprev == NIL) {
+        c->lru_head = slot->lnext;
+    } else {
+        c->slots[slot->lprev].lnext = slot->lnext;
+    }
+    if (slot->lnext == NIL) {
+        c->lru_tail = slot->lprev;
+    } else {
+        c->slots[slot->lnext].lprev = slot->lprev;
+    }
+    slot->next = c->free;
+    c->free    = i;
+    c->len--;
+}
+
+static inline void touch(lls_udpcache_t *c, int i)
+{
+    lls_udpslot_t *slot = c->slots + i;
+
+    // move to the tail of the list
+    if (i != c->lru_tail) {
+        if (slot->lprev == NIL) {
+            c->lru_head = slot->lnext;
+        } else {
+            c->slots[slot->lprev].lnext = slot->lnext;
+        }
+        c->slots[slot->lnext].lprev = slot->lprev;
+        slot->lprev                 = c->lru_tail;
+        slot->lnext                 = NIL;
+        c->slots[c->lru_tail].lnext = i;
+        c->lru_tail                 = i;
+    }
+}
+
+/**
+ * return the index of the slot of the peer. the least recently used peer is
+ * evicted if the cache is full.
+ */
+static int lookup(lua_State *L, lls_udpcache_t *c, const lls_peerkey_t *key,
+                  const struct sockaddr_storage *addr, socklen_t addrlen)
+{
+    uint32_t h          = lls_hash(key, sizeof(lls_peerkey_t), c->seed);
+    int *head           = c->buckets + (h & (c->nbucket - 1));
+    lls_udpslot_t *slot = NULL;
+    int i               = *head;
+
+    for (; i != NIL; i = c->slots[i].next) {
+        if (c->slots[i].hash == h &&
+            memcmp(&c->slots[i].key, key, sizeof(lls_peerkey_t)) == 0) {
+            touch(c, i);
+            return i;
+        }
+    }
+
+    if (c->len >= c->size) {
+        evict(L, c, c->lru_head);
+    }
+    i       = c->free;
+    slot    = c->slots + i;
+    c->free = slot->next;
+    *slot   = (lls_udpslot_t){
+        .key     = *key,
+        .hash    = h,
+        .addrlen = addrlen,
+        .nsend   = 0,
+        .s       = NULL,
+        .failed  = 0,
+        .next    = *head,
+        .lprev   = c->lru_tail,
+        .lnext   = NIL,
+    };
+    memcpy(&slot->addr, addr, addrlen);
+    *head = i;
+    if (c->lru_tail == NIL) {
+        c->lru_head = i;
+    } else {
+        c->slots[c->lru_tail].lnext = i;
+    }
+    c->lru_tail = i;
+    c->len++;
+
+    return i;
+}
+
+/**
+ * create the socket that is connected to the peer and shares the local
+ * address of the base socket.
+ */
+static void connectpeer(lua_State *L, lls_udpcache_t *c, int i)
+{
+    lls_udpslot_t *slot = c->slots + i;
+
+    slot->s = lls_socket_connectpeer(
+        L, c->s, (struct sockaddr *)&slot->addr, slot->addrlen);
+    if (!slot->s) {
+        // use sendto for this peer unless the base socket is not bound yet,
+        // it will be bound by sendto
+        slot->failed = (errno != EINVAL);
+        return;
+    }
+
+    if (!lua_isnil(L, -1)) {
+        // keep the datagrams from the other peers for c:strays()
+        lls_getuservalue(L, 1, UV_STRAYS);
+        if (lua_isnil(L, -1)) {
+            lua_pop(L, 1);
+            lua_pushvalue(L, -1);
+            lls_setuservalue(L, 1, UV_STRAYS);
+        } else {
+            int len = (int)lauxh_rawlen(L, -2);
+            int n   = (int)lauxh_rawlen(L, -1);
+
+            for (int j = 1; j <= len; j++) {
+                lua_rawgeti(L, -2, j);
+                lua_rawseti(L, -2, ++n);
+            }
+            lua_pop(L, 1);
+        }
+    }
+    lua_pop(L, 1);
+
+    lls_getuservalue(L, 1, UV_SOCKETS);
+    lua_insert(L, -2);
+    lua_rawseti(L, -2, i + 1);
+    lua_pop(L, 1);
+}
+
+static int send_lua(lua_State *L)
+{
+    lls_udpcache_t *c            = lauxh_checkudata(L, 1, UDPCACHE_MT);
+    size_t len                   = 0;
+    const char *buf              = lls_checkbytes(L, 2, &len);
+    struct sockaddr_storage addr = {0};
+    socklen_t addrlen            = 0;
+    lls_peerkey_t key            = {0};
+    int flg                      = lauxh_optflags(L, 4);
+    lls_udpslot_t *slot          = NULL;
+    ssize_t rv                   = 0;
+    int i                        = 0;
+
+    checkdest(L, 3, &key, &addr, &addrlen);
+    // invalid length
+    if (!len) {
+        lua_pushnil(L);
+        errno = EINVAL;
+        lua_errno_new(L, errno, "send_lua");
+        return 2;
+    }
+
+    i    = lookup(L, c, &key, &addr, addrlen);
+    slot = c->slots + i;
+    slot->nsend++;
+    if (slot->s && slot->s->fd == -1) {
+        // closed by the caller
+        release(L, c, i);
+        slot->nsend = 1;
+    } else if (!slot->s && !slot->failed && slot->nsend >= c->threshold) {
+        connectpeer(L, c, i);
+    }
+
+    if (slot->s) {
+        c->hits++;
+        rv = send(slot->s->fd, buf, len, flg);
+        if (rv == -1 && errno == ECONNREFUSED) {
+            // the error of the previous datagram is reported by the connected
+            // socket, but sendto does not report it
+            rv = send(slot->s->fd, buf, len, flg);
+        }
+        if (rv > 0) {
+            lls_timer_touch(slot->s, LLS_TOUCH_WRITE);
+        }
+    } else {
+        c->misses++;
+        rv = sendto(c->s->fd, buf, len, flg, (struct sockaddr *)&addr,
+                    addrlen);
+    }
+
+    switch (rv) {
+    case -1:
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            // again
+            lua_pushinteger(L, 0);
+            lua_pushnil(L);
+            lua_pushboolean(L, 1);
+            return 3;
+        }
+        // got error
+        lua_pushnil(L);
+        lua_errno_new(L, errno, slot->s ? "send" : "sendto");
+        return 2;
+
+    default:
+        lls_timer_touch(c->s, LLS_TOUCH_WRITE);
+        lua_pushinteger(L, rv);
+        lua_pushnil(L);
+        lua_pushboolean(L, len - (size_t)rv);
+        return 3;
+    }
+}
+
+static int sockets_lua(lua_State *L)
+{
+    lls_udpcache_t *c = lauxh_checkudata(L, 1, UDPCACHE_MT);
+    int n             = 0;
+
+    lua_settop(L, 1);
+    lls_getuservalue(L, 1, UV_SOCKETS);
+    lua_newtable(L);
+    for (int i = c->lru_head; i != NIL; i = c->slots[i].lnext) {
+        if (c->slots[i].s) {
+            lua_rawgeti(L, 2, i + 1);
+            lua_rawseti(L, 3, ++n);
+        }
+    }
+
+    return 1;
+}
+
+static int strays_lua(lua_State *L)
+{
+    lauxh_checkudata(L, 1, UDPCACHE_MT);
+
+    lua_settop(L, 1);
+    lls_getuservalue(L, 1, UV_STRAYS);
+    if (lua_isnil(L, -1)) {
+        lua_newtable(L);
+        return 1;
+    }
+    // hand over the list to the caller
+    lua_pushnil(L);
+    lls_setuservalue(L, 1, UV_STRAYS);
+
+    return 1;
+}
+
+static int stats_lua(lua_State *L)
+{
+    lls_udpcache_t *c = lauxh_checkudata(L, 1, UDPCACHE_MT);
+
+    lua_pushinteger(L, (lua_Integer)c->hits);
+    lua_pushinteger(L, (lua_Integer)c->misses);
+
+    return 2;
+}
+
+static int close_lua(lua_State *L)
+{
+    lls_udpcache_t *c = lauxh_checkudata(L, 1, UDPCACHE_MT);
+
+    lua_settop(L, 1);
+    while (c->lru_head != NIL) {
+        evict(L, c, c->lru_head);
+    }
+
+    return 0;
+}
+
+static int len_lua(lua_State *L)
+{
+    lls_udpcache_t *c = lauxh_checkudata(L, 1, UDPCACHE_MT);
+
+    lua_pushinteger(L, c->len);
+
+    return 1;
+}
+
+static int tostring_lua(lua_State *L)
+{
+    lua_pushfstring(L, UDPCACHE_MT ": %p", lua_touserdata(L, 1));
+    return 1;
+}
+
+static int new_lua(lua_State *L)
+{
+    lls_socket_t *s       = lauxh_checkudata(L, 1, SOCKET_MT);
+    lua_Integer size      = lauxh_optinteger(L, 2, DEFAULT_SIZE);
+    lua_Integer threshold = lauxh_optinteger(L, 3, DEFAULT_THRESHOLD);
+    uint32_t nbucket      = 1;
+    size_t usize          = 0;
+    lls_udpcache_t *c     = NULL;
+
+    if (s->socktype != SOCK_DGRAM ||
+        (s->family != AF_INET && s->family != AF_INET6)) {
+        return luaL_argerror(L, 1,
+                             "sock must be AF_INET or AF_INET6 SOCK_DGRAM "
+                             "socket");
+    } else if (size < 1 || size > MAX_SIZE) {
+        return luaL_argerror(L, 2, "size must be between 1 and 65536");
+    } else if (threshold < 1) {
+        return luaL_argerror(L, 3, "threshold must be greater than 0");
+    }
+    while (nbucket < (uint32_t)size) {
+        nbucket <<= 1;
+    }
+
+    lua_settop(L, 1);
+    usize = sizeof(lls_udpcache_t) + sizeof(lls_udpslot_t) * (size_t)size +
+            sizeof(int) * nbucket;
+    c     = lls_newuserdata(L, usize, NUV);
+    *c    = (lls_udpcache_t){
+        .s         = s,
+        .len       = 0,
+        .size      = (int)size,
+        .threshold = (uint64_t)threshold,
+        .seed      = (uint32_t)(uintptr_t)c ^ (uint32_t)time(NULL),
+        .nbucket   = nbucket,
+        .hits      = 0,
+        .misses    = 0,
+        .free      = 0,
+        .lru_head  = NIL,
+        .lru_tail  = NIL,
+        .slots     = (lls_udpslot_t *)(c + 1),
+        .buckets   = NULL,
+    };
+    c->buckets = (int *)(c->slots + size);
+    for (int i = 0; i < (int)size; i++) {
+        c->slots[i].next = (i + 1 < size) ? i + 1 : NIL;
+    }
+    for (uint32_t i = 0; i < nbucket; i++) {
+        c->buckets[i] = NIL;
+    }
+    lua_pushvalue(L, 1);
+    lls_setuservalue(L, -2, UV_SOCKET);
+    // the connected sockets are held by the array part of the table
+    lua_createtable(L, (int)size, 0);
+    lls_setuservalue(L, -2, UV_SOCKETS);
+    lauxh_setmetatable(L, UDPCACHE_MT);
+
+    return 1;
+}
+
+LUALIB_API int luaopen_llsocket_udpcache(lua_State *L)
+{
+    // create metatable
+    if (luaL_newmetatable(L, UDPCACHE_MT)) {
+        struct luaL_Reg mmethod[] = {
+            {"__tostring", tostring_lua},
+            {"__len",      len_lua     },
+            {NULL,         NULL        }
+        };
+        struct luaL_Reg method[] = {
+            {"len",     len_lua    },
+            {"send",    send_lua   },
+            {"sockets", sockets_lua},
+            {"strays",  strays_lua },
+            {"stats",   stats_lua  },
+            {"close",   close_lua  },
+            {NULL,      NULL       }
+        };
+        struct luaL_Reg *ptr = mmethod;
+
+        // metamethods
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        // methods
+        lua_pushstring(L, "__index");
+        lua_newtable(L);
+        ptr = method;
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        lua_rawset(L, -3);
+    }
+    lua_pop(L, 1);
+
+    // create module table
+    lua_newtable(L);
+    lauxh_pushfn2tbl(L, "new", new_lua);
+
+    return 1;
+}
@@ -0,0 +1,459 @@
+/**
+ *  Copyright (C) 2026 Masatoshi Fukunaga
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ *  wheel.c
+ *  lua-llsocket
+ */
+
+#include "llsocket.h"
+
+#define SLOT_MASK (LLS_WHEEL_SLOTS - 1)
+// number of ticks that can be scheduled
+#define MAX_DELTA ((uint64_t)1 << (LLS_WHEEL_BITS * LLS_WHEEL_LEVELS))
+
+static inline uint64_t getmsec(void)
+{
+    struct timespec ts = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static inline void link_timer(lls_timer_t **head, lls_timer_t *t)
+{
+    t->pprev = head;
+    t->next  = *head;
+    if (*head) {
+        (*head)->pprev = &t->next;
+    }
+    *head = t;
+}
+
+static inline void unlink_timer(lls_wheel_t *w, lls_timer_t *t)
+{
+    if (t->pprev) {
+        *t->pprev = t->next;
+        if (t->next) {
+            t->next->pprev = t->pprev;
+        }
+        t->pprev = NULL;
+        t->next  = NULL;
+        if (t->expire) {
+            // removed from the wheel slot
+            w->nsched--;
+            t->expire = 0;
+        }
+    }
+}
+
+static inline uint64_t deadline(lls_timer_t *t, const char **reason)
+{
+    uint64_t d = UINT64_MAX;
+
+    if (t->idle && t->idle_at + t->idle < d) {
+        d       = t->idle_at + t->idle;
+        *reason = "idle";
+    }
+    if (t->rdtimeo && t->read_at + t->rdtimeo < d) {
+        d       = t->read_at + t->rdtimeo;
+        *reason = "read";
+    }
+    if (t->wrtimeo && t->write_at + t->wrtimeo < d) {
+        d       = t->write_at + t->wrtimeo;
+        *reason = "write";
+    }
+    return d;
+}
+
+static void schedule(lls_wheel_t *w, lls_timer_t *t, uint64_t expire)
+{
+    uint64_t delta = 0;
+    int lv         = 0;
+
+    if (expire == UINT64_MAX) {
+        // no timeouts
+        return;
+    } else if (expire <= w->cur) {
+        link_timer(&w->expired, t);
+        return;
+    }
+
+    delta = expire - w->cur;
+    if (delta >= MAX_DELTA) {
+        // it will be rescheduled when the slot is expired
+        delta  = MAX_DELTA - 1;
+        expire = w->cur + delta;
+    }
+    while (delta >> (LLS_WHEEL_BITS * (lv + 1))) {
+        lv++;
+    }
+    link_timer(&w->slots[lv][(expire >> (LLS_WHEEL_BITS * lv)) & SLOT_MASK], t);
+    t->expire = expire;
+    w->nsched++;
+}
+
+static void reschedule(lls_wheel_t *w, lls_timer_t **head, int recheck)
+{
+    lls_timer_t *t = *head;
+
+    *head = NULL;
+    while (t) {
+        lls_timer_t *next  = t->next;
+        uint64_t expire    = t->expire;
+        const char *reason = NULL;
+
+        t->pprev  = NULL;
+        t->next   = NULL;
+        t->expire = 0;
+        w->nsched--;
+        if (recheck) {
+            // the deadline may be extended by the activities
+            expire = deadline(t, &reason);
+        }
+        schedule(w, t, expire);
+        t = next;
+    }
+}
+
+static void advance(lls_wheel_t *w, uint64_t to)
+{
+    if (to <= w->cur) {
+        return;
+    } else if (to - w->cur >= MAX_DELTA) {
+        // all scheduled timers are expired
+        w->cur = to;
+        for (int lv = 0; lv < LLS_WHEEL_LEVELS; lv++) {
+            for (int i = 0; i < LLS_WHEEL_SLOTS; i++) {
+                reschedule(w, &w->slots[lv][i], 1);
+            }
+        }
+        return;
+    }
+
+    while (w->cur < to) {
+        if (!w->nsched) {
+            w->cur = to;
+            return;
+        }
+        w->cur++;
+        // cascade the timers of the upper levels
+        for (int lv = 1; lv < LLS_WHEEL_LEVELS; lv++) {
+            int bits = LLS_WHEEL_BITS * lv;
+
+            if (w->cur & (((uint64_t)1 << bits) - 1)) {
+                break;
+            }
+            reschedule(w, &w->slots[lv][(w->cur >> bits) & SLOT_MASK], 0);
+        }
+        reschedule(w, &w->slots[0][w->cur & SLOT_MASK], 1);
+    }
+}
+
+static void detach(lua_State *L, lls_wheel_t *w, lls_timer_t *t)
+{
+    unlink_timer(w, t);
+    // remove from the least recently active list
+    if (t->lprev) {
+        t->lprev->lnext = t->lnext;
+    } else {
+        w->lru_head = t->lnext;
+    }
+    if (t->lnext) {
+        t->lnext->lprev = t->lprev;
+    } else {
+        w->lru_tail = t->lprev;
+    }
+    w->ntimer--;
+    t->sock->timer = NULL;
+    lauxh_unref(L, t->ref);
+    free(t);
+}
+
+void lls_timer_detach(lua_State *L, lls_socket_t *s)
+{
+    if (s->timer) {
+        detach(L, s->timer->wheel, s->timer);
+    }
+}
+
+static int expired_lua(lua_State *L)
+{
+    lls_wheel_t *w    = lauxh_checkudata(L, 1, WHEEL_MT);
+    lua_Integer now   = lauxh_optinteger(L, 2, -1);
+    lua_Integer limit = lauxh_optinteger(L, 3, 0);
+    int n             = 0;
+
+    if (lua_isnoneornil(L, 2)) {
+        now = (lua_Integer)getmsec();
+    } else if (now < 0) {
+        return luaL_argerror(L, 2, "now must be greater than or equal to 0");
+    }
+
+    lua_settop(L, 1);
+    advance(w, (uint64_t)now / w->msec);
+    lua_newtable(L);
+    lua_newtable(L);
+    while (w->expired && (limit <= 0 || n < limit)) {
+        lls_timer_t *t     = w->expired;
+        const char *reason = NULL;
+        uint64_t d         = deadline(t, &reason);
+
+        unlink_timer(w, t);
+        if (d > w->cur) {
+            // touched after expired
+            schedule(w, t, d);
+            continue;
+        }
+        n++;
+        lauxh_pushref(L, t->ref);
+        lua_rawseti(L, 2, n);
+        lua_pushstring(L, reason);
+        lua_rawseti(L, 3, n);
+        detach(L, w, t);
+    }
+
+    return 2;
+}
+
+static int evict_lua(lua_State *L)
+{
+    lls_wheel_t *w = lauxh_checkudata(L, 1, WHEEL_MT);
+    lua_Integer n  = lauxh_optinteger(L, 2, 1);
+
+    lua_settop(L, 1);
+    lua_newtable(L);
+    for (int i = 1; i <= n && w->lru_head; i++) {
+        lauxh_pushref(L, w->lru_head->ref);
+        lua_rawseti(L, 2, i);
+        detach(L, w, w->lru_head);
+    }
+
+    return 1;
+}
+
+static int touch_lua(lua_State *L)
+{
+    lls_wheel_t *w  = lauxh_checkudata(L, 1, WHEEL_MT);
+    lls_socket_t *s = lauxh_checkudata(L, 2, SOCKET_MT);
+
+    if (s->timer && s->timer->wheel == w) {
+        lls_timer_touch(s, LLS_TOUCH_READ | LLS_TOUCH_WRITE);
+        lua_pushboolean(L, 1);
+        return 1;
+    }
+    lua_pushboolean(L, 0);
+    return 1;
+}
+
+static int detach_lua(lua_State *L)
+{
+    lls_wheel_t *w  = lauxh_checkudata(L, 1, WHEEL_MT);
+    lls_socket_t *s = lauxh_checkudata(L, 2, SOCKET_MT);
+
+    if (s->timer && s->timer->wheel == w) {
+        detach(L, w, s->timer);
+        lua_pushboolean(L, 1);
+        return 1;
+    }
+    lua_pushboolean(L, 0);
+    return 1;
+}
+
+static inline uint64_t msec2tick(lls_wheel_t *w, lua_Integer msec)
+{
+    // round up to the tick
+    return ((uint64_t)msec + w->msec - 1) / w->msec;
+}
+
+static int attach_lua(lua_State *L)
+{
+    lls_wheel_t *w      = lauxh_checkudata(L, 1, WHEEL_MT);
+    lls_socket_t *s     = lauxh_checkudata(L, 2, SOCKET_MT);
+    lua_Integer idle    = lauxh_checkinteger(L, 3);
+    lua_Integer rdtimeo = lauxh_optinteger(L, 4, 0);
+    lua_Integer wrtimeo = lauxh_optinteger(L, 5, 0);
+    lls_timer_t *t      = s->timer;
+    const char *reason  = NULL;
+    int evicted         = 0;
+
+    if (idle < 0) {
+        return luaL_argerror(L, 3, "idle must be greater than or equal to 0");
+    } else if (rdtimeo < 0) {
+        return luaL_argerror(L, 4,
+                             "rdtimeo must be greater than or equal to 0");
+    } else if (wrtimeo < 0) {
+        return luaL_argerror(L, 5,
+                             "wrtimeo must be greater than or equal to 0");
+    } else if (t && t->wheel != w) {
+        // attached to another wheel
+        lua_pushboolean(L, 0);
+        lua_errno_new(L, EALREADY, "attach_lua");
+        return 2;
+    }
+
+    lua_settop(L, 2);
+    if (t) {
+        unlink_timer(w, t);
+    } else {
+        if (w->maxconn && w->ntimer >= w->maxconn) {
+            // evict the least recently active socket
+            lauxh_pushref(L, w->lru_head->ref);
+            detach(L, w, w->lru_head);
+            evicted = 1;
+        }
+
+        t = malloc(sizeof(lls_timer_t));
+        if (!t) {
+            lua_pushboolean(L, 0);
+            lua_errno_new(L, errno, "malloc");
+            return 2;
+        }
+        *t = (lls_timer_t){
+            .pprev    = NULL,
+            .next     = NULL,
+            .lprev    = w->lru_tail,
+            .lnext    = NULL,
+            .wheel    = w,
+            .sock     = s,
+            .ref      = lauxh_refat(L, 2),
+            .idle_at  = w->cur,
+            .read_at  = w->cur,
+            .write_at = w->cur,
+            .expire   = 0,
+        };
+        // append to the least recently active list
+        if (w->lru_tail) {
+            w->lru_tail->lnext = t;
+        } else {
+            w->lru_head = t;
+        }
+        w->lru_tail = t;
+        w->ntimer++;
+        s->timer = t;
+    }
+    t->idle    = msec2tick(w, idle);
+    t->rdtimeo = msec2tick(w, rdtimeo);
+    t->wrtimeo = msec2tick(w, wrtimeo);
+    lls_timer_touch(s, LLS_TOUCH_READ | LLS_TOUCH_WRITE);
+    schedule(w, t, deadline(t, &reason));
+
+    lua_pushboolean(L, 1);
+    if (evicted) {
+        lua_pushnil(L);
+        lua_pushvalue(L, 3);
+        return 3;
+    }
+    return 1;
+}
+
+static int len_lua(lua_State *L)
+{
+    lls_wheel_t *w = lauxh_checkudata(L, 1, WHEEL_MT);
+
+    lua_pushinteger(L, w->ntimer);
+
+    return 1;
+}
+
+static int tostring_lua(lua_State *L)
+{
+    lua_pushfstring(L, WHEEL_MT ": %p", lua_touserdata(L, 1));
+    return 1;
+}
+
+static int gc_lua(lua_State *L)
+{
+    lls_wheel_t *w = lauxh_checkudata(L, 1, WHEEL_MT);
+
+    while (w->lru_head) {
+        detach(L, w, w->lru_head);
+    }
+
+    return 0;
+}
+
+static int new_lua(lua_State *L)
+{
+    lua_Integer msec    = lauxh_checkinteger(L, 1);
+    lua_Integer maxconn = lauxh_optinteger(L, 2, 0);
+    lls_wheel_t *w      = NULL;
+
+    if (msec <= 0) {
+        return luaL_argerror(L, 1, "msec must be greater than 0");
+    } else if (maxconn < 0) {
+        return luaL_argerror(L, 2,
+                             "maxconn must be greater than or equal to 0");
+    }
+
+    w = lua_newuserdata(L, sizeof(lls_wheel_t));
+    memset(w, 0, sizeof(lls_wheel_t));
+    w->msec    = (uint64_t)msec;
+    w->cur     = getmsec() / w->msec;
+    w->maxconn = (size_t)maxconn;
+    lauxh_setmetatable(L, WHEEL_MT);
+
+    return 1;
+}
+
+LUALIB_API int luaopen_llsocket_wheel(lua_State *L)
+{
+    // create metatable
+    if (luaL_newmetatable(L, WHEEL_MT)) {
+        struct luaL_Reg mmethod[] = {
+            {"__gc",       gc_lua      },
+            {"__tostring", tostring_lua},
+            {"__len",      len_lua     },
+            {NULL,         NULL        }
+        };
+        struct luaL_Reg method[] = {
+            {"len",     len_lua    },
+            {"attach",  attach_lua },
+            {"detach",  detach_lua },
+            {"touch",   touch_lua  },
+            {"expired", expired_lua},
+            {"evict",   evict_lua  },
+            {NULL,      NULL       }
+        };
+        struct luaL_Reg *ptr = mmethod;
+
+        // metamethods
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        // methods
+        lua_pushstring(L, "__index");
+        lua_newtable(L);
+        ptr = method;
+        do {
+            lauxh_pushfn2tbl(L, ptr->name, ptr->func);
+            ptr++;
+        } while (ptr->name);
+        lua_rawset(L, -3);
+    }
+    lua_pop(L, 1);
+
+    // create module table
+    lua_newtable(L);
+    lauxh_pushfn2tbl(L, "new", new_lua);
+
+    return 1;
+}
@@ -1,5 +1,7 @@
 local testcase = require('testcase')
 local llsocket = require('llsocket')
+local timer = require('testcase.timer')
+local errno = require('errno')
 local addrinfo = llsocket.addrinfo
 
 function testcase.inet()
@@ -26,6 +28,10 @@ function testcase.inet()
     -- test that returns ai_addr.sin_addr
     assert.equal(ai:addr(), host)
 
+    -- test that returns the memoized ai_addr.sin_addr
+    collectgarbage('collect')
+    assert.equal(ai:addr(), host)
+
     -- test that returns ai_addr.sin_port
     assert.equal(ai:port(), port)
 
@@ -101,6 +107,112 @@ function testcase.inet6()
     assert.match(tostring(ai), '^llsocket.addrinfo:', false)
 end
 
+function testcase.parse()
+    -- test that detect the address family from the literal
+    for _, v in ipairs({
+        {
+            '127.0.0.1',
+            llsocket.AF_INET,
+            '127.0.0.1',
+        },
+        {
+            '::1',
+            llsocket.AF_INET6,
+            '::1',
+        },
+        {
+            '::ffff:10.0.0.1',
+            llsocket.AF_INET6,
+            '::ffff:10.0.0.1',
+        },
+        {
+            '2001:DB8:0:0:0:0:0:1',
+            llsocket.AF_INET6,
+            '2001:db8::1',
+        },
+    }) do
+        local ai = assert(addrinfo.parse(v[1], 8080, llsocket.SOCK_DGRAM))
+        assert.equal(ai:family(), v[2])
+        assert.equal(ai:addr(), v[3])
+        assert.equal(ai:port(), 8080)
+        assert.equal(ai:socktype(), llsocket.SOCK_DGRAM)
+    end
+
+    -- test that parse the numeric zone index
+    local ai = assert(addrinfo.parse('fe80::1%1'))
+    assert.equal(ai:family(), llsocket.AF_INET6)
+    assert.equal(ai:port(), 0)
+
+    -- test that returns EINVAL if not an address literal
+    for _, v in ipairs({
+        'localhost',
+        '',
+        '1.2.3',
+        '01.2.3.4',
+        '256.0.0.1',
+        '1::2::3',
+        '1:2:3:4:5:6:7:8:9',
+        'fe80::1%',
+    }) do
+        local err
+        ai, err = addrinfo.parse(v)
+        assert.is_nil(ai)
+        assert.equal(err.type, errno.EINVAL)
+    end
+
+    -- test that inet and inet6 use the same parser
+    ai = assert(addrinfo.inet6('fe80::1%1', 80))
+    assert.equal(ai:port(), 80)
+    ai = addrinfo.inet('::1')
+    assert.is_nil(ai)
+end
+
+function testcase.pack_unpack()
+    -- test that encode the address into the canonical binary string
+    local ai4 = assert(addrinfo.inet('192.0.2.1', 0x1234, llsocket.SOCK_DGRAM))
+    local bin4 = assert(ai4:pack())
+    assert.equal(bin4, string.char(4, 0x12, 0x34, 192, 0, 2, 1))
+    local ai6 = assert(addrinfo.inet6('2001:db8::1%3', 443))
+    local bin6 = assert(ai6:pack())
+    assert.equal(#bin6, 23)
+    assert.equal(bin6:sub(-4), '\0\0\0\3')
+
+    -- test that decode the packed address
+    local ai = assert(addrinfo.unpack(bin4, llsocket.SOCK_DGRAM))
+    assert.is_true(ai == ai4)
+    assert.equal(ai:addr(), '192.0.2.1')
+    assert.equal(ai:port(), 0x1234)
+    assert.equal(ai:socktype(), llsocket.SOCK_DGRAM)
+    ai = assert(addrinfo.unpack(bin6))
+    assert.is_true(ai == ai6)
+
+    -- test that decode the list of packed addresses
+    local ais = assert(addrinfo.unpackmany(bin6 .. bin4 .. bin4))
+    assert.equal(#ais, 3)
+    assert.is_true(ais[1] == ai6)
+    assert.is_true(ais[2] == ai4)
+    assert.is_true(ais[3] == ai4)
+    ais = assert(addrinfo.unpackmany(''))
+    assert.equal(#ais, 0)
+
+    -- test that returns EINVAL with malformed data
+    for _, bin in ipairs({
+        '',
+        bin4 .. '\0',
+        bin6:sub(1, -2),
+        '\5' .. bin4:sub(2),
+    }) do
+        local _, err = addrinfo.unpack(bin)
+        assert.equal(err.type, errno.EINVAL)
+    end
+    local _, err = addrinfo.unpackmany(bin4 .. bin6:sub(1, -2))
+    assert.equal(err.type, errno.EINVAL)
+
+    -- test that returns EAFNOSUPPORT with unix domain address
+    _, err = assert(addrinfo.unix('/tmp/foo')):pack()
+    assert.equal(err.type, errno.EAFNOSUPPORT)
+end
+
 function testcase.unix()
     local pathname = './test.sock'
 
@@ -207,3 +319,91 @@ function testcase.getaddrinfo()
     assert(err, 'getaddrinfo() does not throws error')
     assert.match(err, '#5 .+integer expected', false)
 end
+
+function testcase.cache()
+    -- test that the cache is disabled by default
+    assert(addrinfo.getaddrinfo('127.0.0.1', '80', nil, nil, nil,
+                                llsocket.AI_NUMERICHOST))
+    local hits, misses, len = addrinfo.cachestats()
+    assert.equal(hits, 0)
+    assert.equal(misses, 0)
+    assert.equal(len, 0)
+
+    -- test that the result is cached
+    assert(addrinfo.cache(2, 60, 60))
+    local ais = assert(addrinfo.getaddrinfo('127.0.0.1', '80',
+                                            llsocket.AF_INET,
+                                            llsocket.SOCK_STREAM, nil,
+                                            llsocket.AI_NUMERICHOST))
+    local cached = assert(addrinfo.getaddrinfo('127.0.0.1', '80',
+                                               llsocket.AF_INET,
+                                               llsocket.SOCK_STREAM, nil,
+                                               llsocket.AI_NUMERICHOST))
+    hits, misses, len = addrinfo.cachestats()
+    assert.equal(hits, 1)
+    assert.equal(misses, 1)
+    assert.equal(len, 1)
+    assert.equal(#cached, #ais)
+    for i, ai in ipairs(ais) do
+        -- returns the new objects
+        assert.not_equal(tostring(cached[i]), tostring(ai))
+        assert.is_true(cached[i] == ai)
+        assert.equal(cached[i]:socktype(), ai:socktype())
+    end
+
+    -- test that the lookup failure is cached
+    local _, err = addrinfo.getaddrinfo('foo.bar', nil, nil, nil, nil,
+                                        llsocket.AI_NUMERICHOST)
+    assert.match(tostring(err), 'getaddrinfo')
+    _, err = addrinfo.getaddrinfo('foo.bar', nil, nil, nil, nil,
+                                  llsocket.AI_NUMERICHOST)
+    assert.match(tostring(err), 'getaddrinfo')
+    hits, misses, len = addrinfo.cachestats()
+    assert.equal(hits, 2)
+    assert.equal(misses, 2)
+    assert.equal(len, 2)
+
+    -- test that the least recently used entry is evicted
+    local ai = assert(addrinfo.inet('127.0.0.1', 8080))
+    local info = assert(ai:getnameinfo(llsocket.NI_NUMERICHOST,
+                                       llsocket.NI_NUMERICSERV))
+    assert.equal(info.host, '127.0.0.1')
+    info = assert(ai:getnameinfo(llsocket.NI_NUMERICHOST,
+                                 llsocket.NI_NUMERICSERV))
+    assert.equal(info.service, '8080')
+    hits, misses, len = addrinfo.cachestats()
+    assert.equal(hits, 3)
+    assert.equal(misses, 3)
+    assert.equal(len, 2)
+    assert(addrinfo.getaddrinfo('127.0.0.1', '80', llsocket.AF_INET,
+                                llsocket.SOCK_STREAM, nil,
+                                llsocket.AI_NUMERICHOST))
+    hits, misses = addrinfo.cachestats()
+    assert.equal(hits, 3)
+    assert.equal(misses, 4)
+
+    -- test that invalidate the entries of the host
+    assert.equal(addrinfo.invalidate('127.0.0.1'), 2)
+    assert.equal(select(3, addrinfo.cachestats()), 0)
+
+    -- test that the entry expires
+    assert(addrinfo.cache(2, 0.01))
+    assert(addrinfo.getaddrinfo('127.0.0.1', nil, nil, nil, nil,
+                                llsocket.AI_NUMERICHOST))
+    timer.usleep(20000)
+    assert(addrinfo.getaddrinfo('127.0.0.1', nil, nil, nil, nil,
+                                llsocket.AI_NUMERICHOST))
+    hits, misses, len = addrinfo.cachestats()
+    assert.equal(hits, 0)
+    assert.equal(misses, 2)
+    assert.equal(len, 1)
+    assert.equal(addrinfo.invalidate(), 1)
+
+    -- test that throws an error with invalid arguments
+    err = assert.throws(addrinfo.cache, -1)
+    assert.match(err, 'size must be greater than or equal to 0')
+    err = assert.throws(addrinfo.cache, 1, 0)
+    assert.match(err, 'ttl must be greater than 0')
+
+    assert(addrinfo.cache(0))
+end
@@ -0,0 +1,89 @@
+local testcase = require('testcase')
+local llsocket = require('llsocket')
+local buffer = llsocket.buffer
+local socket = llsocket.socket
+
+function testcase.new()
+    -- test that returns new instance of llsocket.buffer
+    local buf = buffer.new('hello world')
+    assert.match(tostring(buf), '^llsocket.buffer:', false)
+    assert.equal(buf:len(), 11)
+    assert.equal(#buf, 11)
+    assert.equal(buf:tostring(), 'hello world')
+
+    -- test that throws an error with invalid arguments
+    local err = assert.throws(function()
+        buffer.new({})
+    end)
+    assert.match(err, '#1 .+ [(]string expected, got table', false)
+end
+
+function testcase.sub()
+    local str = 'hello world'
+    local buf = buffer.new(str)
+
+    -- test that slices are same as string.sub
+    for _, v in ipairs({
+        {},
+        {1},
+        {7},
+        {-5},
+        {3, 5},
+        {-5, -2},
+        {0, 100},
+        {8, 3},
+        {-100, 2},
+    }) do
+        local slice = buf:sub(v[1], v[2])
+        assert.equal(slice:tostring(), str:sub(v[1] or 1, v[2] or -1))
+    end
+
+    -- test that a slice of slice refers to the same storage
+    local slice = buf:sub(7):sub(2, 3)
+    buf = nil
+    collectgarbage('collect')
+    assert.equal(slice:tostring(), 'or')
+end
+
+function testcase.file()
+    local f = assert(io.tmpfile())
+    f:write('hello world')
+    f:flush()
+
+    -- test that create a buffer from the region of file
+    local buf = assert(buffer.file(f, 5, 6))
+    assert.equal(buf:tostring(), 'world')
+
+    -- test that buffer is shorter than specified bytes at end-of-file
+    buf = assert(buffer.file(f, 100, 6))
+    assert.equal(buf:tostring(), 'world')
+    f:close()
+end
+
+function testcase.send_recvbuf()
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+    local buf = buffer.new('hello world')
+
+    -- test that send a buffer
+    assert.equal(sp[1]:send(buf:sub(1, 5)), 5)
+    assert.equal(sp[1]:write(buf:sub(6)), 6)
+
+    -- test that recv a message into buffer
+    local rbuf = assert(sp[2]:recvbuf())
+    assert.match(tostring(rbuf), '^llsocket.buffer:', false)
+    assert.equal(rbuf:tostring(), 'hello world')
+
+    -- test that send a buffer via sendmsg
+    local mh = llsocket.msghdr.new()
+    mh:iov(rbuf:sub(7))
+    assert.equal(sp[2]:sendmsg(mh), 5)
+    assert.equal(sp[1]:recv(), 'world')
+
+    -- test that recvmsg cannot receive into buffer
+    local n, err = sp[1]:recvmsg(mh)
+    assert.is_nil(n)
+    assert.match(err, 'EINVAL')
+
+    sp[1]:close()
+    sp[2]:close()
+end
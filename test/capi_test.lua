@@ -0,0 +1,41 @@
+local testcase = require('testcase')
+local llsocket = require('llsocket')
+local llffi = llsocket.ffi
+local socket = llsocket.socket
+
+function testcase.capsule()
+    -- test that the C API capsule is published to the registry
+    local capi = debug.getregistry()['llsocket.capi']
+    assert.equal(type(capi), 'userdata')
+end
+
+function testcase.send_recv()
+    -- the capsule can be called from Lua only through the LuaJIT FFI
+    local ok, ffi = pcall(require, 'ffi')
+    if not ok then
+        return
+    end
+    -- ignore the redefinition if declared by the other test
+    pcall(ffi.cdef, llffi.msghdr_cdef)
+    pcall(ffi.cdef, llffi.cdef)
+    local api = ffi.cast('const lls_capi_t *',
+                         debug.getregistry()['llsocket.capi'])
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM, nil, true))
+    local s1 = ffi.cast('lls_socket_t *', sp[1])
+    local s2 = ffi.cast('lls_socket_t *', sp[2])
+
+    -- test that the function pointers of the capsule work
+    assert.equal(api.version, llffi.version)
+    assert.equal(api.fd(s1), sp[1]:fd())
+    assert.equal(api.socktype(s2), llsocket.SOCK_STREAM)
+    assert.equal(tonumber(api.send(s1, 'hello', 5, 0)), 5)
+    local buf = ffi.new('char[?]', 16)
+    local n = tonumber(api.recv(s2, buf, 16, 0))
+    assert.equal(ffi.string(buf, n), 'hello')
+
+    -- test that returns -errno
+    n = tonumber(api.recv(s2, buf, 16, 0))
+    assert.less(n, 0)
+    sp[1]:close()
+    sp[2]:close()
+end
@@ -33,3 +33,20 @@ function testcase.push()
     end)
     assert.match(err, '#1 .+ [(]llsocket.cmsghdr expected, got table', false)
 end
+
+function testcase.push_after_gc()
+    local cmhs = assert(cmsghdrs.new())
+
+    -- test that the data is kept alive while the cmsghdrs is alive
+    for i = 1, 10 do
+        cmhs:push(assert(cmsghdr.new(1, i, string.rep('x', i * 10))))
+        collectgarbage('collect')
+    end
+    for i = 1, 10 do
+        local v = assert(cmhs:shift())
+        collectgarbage('collect')
+        assert.equal(v:type(), i)
+        assert.equal(v:data(), string.rep('x', i * 10))
+    end
+    assert.is_nil(cmhs:shift())
+end
@@ -0,0 +1,130 @@
+local testcase = require('testcase')
+local timer = require('testcase.timer')
+local errno = require('errno')
+local llsocket = require('llsocket')
+local addrinfo = llsocket.addrinfo
+local socket = llsocket.socket
+local connector = llsocket.connector
+
+local function new_listener()
+    local ai = assert(addrinfo.inet('127.0.0.1', 0, llsocket.SOCK_STREAM))
+    local s = assert(socket.new(ai:family(), ai:socktype(), nil, true))
+    assert(s:bind(ai))
+    assert(s:listen())
+    return s, assert(s:getsockname())
+end
+
+-- get the port that nobody is listening on
+local function closed_port()
+    local s, ai = new_listener()
+    s:close()
+    return ai:port()
+end
+
+local function run(c)
+    for _ = 1, 5000 do
+        local sock, err, again = c:step()
+        if not again then
+            return sock, err
+        end
+        timer.usleep(1000)
+    end
+    error('timeout')
+end
+
+function testcase.new()
+    local ai = assert(addrinfo.inet('127.0.0.1', 80, llsocket.SOCK_STREAM))
+
+    -- test that returns new instance of llsocket.connector
+    local c = assert(connector.new({
+        ai,
+    }))
+    assert.match(tostring(c), '^llsocket.connector:', false)
+    c:close()
+
+    -- test that throws an error with invalid arguments
+    local err = assert.throws(connector.new, {})
+    assert.match(err, 'ais must be the non-empty list of llsocket.addrinfo')
+    err = assert.throws(connector.new, {
+        'foo',
+    })
+    assert.match(err, 'ais must be the list of llsocket.addrinfo')
+    err = assert.throws(connector.new, {
+        ai,
+    }, 0)
+    assert.match(err, 'delay must be between 0.01 and 2')
+    err = assert.throws(connector.new, {
+        ai,
+    }, nil, -1)
+    assert.match(err, 'timeout must be greater than 0')
+end
+
+function testcase.sort()
+    local ais = {
+        assert(addrinfo.inet('192.0.2.1', 80, llsocket.SOCK_STREAM)),
+        assert(addrinfo.inet('127.0.0.1', 80, llsocket.SOCK_STREAM)),
+    }
+    local exp = {
+        ais[2],
+        ais[1],
+    }
+
+    -- test that sort the list in place by the rules of RFC 6724
+    assert.equal(connector.sort(ais), ais)
+    assert.equal(ais, exp)
+end
+
+function testcase.step()
+    local lsn, ai = new_listener()
+    local c = assert(connector.new({
+        assert(addrinfo.inet('127.0.0.1', closed_port(), llsocket.SOCK_STREAM)),
+        ai,
+    }, 0.5))
+
+    -- test that starts the first attempt
+    local sock, err, again = c:step()
+    assert.is_nil(sock)
+    assert.is_nil(err)
+    assert.is_true(again)
+
+    -- test that starts the next attempt immediately after the first one failed
+    sock, err = run(c)
+    assert.is_nil(err)
+    assert.match(tostring(sock), '^llsocket.socket:', false)
+    assert.equal(assert(sock:getpeername()):port(), ai:port())
+    assert.equal(#c:fds(), 0)
+    sock:close()
+
+    -- test that returns an error after completed
+    sock, err = c:step()
+    assert.is_nil(sock)
+    assert.equal(err.type, errno.EALREADY)
+
+    -- test that returns an error if all attempts failed
+    c = assert(connector.new({
+        assert(addrinfo.inet('127.0.0.1', closed_port(), llsocket.SOCK_STREAM)),
+        assert(addrinfo.inet('127.0.0.1', closed_port(), llsocket.SOCK_STREAM)),
+    }))
+    sock, err = run(c)
+    assert.is_nil(sock)
+    assert.equal(err.type, errno.ECONNREFUSED)
+    lsn:close()
+end
+
+function testcase.close()
+    local lsn, ai = new_listener()
+    local c = assert(connector.new({
+        ai,
+    }))
+
+    -- test that closes the attempts in flight
+    local sock, _, again = c:step()
+    if sock then
+        sock:close()
+    else
+        assert.is_true(again)
+        c:close()
+        assert.equal(#c:fds(), 0)
+    end
+    lsn:close()
+end
@@ -0,0 +1,339 @@
+local testcase = require('testcase')
+local timer = require('testcase.timer')
+local errno = require('errno')
+local llsocket = require('llsocket')
+local addrinfo = llsocket.addrinfo
+local socket = llsocket.socket
+local dns = llsocket.dns
+
+local function u16(v)
+    return string.char(math.floor(v / 256) % 256, v % 256)
+end
+
+-- build the response of the query
+local function response(query, flags, answers)
+    local qtype = query:byte(-4) * 256 + query:byte(-3)
+    local rrs = {}
+    for _, ans in ipairs(answers[qtype] or {}) do
+        -- pointer to the question name
+        rrs[#rrs + 1] = string.char(192, 12) .. u16(qtype) .. u16(1) ..
+                            u16(0) .. u16(300) .. u16(#ans) .. ans
+    end
+    return query:sub(1, 2) .. flags .. u16(1) .. u16(#rrs) .. u16(0) ..
+               u16(0) .. query:sub(13) .. table.concat(rrs)
+end
+
+-- stand-in nameserver
+local function new_server()
+    local ai = assert(addrinfo.inet('127.0.0.1', 0, llsocket.SOCK_DGRAM))
+    local s = assert(socket.new(ai:family(), ai:socktype(), nil, true))
+    assert(s:bind(ai))
+    return s, assert(s:getsockname())
+end
+
+-- serve the queries until the query is completed
+local function run(q, srv, handler)
+    for _ = 1, 2000 do
+        local ais, err, again = q:step()
+        if not again then
+            return ais, err
+        end
+        local msg, _, _, ai = srv:recvfrom()
+        if msg then
+            for _, res in ipairs({
+                handler(msg),
+            }) do
+                assert(srv:sendto(res, ai))
+            end
+        end
+        timer.usleep(1000)
+    end
+    error('timeout')
+end
+
+local A = {
+    [1] = {
+        string.char(127, 0, 0, 2),
+        string.char(127, 0, 0, 3),
+    },
+    [28] = {
+        string.char(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1),
+    },
+}
+
+function testcase.encode_decode()
+    -- test that encode the query message
+    local pkt = assert(dns.encode('Example.com.', dns.T_A, 0x1234))
+    assert.equal(pkt, u16(0x1234) .. string.char(1, 0) .. u16(1) .. u16(0) ..
+                     u16(0) .. u16(0) .. string.char(7) .. 'Example' ..
+                     string.char(3) .. 'com' .. string.char(0) .. u16(1) ..
+                     u16(1))
+
+    -- test that decode the response message
+    local msg = assert(dns.decode(response(pkt, string.char(129, 128), A)))
+    assert.equal(msg.id, 0x1234)
+    assert.is_true(msg.qr)
+    assert.is_false(msg.tc)
+    assert.equal(msg.rcode, 0)
+    assert.equal(msg.qname, 'Example.com')
+    assert.equal(msg.qtype, dns.T_A)
+    assert.equal(#msg.answers, 2)
+    assert.equal(msg.answers[1].name, 'Example.com')
+    assert.equal(msg.answers[1].ttl, 300)
+    assert.equal(msg.answers[1].data, '127.0.0.2')
+    assert.equal(msg.answers[2].data, '127.0.0.3')
+
+    -- test that returns an error with invalid name
+    local err
+    pkt, err = dns.encode('foo..bar', dns.T_A)
+    assert.is_nil(pkt)
+    assert.equal(err.type, errno.EINVAL)
+    pkt, err = dns.encode(string.rep('a', 64), dns.T_A)
+    assert.is_nil(pkt)
+    assert.equal(err.type, errno.EINVAL)
+
+    -- test that returns an error with malformed message
+    msg, err = dns.decode('foo')
+    assert.is_nil(msg)
+    assert.equal(err.type, errno.EINVAL)
+    msg, err = dns.decode(u16(1) .. string.char(129, 128) .. u16(1) ..
+                              u16(1) .. u16(0) .. u16(0) .. string.char(192, 12))
+    assert.is_nil(msg)
+    assert.equal(err.type, errno.EINVAL)
+end
+
+function testcase.new()
+    -- test that returns new instance of llsocket.dns
+    local r = assert(dns.new())
+    assert.match(tostring(r), '^llsocket.dns:', false)
+
+    -- test that throws an error with invalid options
+    local err = assert.throws(dns.new, {
+        nameservers = {
+            'foo',
+        },
+    })
+    assert.match(err, 'nameservers must be the list of')
+
+    -- test that throws an error with invalid nameservers that override the
+    -- nameservers of resolv.conf
+    local pathname = os.tmpname()
+    local f = assert(io.open(pathname, 'w'))
+    f:write('nameserver 127.0.0.1\n')
+    f:close()
+    err = assert.throws(dns.new, {
+        resolvconf = pathname,
+        nameservers = {
+            1,
+        },
+    })
+    os.remove(pathname)
+    assert.match(err, 'nameservers must be the list of')
+
+    err = assert.throws(dns.new, {
+        timeout = 0,
+    })
+    assert.match(err, 'timeout must be greater than 0')
+    err = assert.throws(dns.new, {
+        attempts = 6,
+    })
+    assert.match(err, 'attempts must be between 1 and 5')
+end
+
+function testcase.query()
+    local srv, ns = new_server()
+    local r = assert(dns.new({
+        resolvconf = false,
+        hosts = false,
+        nameservers = {
+            ns,
+        },
+    }))
+
+    -- test that returns the AAAA and A records in this order
+    collectgarbage('collect')
+    collectgarbage('collect')
+    local nopen = socket.nopen()
+    local q = r:query('www.example.com', 8080, nil, llsocket.SOCK_STREAM)
+    assert.match(tostring(q), '^llsocket.dns.query:', false)
+    assert.greater_or_equal(q:fd(), 0)
+    -- test that the descriptor is owned by llsocket.socket
+    assert.match(tostring(q:socket()), '^llsocket.socket:', false)
+    assert.equal(q:socket():fd(), q:fd())
+    assert.equal(socket.nopen(), nopen + 1)
+    local ais, err = run(q, srv, function(msg)
+        return response(msg, string.char(129, 128), A)
+    end)
+    assert.is_nil(err)
+    assert.equal(#ais, 3)
+    assert.equal(ais[1]:addr(), '::1')
+    assert.equal(ais[2]:addr(), '127.0.0.2')
+    assert.equal(ais[3]:addr(), '127.0.0.3')
+    assert.equal(ais[3]:port(), 8080)
+    assert.equal(ais[3]:socktype(), llsocket.SOCK_STREAM)
+    -- test that the completed query returns the same result
+    assert.equal(select('#', q:step()), 2)
+    assert.is_nil(q:fd())
+    assert.is_nil(q:socket())
+    assert.equal(socket.nopen(), nopen)
+
+    -- test that returns only the records of the family
+    q = r:query('www.example.com', nil, llsocket.AF_INET)
+    ais, err = run(q, srv, function(msg)
+        return response(msg, string.char(129, 128), A)
+    end)
+    assert.is_nil(err)
+    assert.equal(#ais, 2)
+
+    -- test that ignores the response with the mismatched id
+    q = r:query('www.example.com', nil, llsocket.AF_INET)
+    ais, err = run(q, srv, function(msg)
+        local id = (msg:byte(1) * 256 + msg:byte(2) + 1) % 65536
+        return response(u16(id) .. msg:sub(3), string.char(129, 128), {}),
+               response(msg, string.char(129, 128), A)
+    end)
+    assert.is_nil(err)
+    assert.equal(#ais, 2)
+
+    -- test that returns EAI_NONAME error with NXDOMAIN
+    q = r:query('nx.example.com', nil, llsocket.AF_INET)
+    ais, err = run(q, srv, function(msg)
+        return response(msg, string.char(129, 131), {})
+    end)
+    assert.is_nil(ais)
+    assert.match(err, 'dns')
+
+    -- test that the query can be closed
+    q = r:query('www.example.com')
+    q:close()
+    ais, err = q:step()
+    assert.is_nil(ais)
+    assert.equal(err.type, errno.ECANCELED)
+    srv:close()
+end
+
+function testcase.query_timeout()
+    local srv, ns = new_server()
+    local r = assert(dns.new({
+        resolvconf = false,
+        hosts = false,
+        nameservers = {
+            ns,
+        },
+        timeout = 0.05,
+        attempts = 2,
+    }))
+
+    -- test that returns an error after all tries are timed out
+    local q = r:query('www.example.com')
+    local nquery = 0
+    local ais, err = run(q, srv, function()
+        nquery = nquery + 1
+    end)
+    assert.is_nil(ais)
+    assert.match(err, 'dns')
+    -- AAAA and A questions per try
+    assert.equal(nquery, 4)
+    srv:close()
+end
+
+function testcase.query_truncated()
+    local srv, ns = new_server()
+    local ai = assert(addrinfo.inet('127.0.0.1', ns:port(), llsocket.SOCK_STREAM))
+    local lsn = assert(socket.new(ai:family(), ai:socktype(), nil, true))
+    assert(lsn:reuseaddr(true))
+    assert(lsn:bind(ai))
+    assert(lsn:listen())
+    local r = assert(dns.new({
+        resolvconf = false,
+        hosts = false,
+        nameservers = {
+            ns,
+        },
+    }))
+
+    -- test that retry the query over tcp if the response is truncated
+    local q = r:query('www.example.com', nil, llsocket.AF_INET)
+    local conn
+    local buf = ''
+    for _ = 1, 2000 do
+        local ais, err, again = q:step()
+        if not again then
+            assert.is_nil(err)
+            assert.equal(#ais, 2)
+            assert.equal(ais[2]:addr(), '127.0.0.3')
+            break
+        end
+
+        local msg, _, _, from = srv:recvfrom()
+        if msg then
+            assert(srv:sendto(response(msg, string.char(131, 128), {}), from))
+        end
+        if not conn then
+            conn = lsn:accept()
+        end
+        if conn then
+            msg = conn:recv()
+            if msg then
+                buf = buf .. msg
+                local len = buf:byte(1) * 256 + buf:byte(2)
+                if #buf >= 2 + len then
+                    local res = response(buf:sub(3, 2 + len),
+                                         string.char(129, 128), A)
+                    assert(conn:send(u16(#res) .. res))
+                    buf = buf:sub(3 + len)
+                end
+            end
+        end
+        timer.usleep(1000)
+    end
+    assert(conn, 'tcp connection was not established')
+    conn:close()
+    lsn:close()
+    srv:close()
+end
+
+function testcase.query_hosts_and_literal()
+    local pathname = os.tmpname()
+    local f = assert(io.open(pathname, 'w'))
+    f:write('# comment\n', '127.0.0.5 Foo.Local foo # alias\n',
+            '::5 foo.local\n', '127.0.0.6\tbar.local\n')
+    f:close()
+    local r = assert(dns.new({
+        resolvconf = false,
+        hosts = pathname,
+    }))
+    os.remove(pathname)
+
+    -- test that returns the addresses in the hosts file
+    local ais, err = r:query('FOO.local.', 80):step()
+    assert.is_nil(err)
+    assert.equal(#ais, 2)
+    assert.equal(ais[1]:addr(), '::5')
+    assert.equal(ais[2]:addr(), '127.0.0.5')
+    assert.equal(ais[2]:port(), 80)
+    ais = assert(r:query('foo', nil, llsocket.AF_INET):step())
+    assert.equal(#ais, 1)
+    assert.equal(ais[1]:addr(), '127.0.0.5')
+
+    -- test that returns the address literal without query
+    ais = assert(r:query('192.0.2.1', 53):step())
+    assert.equal(#ais, 1)
+    assert.equal(ais[1]:addr(), '192.0.2.1')
+    ais = assert(r:query('2001:db8::1'):step())
+    assert.equal(ais[1]:addr(), '2001:db8::1')
+
+    -- test that returns an error if the literal is not the family
+    ais, err = r:query('192.0.2.1', nil, llsocket.AF_INET6):step()
+    assert.is_nil(ais)
+    assert.match(err, 'dns')
+
+    -- test that returns an error with invalid name
+    ais, err = r:query('foo..bar'):step()
+    assert.is_nil(ais)
+    assert.match(err, 'dns')
+
+    -- test that throws an error with invalid family
+    err = assert.throws(r.query, r, 'foo', nil, llsocket.AF_UNIX)
+    assert.match(err, 'family must be AF_INET or AF_INET6')
+end
@@ -0,0 +1,131 @@
+local testcase = require('testcase')
+local llsocket = require('llsocket')
+local llffi = llsocket.ffi
+local socket = llsocket.socket
+-- LuaJIT only
+local ffi
+do
+    local ok, mod = pcall(require, 'ffi')
+    if ok then
+        ffi = mod
+        ffi.cdef(llffi.msghdr_cdef)
+        ffi.cdef(llffi.cdef)
+    end
+end
+
+function testcase.fields()
+    -- test that exposes the stable C ABI
+    assert.equal(llffi.version, 2)
+    assert.is_string(llffi.cdef)
+    assert.is_string(llffi.msghdr_cdef)
+    for _, name in ipairs({
+        'fd',
+        'family',
+        'socktype',
+        'protocol',
+        'send',
+        'recv',
+        'sendmsg',
+        'recvmmsg',
+    }) do
+        assert.equal(type(llffi[name]), 'userdata')
+    end
+end
+
+function testcase.attributes()
+    if not ffi then
+        return
+    end
+    local fd = ffi.cast('lls_socket_attr_t', llffi.fd)
+    local family = ffi.cast('lls_socket_attr_t', llffi.family)
+    local socktype = ffi.cast('lls_socket_attr_t', llffi.socktype)
+    local protocol = ffi.cast('lls_socket_attr_t', llffi.protocol)
+    local sock = assert(socket.new(llsocket.AF_INET, llsocket.SOCK_DGRAM))
+    local s = ffi.cast('lls_socket_t *', sock)
+
+    -- test that get the attributes of the opaque handle
+    assert.equal(fd(s), sock:fd())
+    assert.equal(family(s), sock:family())
+    assert.equal(socktype(s), sock:socktype())
+    assert.equal(protocol(s), sock:protocol())
+    sock:close()
+end
+
+function testcase.send_recv()
+    if not ffi then
+        return
+    end
+    local fd = ffi.cast('lls_socket_attr_t', llffi.fd)
+    local send = ffi.cast('lls_socket_send_t', llffi.send)
+    local recv = ffi.cast('lls_socket_recv_t', llffi.recv)
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM, nil, true))
+    local s1 = ffi.cast('lls_socket_t *', sp[1])
+    local s2 = ffi.cast('lls_socket_t *', sp[2])
+    assert.equal(fd(s1), sp[1]:fd())
+
+    -- test that send and recv via the C ABI
+    assert.equal(tonumber(send(s1, 'hello', 5, 0)), 5)
+    local buf = ffi.new('char[?]', 16)
+    local n = tonumber(recv(s2, buf, 16, 0))
+    assert.equal(ffi.string(buf, n), 'hello')
+
+    -- test that returns -errno
+    n = tonumber(recv(s2, buf, 16, 0))
+    assert.less(n, 0)
+    sp[1]:close()
+    sp[2]:close()
+end
+
+function testcase.sendmsg_recvmmsg()
+    if not ffi then
+        return
+    end
+    local sendmsg = ffi.cast('lls_socket_sendmsg_t', llffi.sendmsg)
+    local recvmmsg = ffi.cast('lls_socket_recvmmsg_t', llffi.recvmmsg)
+    local sp = assert(socket.pair(llsocket.SOCK_DGRAM, nil, true))
+    local s1 = ffi.cast('lls_socket_t *', sp[1])
+    local s2 = ffi.cast('lls_socket_t *', sp[2])
+
+    -- test that send the messages via the C ABI
+    local iov = ffi.new('struct iovec[2]')
+    local msg = ffi.new('struct msghdr')
+    msg.msg_iov = iov
+    msg.msg_iovlen = 2
+    for _, v in ipairs({
+        {
+            'hello',
+            ' world',
+        },
+        {
+            'foo',
+            'bar',
+        },
+    }) do
+        iov[0].iov_base = ffi.cast('void *', v[1])
+        iov[0].iov_len = #v[1]
+        iov[1].iov_base = ffi.cast('void *', v[2])
+        iov[1].iov_len = #v[2]
+        assert.equal(tonumber(sendmsg(s1, msg, 0)), #v[1] + #v[2])
+    end
+
+    -- test that receive the messages at once via the C ABI
+    local bufs = ffi.new('char[4][64]')
+    local riov = ffi.new('struct iovec[4]')
+    local msgs = ffi.new('lls_mmsghdr_t[4]')
+    for i = 0, 3 do
+        riov[i].iov_base = bufs[i]
+        riov[i].iov_len = 64
+        msgs[i].msg_hdr.msg_iov = riov + i
+        msgs[i].msg_hdr.msg_iovlen = 1
+    end
+    local n = tonumber(recvmmsg(s2, msgs, 4, 0))
+    assert.equal(n, 2)
+    assert.equal(ffi.string(bufs[0], msgs[0].msg_len), 'hello world')
+    assert.equal(ffi.string(bufs[1], msgs[1].msg_len), 'foobar')
+
+    -- test that returns -errno
+    n = tonumber(recvmmsg(s2, msgs, 4, 0))
+    assert.less(n, 0)
+    sp[1]:close()
+    sp[2]:close()
+end
@@ -0,0 +1,125 @@
+local testcase = require('testcase')
+local llsocket = require('llsocket')
+local outq = llsocket.outq
+local socket = llsocket.socket
+
+function testcase.new()
+    -- test that returns new instance of llsocket.outq
+    local q = outq.new()
+    assert.match(tostring(q), '^llsocket.outq:', false)
+    assert.equal(#q, 0)
+    assert.equal(q:count(), 0)
+
+    -- test that throws an error with invalid watermarks
+    local err = assert.throws(function()
+        outq.new(10, 10)
+    end)
+    assert.match(err, 'lowat must be less than hiwat')
+end
+
+function testcase.push_flush()
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+    local q = outq.new()
+
+    -- test that push messages
+    assert.equal(q:push('hello'), 5)
+    assert.equal(q:push(llsocket.buffer.new(' world')), 11)
+    assert.equal(q:push(''), 11)
+    assert.equal(q:count(), 2)
+
+    -- test that flush the queued messages at once
+    local n, err, again = q:flush(sp[1])
+    assert.equal(n, 11)
+    assert.is_nil(err)
+    assert.is_false(again)
+    assert.equal(#q, 0)
+    assert.equal(sp[2]:recv(), 'hello world')
+
+    -- test that returns 0 if queue is empty
+    n, err, again = q:flush(sp[1])
+    assert.equal(n, 0)
+    assert.is_nil(err)
+    assert.is_nil(again)
+
+    -- test that clear the queued messages
+    q:push('foo')
+    q:clear()
+    assert.equal(#q, 0)
+    assert.equal(q:count(), 0)
+
+    sp[1]:close()
+    sp[2]:close()
+end
+
+function testcase.sendall_watermark()
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+    local events = {}
+    local q = outq.new(8, 2, function()
+        events[#events + 1] = 'high'
+    end, function()
+        events[#events + 1] = 'low'
+    end)
+
+    -- test that onhigh is called when queued bytes reaches hiwat
+    q:push('hello')
+    assert.equal(events, {})
+    q:push('world')
+    assert.equal(events, {
+        'high',
+    })
+
+    -- test that onlow is called when queued bytes falls to lowat
+    local n = assert(q:sendall(sp[1]))
+    assert.equal(n, 10)
+    assert.equal(events, {
+        'high',
+        'low',
+    })
+    assert.equal(sp[2]:recv(), 'helloworld')
+
+    sp[1]:close()
+    sp[2]:close()
+end
+
+function testcase.push_wraparound()
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+    local _, err = sp[1]:nonblock(true)
+    assert(not err, err)
+    _, err = sp[2]:nonblock(true)
+    assert(not err, err)
+    local q = outq.new()
+    local msgs = {}
+    for i = 1, 24 do
+        msgs[i] = string.char(64 + i):rep(65536)
+        q:push(msgs[i])
+    end
+
+    -- test that the items wrapped around the ring keep their order after
+    -- the ring grows
+    local n
+    n, err = q:flush(sp[1])
+    assert(not err, err)
+    assert.less(n, #msgs * 65536)
+    for i = 25, 48 do
+        msgs[i] = string.char(64 + i):rep(65536)
+        q:push(msgs[i])
+    end
+    msgs = table.concat(msgs)
+    local data = {}
+    repeat
+        _, err = q:flush(sp[1])
+        assert(not err, err)
+        repeat
+            local chunk = sp[2]:recv(65536)
+            data[#data + 1] = chunk
+        until not chunk
+    until #q == 0
+    repeat
+        local chunk = sp[2]:recv(65536)
+        data[#data + 1] = chunk
+    until not chunk
+    assert.equal(table.concat(data), msgs)
+
+    sp[1]:close()
+    sp[2]:close()
+end
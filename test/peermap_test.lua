@@ -0,0 +1,125 @@
+local testcase = require('testcase')
+local llsocket = require('llsocket')
+local addrinfo = llsocket.addrinfo
+local peermap = llsocket.peermap
+local socket = llsocket.socket
+
+function testcase.new()
+    -- test that returns new instance of llsocket.peermap
+    local m = peermap.new()
+    assert.match(tostring(m), '^llsocket.peermap:', false)
+    assert.equal(m:len(), 0)
+end
+
+function testcase.set_get_delete()
+    local m = peermap.new()
+    local ai4 = assert(addrinfo.inet('127.0.0.1', 8080))
+    local ai6 = assert(addrinfo.inet6('::1', 8080))
+
+    -- test that set the value
+    m:set(ai4, 'v4')
+    m:set(ai6, 'v6')
+    assert.equal(#m, 2)
+    assert.equal(m:get(ai4), 'v4')
+    assert.equal(m:get(ai6), 'v6')
+    assert.is_nil(m:get(assert(addrinfo.inet('127.0.0.1', 8081))))
+
+    -- test that the ipv4-mapped ipv6 address is the same key
+    local mapped = assert(addrinfo.inet6('::ffff:127.0.0.1', 8080))
+    assert.equal(m:get(mapped), 'v4')
+    m:set(mapped, 'mapped')
+    assert.equal(#m, 2)
+    assert.equal(m:get(ai4), 'mapped')
+
+    -- test that delete the entry
+    assert.equal(m:delete(ai4), 'mapped')
+    assert.is_nil(m:get(ai4))
+    assert.is_nil(m:delete(ai4))
+    assert.equal(#m, 1)
+    m:set(ai6, nil)
+    assert.equal(#m, 0)
+
+    -- test that throws an error with unsupported address
+    local err = assert.throws(m.set, m, assert(addrinfo.unix('/tmp/foo')), 1)
+    assert.match(err,
+                 'key must be the packed address or llsocket.addrinfo of AF_INET')
+    err = assert.throws(m.get, m, 'foo')
+    assert.match(err,
+                 'key must be the packed address or llsocket.addrinfo of AF_INET')
+end
+
+function testcase.grow_and_pairs()
+    local m = peermap.new()
+    local n = 1000
+
+    -- test that the table grows
+    for i = 1, n do
+        m:set(assert(addrinfo.inet('10.0.0.1', i)), i)
+    end
+    assert.equal(#m, n)
+    for i = 1, n do
+        assert.equal(m:get(assert(addrinfo.inet('10.0.0.1', i))), i)
+    end
+
+    -- test that delete the entries during the traversal
+    local count = 0
+    for ai, v in m:pairs() do
+        assert.equal(ai:port(), v)
+        count = count + 1
+        if v % 2 == 0 then
+            m:delete(ai)
+        end
+    end
+    assert.equal(count, n)
+    assert.equal(#m, n / 2)
+
+    -- test that the deleted slots are reused
+    for i = 1, n do
+        m:set(assert(addrinfo.inet('10.0.0.1', i)), -i)
+    end
+    assert.equal(#m, n)
+    assert.equal(m:get(assert(addrinfo.inet('10.0.0.1', 2))), -2)
+end
+
+function testcase.addrinfo_eq_hash()
+    local a = assert(addrinfo.inet('127.0.0.1', 8080))
+    local b = assert(addrinfo.inet6('::ffff:127.0.0.1', 8080))
+    local c = assert(addrinfo.inet('127.0.0.1', 8081))
+
+    -- test that compare the normalized addresses
+    assert.is_true(a == b)
+    assert.is_false(a == c)
+    assert.equal(a:hash(), b:hash())
+    assert.not_equal(a:hash(), c:hash())
+end
+
+function testcase.recvfrom()
+    local ai = assert(addrinfo.inet('127.0.0.1', 0, llsocket.SOCK_DGRAM))
+    local s1 = assert(socket.new(ai:family(), ai:socktype()))
+    local s2 = assert(socket.new(ai:family(), ai:socktype()))
+    assert(s2:bind(ai))
+    local dst = assert(s2:getsockname())
+    local m = peermap.new()
+
+    -- test that returns nil and packed address if not found
+    assert(s1:sendto('hello', dst))
+    local msg, err, again, v, packed = s2:recvfrom(nil, m)
+    assert.equal(msg, 'hello')
+    assert.is_nil(err)
+    assert.is_nil(again)
+    assert.is_nil(v)
+    assert.equal(packed, s1:getsockname('packed'))
+    m:set(packed, 'session')
+
+    -- test that returns the value associated with the source address
+    assert(s1:sendto('world', dst))
+    msg, err, again, v, packed = s2:recvfrom(nil, m)
+    assert.equal(msg, 'world')
+    assert.is_nil(err)
+    assert.is_nil(again)
+    assert.equal(v, 'session')
+    assert.is_nil(packed)
+
+    s1:close()
+    s2:close()
+end
@@ -0,0 +1,144 @@
+local testcase = require('testcase')
+local timer = require('testcase.timer')
+local llsocket = require('llsocket')
+local addrinfo = llsocket.addrinfo
+local socket = llsocket.socket
+local pool = llsocket.pool
+
+local LSN
+local DEST
+
+function testcase.before_all()
+    local ai = assert(addrinfo.inet('127.0.0.1', 0, llsocket.SOCK_STREAM))
+    LSN = assert(socket.new(ai:family(), ai:socktype()))
+    assert(LSN:reuseaddr(true))
+    assert(LSN:bind(ai))
+    assert(LSN:listen())
+    DEST = assert(LSN:getsockname())
+end
+
+function testcase.after_all()
+    LSN:close()
+end
+
+-- connect to the listener and return the client and the server sockets
+local function connect()
+    local s = assert(socket.new(DEST:family(), DEST:socktype()))
+    assert(s:connect(DEST))
+    return s, assert(LSN:accept())
+end
+
+function testcase.new()
+    -- test that returns new instance of llsocket.pool
+    local p = assert(pool.new())
+    assert.match(tostring(p), '^llsocket.pool:', false)
+    assert.equal(#p, 0)
+
+    -- test that throws an error with invalid arguments
+    local err = assert.throws(pool.new, 0)
+    assert.match(err, 'maxidle must be between 1 and 65536')
+    err = assert.throws(pool.new, nil, 0)
+    assert.match(err, 'maxperhost must be greater than 0')
+    err = assert.throws(pool.new, nil, nil, -1)
+    assert.match(err, 'ttl must be greater than or equal to 0')
+end
+
+function testcase.checkin_checkout()
+    local p = assert(pool.new())
+    local c1, s1 = connect()
+    local c2, s2 = connect()
+
+    -- test that checkin the connected sockets
+    assert.is_true(p:checkin(c1))
+    assert.is_true(p:checkin(c2, DEST))
+    assert.is_true(p:checkin(c2, DEST:pack()))
+    assert.equal(p:len(), 2)
+
+    -- test that checkout the most recently checked in socket first
+    assert.equal(p:checkout(DEST), c2)
+    assert.equal(p:checkout(DEST:pack()), c1)
+    assert.is_nil(p:checkout(DEST))
+    assert.equal(p:len(), 0)
+
+    -- test that returns false with the closed or unconnected socket
+    local s = assert(socket.new(DEST:family(), DEST:socktype()))
+    assert.is_false(p:checkin(s))
+    s:close()
+    assert.is_false(p:checkin(s, DEST))
+
+    -- test that throws an error with invalid dest
+    local err = assert.throws(p.checkin, p, c1, 'foo')
+    assert.match(err, 'dest must be the packed address or llsocket.addrinfo')
+    err = assert.throws(p.checkout, p, {})
+    assert.match(err, 'llsocket.addrinfo expected')
+
+    for _, sock in ipairs({
+        c1,
+        c2,
+        s1,
+        s2,
+    }) do
+        sock:close()
+    end
+end
+
+function testcase.liveness()
+    local p = assert(pool.new())
+    local c1, s1 = connect()
+    local c2, s2 = connect()
+
+    -- test that discards the socket closed by the peer
+    assert(p:checkin(c1))
+    s1:close()
+    timer.usleep(10000)
+    assert.is_nil(p:checkout(DEST))
+    assert.equal(p:len(), 0)
+
+    -- test that discards the socket that has the unread data
+    assert(p:checkin(c2))
+    assert(s2:send('stale'))
+    timer.usleep(10000)
+    assert.is_nil(p:checkout(DEST))
+    s2:close()
+end
+
+function testcase.limits()
+    local p = assert(pool.new(3, 2, 0.05))
+    local clients = {}
+    local servers = {}
+    for i = 1, 5 do
+        clients[i], servers[i] = connect()
+    end
+
+    -- test that replaces the oldest socket of the destination
+    for i = 1, 3 do
+        assert(p:checkin(clients[i]))
+    end
+    assert.equal(p:len(), 2)
+    assert.equal(clients[1]:fd(), -1)
+
+    -- test that replaces the oldest socket of the pool
+    local other = assert(addrinfo.inet('127.0.0.2', 80))
+    assert(p:checkin(clients[4], other))
+    assert.equal(p:len(), 3)
+    assert(p:checkin(clients[5], other:pack()))
+    assert.equal(p:len(), 3)
+    assert.equal(clients[2]:fd(), -1)
+
+    -- test that prune the sockets idle longer than ttl
+    timer.usleep(60000)
+    assert.equal(p:prune(), 3)
+    assert.equal(p:len(), 0)
+
+    -- test that close the idle sockets
+    local c, s = connect()
+    assert(p:checkin(c))
+    p:close()
+    assert.equal(p:len(), 0)
+    assert.equal(c:fd(), -1)
+    s:close()
+    for i = 1, 5 do
+        clients[i]:close()
+        servers[i]:close()
+    end
+end
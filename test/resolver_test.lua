@@ -0,0 +1,131 @@
+local testcase = require('testcase')
+local timer = require('testcase.timer')
+local errno = require('errno')
+local llsocket = require('llsocket')
+local addrinfo = llsocket.addrinfo
+local resolver = llsocket.resolver
+
+-- wait for the completed requests
+local function wait(r, n)
+    local reqs = {}
+    for _ = 1, 5000 do
+        for _, req in ipairs(r:results()) do
+            reqs[#reqs + 1] = req
+        end
+        if #reqs >= n then
+            return reqs
+        end
+        timer.usleep(1000)
+    end
+    error('timeout')
+end
+
+function testcase.new()
+    -- test that returns new instance of llsocket.resolver
+    local r = assert(resolver.new())
+    assert.match(tostring(r), '^llsocket.resolver:', false)
+    assert.greater_or_equal(r:fd(), 0)
+    r:close()
+
+    -- test that throws an error with invalid nthread
+    local err = assert.throws(resolver.new, 0)
+    assert.match(err, 'nthread must be between 1 and 64')
+end
+
+function testcase.getaddrinfo()
+    local r = assert(resolver.new(2))
+
+    -- test that returns the request handle
+    local req = r:getaddrinfo('127.0.0.1', '8080', llsocket.AF_INET,
+                              llsocket.SOCK_STREAM, nil, llsocket.AI_NUMERICHOST)
+    assert.match(tostring(req), '^llsocket.resolver.request:', false)
+
+    -- test that returns the same result as addrinfo.getaddrinfo
+    local reqs = wait(r, 1)
+    assert.equal(reqs[1], req)
+    local ais, err = req:result()
+    assert.is_nil(err)
+    local exp = assert(addrinfo.getaddrinfo('127.0.0.1', '8080',
+                                            llsocket.AF_INET,
+                                            llsocket.SOCK_STREAM, nil,
+                                            llsocket.AI_NUMERICHOST))
+    assert.equal(#ais, #exp)
+    for i, ai in ipairs(ais) do
+        assert.is_true(ai == exp[i])
+        assert.equal(ai:socktype(), exp[i]:socktype())
+    end
+
+    -- test that returns an error
+    req = r:getaddrinfo('foo.bar', nil, nil, nil, nil, llsocket.AI_NUMERICHOST)
+    wait(r, 1)
+    ais, err = req:result()
+    assert.is_nil(ais)
+    assert.match(tostring(err), 'getaddrinfo')
+
+    r:close()
+end
+
+function testcase.getnameinfo()
+    local r = assert(resolver.new(1))
+    local ai = assert(addrinfo.inet('127.0.0.1', 8080))
+
+    -- test that returns the same result as ai:getnameinfo
+    local req = r:getnameinfo(ai, llsocket.NI_NUMERICHOST,
+                              llsocket.NI_NUMERICSERV)
+    wait(r, 1)
+    local info = assert(req:result())
+    assert.equal(info.host, '127.0.0.1')
+    assert.equal(info.service, '8080')
+
+    r:close()
+end
+
+function testcase.results()
+    local r = assert(resolver.new(4))
+    local reqs = {}
+
+    -- test that returns the completed requests in a batch
+    for i = 1, 20 do
+        reqs[i] = r:getaddrinfo('127.0.0.' .. i, nil, llsocket.AF_INET, nil,
+                                nil, llsocket.AI_NUMERICHOST)
+    end
+    local done = wait(r, 20)
+    assert.equal(#done, 20)
+    for i, req in ipairs(reqs) do
+        local ais = assert(req:result())
+        assert.equal(ais[1]:addr(), '127.0.0.' .. i)
+    end
+    assert.equal(#r:results(), 0)
+
+    r:close()
+end
+
+function testcase.cancel_and_close()
+    local r = assert(resolver.new(1))
+    local reqs = {}
+    for i = 1, 100 do
+        reqs[i] = r:getaddrinfo('127.0.0.1', nil, nil, nil, nil,
+                                llsocket.AI_NUMERICHOST)
+    end
+
+    -- test that the pending request can be cancelled
+    local req = reqs[100]
+    if req:cancel() then
+        local ais, err = req:result()
+        assert.is_nil(ais)
+        assert.equal(err.type, errno.ECANCELED)
+    end
+    assert.is_false(req:cancel())
+
+    -- test that the uncompleted requests are cancelled by close
+    r:close()
+    for _, v in ipairs(reqs) do
+        local _, _, again = v:result()
+        assert.is_nil(again)
+    end
+    r:close()
+
+    -- test that throws an error after close
+    local err = assert.throws(r.getaddrinfo, r, 'localhost')
+    assert.match(err, 'closed resolver')
+end
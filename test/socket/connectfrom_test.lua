@@ -0,0 +1,74 @@
+local llsocket = require('llsocket')
+local testcase = require('testcase')
+local errno = require('errno')
+local socket = llsocket.socket
+local addrinfo = llsocket.addrinfo
+
+function testcase.connectfrom()
+    local ai = assert(addrinfo.inet('127.0.0.1', 0, llsocket.SOCK_STREAM))
+    local s = assert(socket.new(ai:family(), ai:socktype()))
+    assert(s:bind(ai))
+    assert(s:listen())
+    local dst = assert(s:getsockname())
+
+    -- test that bind the source address and connect to the destination
+    local src = assert(addrinfo.inet('127.0.0.1', 1))
+    local c = assert(socket.new(dst:family(), dst:socktype()))
+    assert(c:connectfrom(src, dst))
+    local laddr = assert(c:getsockname())
+    assert.equal(laddr:addr(), '127.0.0.1')
+    assert.not_equal(laddr:port(), 1)
+    assert.is_true(c:bindnoport())
+    local peer = assert(s:accept())
+    assert.equal(assert(peer:getpeername()):port(), laddr:port())
+    peer:close()
+    c:close()
+
+    -- test that returns an error if the source address is not available
+    local nbind = socket.addrnotavail()
+    c = assert(socket.new(dst:family(), dst:socktype()))
+    local ok, err = c:connectfrom(assert(addrinfo.inet('192.0.2.1')), dst)
+    assert.is_false(ok)
+    assert.equal(err.type, errno.EADDRNOTAVAIL)
+    assert.equal(socket.addrnotavail(), nbind + 1)
+    c:close()
+
+    s:close()
+end
+
+function testcase.bindnoport()
+    local s = assert(socket.new(llsocket.AF_INET, llsocket.SOCK_STREAM))
+
+    -- test that enable the IP_BIND_ADDRESS_NO_PORT flag
+    assert.is_false(s:bindnoport(true))
+    assert.is_true(s:bindnoport())
+
+    -- test that the port is not allocated by bind
+    assert(s:bind(assert(addrinfo.inet('127.0.0.1', 0))))
+    assert.equal(assert(s:getsockname()):port(), 0)
+    s:close()
+end
+
+function testcase.localportrange()
+    local s = assert(socket.new(llsocket.AF_INET, llsocket.SOCK_STREAM))
+
+    -- test that change the local port range
+    local lo, hi, err = s:localportrange(40000, 40100)
+    if err and
+        (err.type == errno.ENOPROTOOPT or err.type == errno.EOPNOTSUPP) then
+        -- not supported by the kernel
+        s:close()
+        return
+    end
+    assert.is_nil(err)
+    assert.equal(lo, 0)
+    assert.equal(hi, 0)
+    lo, hi = s:localportrange()
+    assert.equal(lo, 40000)
+    assert.equal(hi, 40100)
+
+    -- test that throws an error with invalid range
+    err = assert.throws(s.localportrange, s, 40100, 40000)
+    assert.match(err, 'hi must be greater than or equal to lo')
+    s:close()
+end
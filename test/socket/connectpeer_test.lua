@@ -0,0 +1,81 @@
+local llsocket = require('llsocket')
+local testcase = require('testcase')
+local errno = require('errno')
+local socket = llsocket.socket
+local addrinfo = llsocket.addrinfo
+
+local function new_socket(reuse)
+    local ai = assert(addrinfo.inet('127.0.0.1', 0, llsocket.SOCK_DGRAM))
+    local s = assert(socket.new(ai:family(), ai:socktype(), nil, true))
+    if reuse then
+        assert(s:reuseaddr(true))
+        assert(s:reuseport(true))
+    end
+    assert(s:bind(ai))
+    return s, assert(s:getsockname())
+end
+
+function testcase.connectpeer()
+    local s, ai = new_socket(true)
+    local c1 = new_socket()
+    local c2 = new_socket()
+    assert(c1:sendto('hello', ai))
+
+    -- test that create the socket connected to the peer
+    local msg, _, _, peer = s:recvfrom()
+    assert.equal(msg, 'hello')
+    local ps, err, strays = assert(s:connectpeer(peer))
+    assert.match(tostring(ps), '^llsocket.socket:', false)
+    -- no datagram from the other peers
+    assert.is_nil(err)
+    assert.is_nil(strays)
+    assert.equal(assert(ps:getsockname()):port(), ai:port())
+    assert.equal(assert(ps:getpeername()):port(), peer:port())
+    assert.is_true(ps:nonblock())
+
+    -- test that the datagrams from the peer are delivered to the new socket
+    assert(c1:sendto('world', ai))
+    assert(c2:sendto('foo', ai))
+    assert.equal(ps:recv(), 'world')
+    assert.equal(s:recv(), 'foo')
+
+    -- test that the new socket sends from the shared port
+    assert(ps:send('bar'))
+    msg, _, _, peer = c1:recvfrom()
+    assert.equal(msg, 'bar')
+    assert.equal(peer:port(), ai:port())
+
+    for _, sock in ipairs({
+        s,
+        ps,
+        c1,
+        c2,
+    }) do
+        sock:close()
+    end
+end
+
+function testcase.connectpeer_error()
+    local peer = assert(addrinfo.inet('127.0.0.1', 8080, llsocket.SOCK_DGRAM))
+
+    -- test that returns an error if the port cannot be shared
+    local s = new_socket()
+    local ps, err = s:connectpeer(peer)
+    assert.is_nil(ps)
+    assert.equal(err.type, errno.EADDRINUSE)
+    s:close()
+
+    -- test that returns an error if the socket is not bound
+    s = assert(socket.new(llsocket.AF_INET, llsocket.SOCK_DGRAM))
+    ps, err = s:connectpeer(peer)
+    assert.is_nil(ps)
+    assert.equal(err.type, errno.EINVAL)
+    s:close()
+
+    -- test that returns an error with the stream socket
+    s = assert(socket.new(llsocket.AF_INET, llsocket.SOCK_STREAM))
+    ps, err = s:connectpeer(peer)
+    assert.is_nil(ps)
+    assert.equal(err.type, errno.EOPNOTSUPP)
+    s:close()
+end
@@ -0,0 +1,66 @@
+local testcase = require('testcase')
+local llsocket = require('llsocket')
+local socket = llsocket.socket
+local addrinfo = llsocket.addrinfo
+
+function testcase.pktinfo()
+    if llsocket.env.os ~= 'linux' then
+        return
+    end
+    local s = assert(socket.new(llsocket.AF_INET, llsocket.SOCK_DGRAM))
+
+    -- test that enable the IP_PKTINFO flag
+    local enable, err = s:pktinfo(true)
+    assert.is_nil(err)
+    assert.is_false(enable)
+    assert.is_true(s:pktinfo())
+    assert.is_true(s:pktinfo(false))
+    assert.is_false(s:pktinfo())
+    s:close()
+end
+
+function testcase.recvfromto_sendtofrom()
+    if llsocket.env.os ~= 'linux' then
+        return
+    end
+    -- wildcard server socket
+    local ai = assert(addrinfo.inet('0.0.0.0', 0, llsocket.SOCK_DGRAM))
+    local s = assert(socket.new(ai:family(), ai:socktype()))
+    assert(s:bind(ai))
+    local port = assert(s:getsockname()):port()
+    local _, err = s:pktinfo(true)
+    assert.is_nil(err)
+    local c = assert(socket.new(ai:family(), ai:socktype()))
+
+    -- test that returns the destination address and the incoming interface
+    local addr = assert(addrinfo.inet('127.0.0.3', port, llsocket.SOCK_DGRAM))
+    assert(c:sendto('hello', addr))
+    local msg, again, src, dst, ifindex
+    msg, err, again, src, dst, ifindex = s:recvfromto()
+    assert.equal(msg, 'hello')
+    assert.is_nil(err)
+    assert.is_nil(again)
+    assert.equal(src:port(), assert(c:getsockname()):port())
+    assert.equal(dst:addr(), '127.0.0.3')
+    assert.greater(ifindex, 0)
+
+    -- test that reply from the destination address of the request
+    assert.equal(s:sendtofrom('world', src, dst, ifindex), 5)
+    local ai2
+    msg, err, again, ai2 = c:recvfrom()
+    assert.equal(msg, 'world')
+    assert.equal(ai2:addr(), '127.0.0.3')
+    assert.equal(ai2:port(), port)
+
+    -- test that the destination address is not returned if disabled
+    assert(s:pktinfo(false))
+    assert(c:sendto('hello', addr))
+    msg, err, again, src, dst, ifindex = s:recvfromto()
+    assert.equal(msg, 'hello')
+    assert.equal(src:port(), assert(c:getsockname()):port())
+    assert.is_nil(dst)
+    assert.is_nil(ifindex)
+
+    s:close()
+    c:close()
+end
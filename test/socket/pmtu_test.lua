@@ -0,0 +1,100 @@
+local testcase = require('testcase')
+local errno = require('errno')
+local timer = require('testcase.timer')
+local llsocket = require('llsocket')
+local socket = llsocket.socket
+local addrinfo = llsocket.addrinfo
+
+function testcase.mtudiscover()
+    if llsocket.env.os ~= 'linux' then
+        return
+    end
+    local s = assert(socket.new(llsocket.AF_INET, llsocket.SOCK_DGRAM))
+
+    -- test that change the path mtu discovery mode
+    local mode, err = s:mtudiscover(llsocket.IP_PMTUDISC_DO)
+    assert.is_nil(err)
+    assert.is_int(mode)
+    assert.equal(s:mtudiscover(), llsocket.IP_PMTUDISC_DO)
+    assert.equal(s:mtudiscover(llsocket.IP_PMTUDISC_DONT),
+                 llsocket.IP_PMTUDISC_DO)
+    assert.equal(s:mtudiscover(), llsocket.IP_PMTUDISC_DONT)
+    s:close()
+end
+
+function testcase.mtu()
+    if llsocket.env.os ~= 'linux' then
+        return
+    end
+    local s = assert(socket.new(llsocket.AF_INET, llsocket.SOCK_DGRAM))
+
+    -- test that returns ENOTCONN if the socket is not connected
+    local mtu, err = s:mtu()
+    assert.is_nil(mtu)
+    assert.equal(err.type, errno.ENOTCONN)
+
+    -- test that returns the path mtu of the connected socket
+    assert(s:connect(assert(addrinfo.inet('127.0.0.1', 9))))
+    mtu = assert(s:mtu())
+    assert.is_int(mtu)
+    s:close()
+end
+
+function testcase.maxpayload()
+    local ai = assert(addrinfo.inet('127.0.0.1', 9, llsocket.SOCK_DGRAM))
+    local s = assert(socket.new(ai:family(), ai:socktype()))
+
+    -- test that returns the maximum payload size to the destination
+    local size = assert(s:maxpayload(ai))
+    assert.greater(size, 0)
+    assert.less_or_equal(size, 65535 - 28)
+
+    -- test that returns the same size by the connected socket
+    assert(s:connect(ai))
+    assert.equal(assert(s:maxpayload()), size)
+    s:close()
+
+    -- test that the size of the stream socket excludes the tcp header
+    s = assert(socket.new(ai:family(), llsocket.SOCK_STREAM))
+    assert.equal(assert(s:maxpayload(ai)), size - 12)
+    s:close()
+end
+
+function testcase.recverror()
+    if llsocket.env.os ~= 'linux' then
+        return
+    end
+    local ai = assert(addrinfo.inet('127.0.0.1', 0, llsocket.SOCK_DGRAM))
+    local closed = assert(socket.new(ai:family(), ai:socktype()))
+    assert(closed:bind(ai))
+    local dst = assert(closed:getsockname())
+    closed:close()
+
+    local s = assert(socket.new(ai:family(), ai:socktype(), nil, true))
+    local enable, err = s:recverr(true)
+    assert.is_nil(err)
+    assert.is_false(enable)
+    assert.is_true(s:recverr())
+
+    -- test that returns again if the error queue is empty
+    local ee, again
+    ee, err, again = s:recverror()
+    assert.is_nil(ee)
+    assert.is_nil(err)
+    assert.is_true(again)
+
+    -- test that receive the error reported by the icmp port unreachable
+    assert(s:sendto('hello', dst))
+    timer.usleep(10000)
+    ee = assert(s:recverror())
+    assert.equal(ee.error.type, errno.ECONNREFUSED)
+    assert.is_int(ee.origin)
+    assert.equal(ee.addr:port(), dst:port())
+
+    -- test that the error queue is drained
+    ee, err, again = s:recverror()
+    assert.is_nil(ee)
+    assert.is_nil(err)
+    assert.is_true(again)
+    s:close()
+end
@@ -0,0 +1,115 @@
+local testcase = require('testcase')
+local errno = require('errno')
+local llsocket = require('llsocket')
+local socket = llsocket.socket
+
+function testcase.after_each()
+    socket.rcvbudget(0)
+    collectgarbage('collect')
+end
+
+function testcase.rcvbudget()
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+
+    -- test that the budget is not used by default
+    local used, limit, nexceeded = sp[1]:rcvbudget()
+    assert.equal({
+        used,
+        limit,
+        nexceeded,
+    }, {
+        0,
+        0,
+        0,
+    })
+
+    -- test that recvbuf is accounted to the budget by the received bytes
+    assert(sp[2]:send('hello'))
+    local buf = assert(sp[1]:recvbuf(100))
+    assert.equal(buf:tostring(), 'hello')
+    used = sp[1]:rcvbudget()
+    assert.equal(used, 5)
+    assert.greater_or_equal(socket.rcvbudget(), 5)
+
+    -- test that a slice keeps the read buffer
+    local slice = buf:sub(2)
+    buf = nil
+    collectgarbage('collect')
+    assert.equal(sp[1]:rcvbudget(), 5)
+
+    -- test that the accounting is released when the buffer is collected
+    slice = nil
+    collectgarbage('collect')
+    assert.equal(sp[1]:rcvbudget(), 0)
+    assert.is_nil(slice)
+
+    -- test that throws an error with invalid limit
+    local err = assert.throws(function()
+        sp[1]:rcvbudget(-1)
+    end)
+    assert.match(err, 'limit must be greater than or equal to 0')
+end
+
+function testcase.exceeded()
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+    assert(sp[2]:send(string.rep('x', 100)))
+
+    -- test that returns the previous limit
+    local _, limit = sp[1]:rcvbudget(150)
+    assert.equal(limit, 0)
+
+    -- test that reads are refused when exceeding the budget
+    local buf = assert(sp[1]:recvbuf(100))
+    local msg, err, again = sp[1]:recvbuf(100)
+    assert.is_nil(msg)
+    assert.equal(err.type, errno.ENOBUFS)
+    assert.equal(err.op, 'rcvbudget')
+    assert.is_nil(again)
+    msg, err = sp[1]:recv(100)
+    assert.is_nil(msg)
+    assert.equal(err.type, errno.ENOBUFS)
+    local used, _, nexceeded = sp[1]:rcvbudget()
+    assert.equal(used, 100)
+    assert.equal(nexceeded, 2)
+
+    -- test that reads are allowed within the remaining budget
+    assert(sp[2]:send('foo'))
+    assert.equal(sp[1]:recv(50), 'foo')
+
+    -- test that reads are allowed after the buffer is released
+    buf = nil
+    collectgarbage('collect')
+    assert(sp[2]:send('bar'))
+    assert.equal(sp[1]:recv(100), 'bar')
+    assert.is_nil(buf)
+
+    -- test that reads are refused when exceeding the global budget
+    sp[1]:rcvbudget(0)
+    socket.rcvbudget(10)
+    msg, err = sp[1]:read(100)
+    assert.is_nil(msg)
+    assert.equal(err.type, errno.ENOBUFS)
+end
+
+function testcase.not_accounted_without_data()
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+    local _, err = sp[1]:nonblock(true)
+    assert(not err, err)
+    sp[1]:rcvbudget(150)
+
+    -- test that polling the idle socket is not accounted to the budget
+    for _ = 1, 10 do
+        local buf, again
+        buf, err, again = sp[1]:recvbuf(100)
+        assert.is_nil(buf)
+        assert.is_nil(err)
+        assert.is_true(again)
+    end
+    assert.equal(sp[1]:rcvbudget(), 0)
+
+    -- test that the closed socket is not accounted to the budget
+    sp[2]:close()
+    assert.is_nil(sp[1]:recvbuf(100))
+    assert.equal(sp[1]:rcvbudget(), 0)
+    sp[1]:close()
+end
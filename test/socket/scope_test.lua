@@ -0,0 +1,134 @@
+local testcase = require('testcase')
+local errno = require('errno')
+local llsocket = require('llsocket')
+local socket = llsocket.socket
+
+function testcase.after_each()
+    socket.onpressure()
+    collectgarbage('collect')
+end
+
+function testcase.scope()
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+
+    -- test that the socket is closed after the function returns
+    local a, b = socket.scope(sp[1], function(sock, v)
+        return sock:fd(), v
+    end, 'hello')
+    assert.greater_or_equal(a, 0)
+    assert.equal(b, 'hello')
+    assert.equal(sp[1]:fd(), -1)
+
+    -- test that the socket is closed even if the function throws an error
+    local ok, err = pcall(socket.scope, sp[2], function()
+        error('test error')
+    end)
+    assert.is_false(ok)
+    assert.match(err, 'test error')
+    assert.equal(sp[2]:fd(), -1)
+
+    -- test that throws an error if the fn is not function
+    err = assert.throws(socket.scope, sp[1], 'hello')
+    assert.match(err, 'function expected')
+end
+
+function testcase.close_metamethod()
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+
+    -- test that the socket is closed by the __close metamethod
+    getmetatable(sp[1]).__close(sp[1], 'error object')
+    assert.equal(sp[1]:fd(), -1)
+    local _, err = sp[1]:send('hello')
+    assert.equal(err.type, errno.EBADF)
+
+    -- test that the <close> variable closes the socket
+    if _VERSION == 'Lua 5.4' then
+        local fn = assert(load([[
+            local sock <close> = ...
+            return sock:fd()
+        ]]))
+        assert.greater_or_equal(fn(sp[2]), 0)
+        assert.equal(sp[2]:fd(), -1)
+    end
+end
+
+function testcase.nopen()
+    collectgarbage('collect')
+    local n, limit = socket.nopen()
+    assert.greater_or_equal(n, 0)
+    assert.greater_or_equal(limit, 0)
+
+    -- test that the number of descriptors is counted
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+    assert.equal(socket.nopen(), n + 2)
+    local sock = assert(sp[1]:dup())
+    assert.equal(socket.nopen(), n + 3)
+
+    -- test that the closed socket is not counted
+    sock:close()
+    assert.equal(socket.nopen(), n + 2)
+    socket.close(sp[2]:unwrap())
+    assert.equal(socket.nopen(), n + 1)
+    sp = nil
+    collectgarbage('collect')
+    collectgarbage('collect')
+    assert.equal(socket.nopen(), n)
+end
+
+function testcase.onpressure()
+    local n, limit = socket.nopen()
+    if limit == 0 then
+        return
+    end
+    local called = {}
+    socket.onpressure(function(nopen, lim)
+        called[#called + 1] = {
+            nopen,
+            lim,
+        }
+    end, (n + 1.5) / limit)
+
+    -- test that the hook is called only when the threshold is reached
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+    assert.equal(called, {
+        {
+            n + 1,
+            limit,
+        },
+    })
+    sp[1]:close()
+    sp[2]:close()
+
+    -- test that the hook is called again after falling below the threshold
+    called = {}
+    sp = assert(socket.pair(llsocket.SOCK_STREAM))
+    assert.equal(called, {
+        {
+            n + 1,
+            limit,
+        },
+    })
+    sp[1]:close()
+    sp[2]:close()
+
+    -- test that the error of the hook is ignored
+    socket.onpressure(function()
+        error('hook error')
+    end, (n + 1.5) / limit)
+    sp = assert(socket.pair(llsocket.SOCK_STREAM))
+    sp[1]:close()
+    sp[2]:close()
+
+    -- test that the hook is removed
+    called = {}
+    socket.onpressure()
+    sp = assert(socket.pair(llsocket.SOCK_STREAM))
+    assert.equal(called, {})
+    sp[1]:close()
+    sp[2]:close()
+
+    -- test that throws an error if the ratio is out of range
+    local err = assert.throws(socket.onpressure, function()
+    end, 1.5)
+    assert.match(err, 'ratio must be')
+end
@@ -44,6 +44,113 @@ function testcase.sendto_recvfrom()
     s2:close()
 end
 
+function testcase.sendtomany()
+    local ai = assert(addrinfo.inet('127.0.0.1', 0, llsocket.SOCK_DGRAM))
+    local s = assert(socket.new(ai:family(), ai:socktype()))
+    local peers = {}
+    local dests = {}
+    local packed = {}
+    for i = 1, 3 do
+        peers[i] = assert(socket.new(ai:family(), ai:socktype()))
+        assert(peers[i]:bind(ai))
+        dests[i] = assert(peers[i]:getsockname())
+        packed[i] = assert(dests[i]:pack())
+    end
+
+    -- test that send a message to each of the addrinfo list
+    assert.equal(s:sendtomany('hello', dests), 3)
+    for _, peer in ipairs(peers) do
+        assert.equal(peer:recv(), 'hello')
+    end
+
+    -- test that send a message to each of the packed address list
+    assert.equal(s:sendtomany('world', table.concat(packed)), 3)
+    for _, peer in ipairs(peers) do
+        assert.equal(peer:recv(), 'world')
+    end
+
+    -- test that send a message from the i-th destination
+    assert.equal(s:sendtomany('foo', table.concat(packed), 3), 1)
+    assert.equal(s:sendtomany('bar', dests, 2), 2)
+    assert.equal(peers[2]:recv(), 'bar')
+    assert.equal(peers[3]:recv(), 'foo')
+    assert.equal(peers[3]:recv(), 'bar')
+
+    -- test that returns the number of destinations sent before the error
+    local n, err, again, sent = s:sendtomany('baz', {
+        dests[1],
+        assert(addrinfo.inet6('::1', 9, llsocket.SOCK_DGRAM)),
+    })
+    assert.is_nil(n)
+    assert(err, 'no error')
+    assert.is_nil(again)
+    assert.equal(sent, 1)
+    assert.equal(peers[1]:recv(), 'baz')
+
+    -- test that throws an error with invalid dests
+    err = assert.throws(s.sendtomany, s, 'hello', {
+        'foo',
+    })
+    assert.match(err, 'dests must be the list of llsocket.addrinfo')
+    err = assert.throws(s.sendtomany, s, 'hello', 'foo')
+    assert.match(err, 'dests must be the packed address list')
+
+    s:close()
+    for _, peer in ipairs(peers) do
+        peer:close()
+    end
+end
+
+function testcase.recvfrom_with_out()
+    local ai1 = assert(addrinfo.inet('127.0.0.1', 0, llsocket.SOCK_DGRAM))
+    local s1 = assert(socket.new(ai1:family(), ai1:socktype()))
+    assert(s1:bind(ai1))
+    ai1 = assert(s1:getsockname())
+    local ai2 = assert(addrinfo.inet('127.0.0.1', 0, llsocket.SOCK_DGRAM))
+    local s2 = assert(socket.new(ai2:family(), ai2:socktype()))
+    assert(s2:bind(ai2))
+    ai2 = assert(s2:getsockname())
+
+    -- test that the addrinfo is overwritten with the source address
+    local out = assert(addrinfo.inet6('::1', 1))
+    assert.equal(out:addr(), '::1')
+    assert(s1:sendto('hello', ai2))
+    local msg, err, again, ai = s2:recvfrom(nil, out)
+    assert.equal(msg, 'hello')
+    assert.is_nil(err)
+    assert.is_nil(again)
+    assert.equal(ai, out)
+    assert.equal(out:family(), llsocket.AF_INET)
+    assert.equal(out:addr(), '127.0.0.1')
+    assert.equal(out:port(), ai1:port())
+
+    -- test that returns the address in the same form as addrinfo:pack()
+    local key = assert(s1:getsockname('packed'))
+    assert.equal(key, assert(ai1:pack()))
+    assert(s1:sendto('world', ai2))
+    msg, err, again, ai = s2:recvfrom(nil, 'packed', llsocket.MSG_PEEK)
+    assert.equal(msg, 'world')
+    assert.is_nil(err)
+    assert.is_nil(again)
+    assert.equal(ai, key)
+    -- test that the flags follow the out argument
+    msg = assert(s2:recvfrom(nil, 'packed'))
+    assert.equal(msg, 'world')
+
+    -- test that getsockname overwrites the addrinfo
+    assert.equal(s2:getsockname(out), out)
+    assert.equal(out:port(), ai2:port())
+
+    -- test that throws an error with invalid out argument
+    err = assert.throws(function()
+        s2:getsockname('foo')
+    end)
+    assert.match(err, 'out must be llsocket.addrinfo')
+
+    s1:close()
+    s2:close()
+end
+
 function testcase.sendmsg_recvmsg()
     local sp = assert(socket.pair(llsocket.SOCK_STREAM))
     local siov = iovec.new()
@@ -69,6 +176,44 @@ function testcase.sendmsg_recvmsg()
     sp[2]:close()
 end
 
+function testcase.sendmsg_recvmsg_with_name()
+    local ai1 = assert(addrinfo.inet('127.0.0.1', 0, llsocket.SOCK_DGRAM))
+    local s1 = assert(socket.new(ai1:family(), ai1:socktype()))
+    assert(s1:bind(ai1))
+    ai1 = assert(s1:getsockname())
+    local ai2 = assert(addrinfo.inet('127.0.0.1', 0, llsocket.SOCK_DGRAM))
+    local s2 = assert(socket.new(ai2:family(), ai2:socktype()))
+    assert(s2:bind(ai2))
+    ai2 = assert(s2:getsockname())
+
+    -- test that send a message to the msg_name address
+    local siov = iovec.new()
+    siov:add('hello')
+    local smh = llsocket.msghdr.new()
+    smh:iov(siov)
+    smh:name(ai2)
+    local n = assert(s1:sendmsg(smh))
+    assert.equal(n, 5)
+
+    -- test that the msg_name is updated with the source address
+    local riov = iovec.new()
+    riov:addn(127)
+    local rmh = llsocket.msghdr.new()
+    local name = assert(addrinfo.inet6('::1', 1))
+    assert.equal(name:addr(), '::1')
+    rmh:iov(riov)
+    rmh:name(name)
+    n = assert(s2:recvmsg(rmh))
+    assert.equal(n, 5)
+    assert.equal(riov:concat(0, n), 'hello')
+    assert.equal(name:family(), llsocket.AF_INET)
+    assert.equal(name:addr(), '127.0.0.1')
+    assert.equal(name:port(), ai1:port())
+
+    s1:close()
+    s2:close()
+end
+
 function testcase.sendfd_recvfd()
     local sp = assert(socket.pair(llsocket.SOCK_STREAM))
 
@@ -87,6 +232,109 @@ function testcase.sendfd_recvfd()
     sp[2]:close()
 end
 
+function testcase.vmsplice_recv()
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+
+    -- test that send a small message
+    local n, err, again = sp[1]:vmsplice('hello')
+    assert.equal(n, 5)
+    assert.is_nil(err)
+    assert.is_nil(again)
+    assert.equal(sp[2]:recv(), 'hello')
+
+    -- test that send a large message
+    local _
+    _, err = sp[1]:nonblock(true)
+    assert(not err, err)
+    _, err = sp[2]:nonblock(true)
+    assert(not err, err)
+    local msg = string.rep('x', 1024 * 1024)
+    local remain = msg
+    local total = 0
+    repeat
+        n, err, again = sp[1]:vmsplice(remain)
+        assert(not err, err)
+        remain = remain:sub(n + 1)
+
+        -- repeat until all sent data has been received
+        repeat
+            local data = sp[2]:recv(65536)
+            total = total + (data and #data or 0)
+        until not data
+    until not again and #remain == 0
+    assert.equal(total, #msg)
+
+    -- test that returns 0 if nothing to flush
+    n, err, again = sp[1]:vmsplice()
+    assert.equal(n, 0)
+    assert.is_nil(err)
+    assert.is_nil(again)
+
+    sp[1]:close()
+    sp[2]:close()
+end
+
+function testcase.vmsplice_keep_message()
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+    local _, err = sp[1]:nonblock(true)
+    assert(not err, err)
+    _, err = sp[2]:nonblock(true)
+    assert(not err, err)
+
+    -- test that the message is kept until it is sent even if the caller
+    -- does not refer to it
+    local pat = '0123456789abcdef'
+    local n, again
+    n, err = sp[1]:vmsplice(pat:rep(512 * 1024 / #pat))
+    assert(not err, err)
+    assert.greater(n, 0)
+    collectgarbage('collect')
+    for i = 1, 256 do
+        _ = ('z'):rep(4096 + i)
+    end
+
+    local data = ''
+    repeat
+        _, err, again = sp[1]:vmsplice()
+        assert(not err, err)
+        repeat
+            local chunk = sp[2]:recv(65536)
+            data = data .. (chunk or '')
+        until not chunk
+    until not again and #data == n
+    assert.equal(data, pat:rep(math.ceil(n / #pat)):sub(1, n))
+
+    sp[1]:close()
+    sp[2]:close()
+end
+
+function testcase.vmsplice_close()
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+    local _, err = sp[1]:nonblock(true)
+    assert(not err, err)
+
+    -- test that the unsent message is delivered after the socket is closed
+    local pat = 'fedcba9876543210'
+    local n
+    n, err = sp[1]:vmsplice(pat:rep(512 * 1024 / #pat))
+    assert(not err, err)
+    assert.greater(n, 0)
+    sp[1]:close()
+    collectgarbage('collect')
+    for i = 1, 256 do
+        _ = ('z'):rep(4096 + i)
+    end
+
+    local data = ''
+    repeat
+        local chunk = sp[2]:recv(65536)
+        data = data .. (chunk or '')
+    until not chunk
+    assert.greater(#data, 0)
+    assert.equal(data, pat:rep(math.ceil(#data / #pat)):sub(1, #data))
+    sp[2]:close()
+end
+
 function testcase.sendfile_recv()
     local sp = assert(socket.pair(llsocket.SOCK_STREAM))
     local simg = assert(io.open('./small.png'))
@@ -0,0 +1,84 @@
+local testcase = require('testcase')
+local llsocket = require('llsocket')
+local socket = llsocket.socket
+
+function testcase.after_each()
+    socket.sethook()
+end
+
+function testcase.sendall_readn()
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+
+    -- test that send all bytes
+    local n, err, again = sp[1]:sendall('hello world')
+    assert.equal(n, 11)
+    assert.is_nil(err)
+    assert.is_false(again)
+
+    -- test that receive exactly n bytes
+    assert.equal(sp[2]:readn(5), 'hello')
+    assert.equal(sp[2]:readn(6), ' world')
+
+    -- test that returns the partial message on nonblocking socket
+    assert(sp[2]:nonblock(true))
+    assert(sp[1]:send('foo'))
+    local msg
+    msg, err, again = sp[2]:readn(10)
+    assert.equal(msg, 'foo')
+    assert.is_nil(err)
+    assert.is_true(again)
+
+    -- test that returns the partial message if closed by peer
+    assert(sp[1]:send('bar'))
+    sp[1]:close()
+    assert.equal(sp[2]:readn(10), 'bar')
+    assert.is_nil(sp[2]:readn(10))
+    sp[2]:close()
+end
+
+function testcase.yield()
+    if _VERSION == 'Lua 5.1' then
+        return
+    end
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM, nil, true))
+    local events = {}
+    socket.sethook(function(sock, event)
+        events[#events + 1] = event
+        return sock, event
+    end)
+
+    -- test that readn yields until all bytes are received
+    local co = coroutine.create(function()
+        return sp[2]:readn(10)
+    end)
+    local ok, sock, event = coroutine.resume(co)
+    assert.is_true(ok)
+    assert.equal(sock, sp[2])
+    assert.equal(event, 'read')
+    assert(sp[1]:send('hello'))
+    assert(coroutine.resume(co, 'ignored'))
+    assert.equal(coroutine.status(co), 'suspended')
+    assert(sp[1]:send('world'))
+    local msg
+    ok, msg = coroutine.resume(co)
+    assert.is_true(ok)
+    assert.equal(msg, 'helloworld')
+    assert.equal(events, {
+        'read',
+        'read',
+    })
+
+    -- test that recv yields
+    co = coroutine.wrap(function()
+        return sp[2]:recv()
+    end)
+    assert.equal(co(), sp[2])
+    assert(sp[1]:send('foo'))
+    assert.equal(co(), 'foo')
+
+    -- test that the hook is not called outside of coroutine
+    local _, again
+    msg, _, again = sp[2]:recv()
+    assert.is_nil(msg)
+    assert.is_true(again)
+end
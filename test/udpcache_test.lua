@@ -0,0 +1,110 @@
+local testcase = require('testcase')
+local llsocket = require('llsocket')
+local addrinfo = llsocket.addrinfo
+local socket = llsocket.socket
+local udpcache = llsocket.udpcache
+
+local function new_socket(reuse)
+    local ai = assert(addrinfo.inet('127.0.0.1', 0, llsocket.SOCK_DGRAM))
+    local s = assert(socket.new(ai:family(), ai:socktype(), nil, true))
+    if reuse then
+        assert(s:reuseaddr(true))
+        assert(s:reuseport(true))
+    end
+    assert(s:bind(ai))
+    return s, assert(s:getsockname())
+end
+
+function testcase.new()
+    local s = new_socket()
+
+    -- test that returns new instance of llsocket.udpcache
+    local c = assert(udpcache.new(s))
+    assert.match(tostring(c), '^llsocket.udpcache:', false)
+    assert.equal(#c, 0)
+
+    -- test that throws an error with invalid arguments
+    local tcp = assert(socket.new(llsocket.AF_INET, llsocket.SOCK_STREAM))
+    local err = assert.throws(udpcache.new, tcp)
+    assert.match(err, 'sock must be AF_INET or AF_INET6 SOCK_DGRAM socket')
+    err = assert.throws(udpcache.new, s, 0)
+    assert.match(err, 'size must be between 1 and 65536')
+    err = assert.throws(udpcache.new, s, nil, 0)
+    assert.match(err, 'threshold must be greater than 0')
+    tcp:close()
+    s:close()
+end
+
+function testcase.send()
+    local s, local_ai = new_socket(true)
+    local peer, peer_ai = new_socket()
+    local c = assert(udpcache.new(s, 2, 2))
+
+    -- test that send with sendto to the cold peer
+    assert.equal(c:send('hello', peer_ai), 5)
+    local msg, _, _, from = peer:recvfrom()
+    assert.equal(msg, 'hello')
+    assert.equal(from:port(), local_ai:port())
+    assert.equal(#c:sockets(), 0)
+
+    -- test that send with the connected socket to the hot peer
+    assert.equal(c:send('world', peer_ai:pack()), 5)
+    msg, _, _, from = peer:recvfrom()
+    assert.equal(msg, 'world')
+    -- the source address is the same as the base socket
+    assert.equal(from:port(), local_ai:port())
+    local socks = c:sockets()
+    assert.equal(#socks, 1)
+    -- no datagram from the other peers was received by the connected socket
+    assert.equal(c:strays(), {})
+    assert.equal(assert(socks[1]:getpeername()):port(), peer_ai:port())
+    local hits, misses = c:stats()
+    assert.equal(hits, 1)
+    assert.equal(misses, 1)
+
+    -- test that the replies of the hot peer can be received by the connected
+    -- socket
+    assert(peer:sendto('reply', local_ai))
+    assert.equal(socks[1]:recv(), 'reply')
+
+    -- test that evict the least recently used peer
+    local p2, p2_ai = new_socket()
+    local p3, p3_ai = new_socket()
+    assert(c:send('foo', p2_ai))
+    assert(c:send('foo', p3_ai))
+    assert.equal(#c, 2)
+    assert.equal(socks[1]:fd(), -1)
+    assert.equal(#c:sockets(), 0)
+
+    -- test that throws an error with invalid addr
+    local err = assert.throws(c.send, c, 'foo', 'bar')
+    assert.match(err, 'addr must be the packed address or llsocket.addrinfo')
+
+    c:close()
+    assert.equal(#c, 0)
+    for _, sock in ipairs({
+        s,
+        peer,
+        p2,
+        p3,
+    }) do
+        sock:close()
+    end
+end
+
+function testcase.fallback()
+    -- test that fallback to sendto if the port cannot be shared
+    local s = new_socket()
+    local peer, peer_ai = new_socket()
+    local c = assert(udpcache.new(s, nil, 1))
+    for _ = 1, 3 do
+        assert.equal(c:send('hello', peer_ai), 5)
+        assert.equal(peer:recv(), 'hello')
+    end
+    local hits, misses = c:stats()
+    assert.equal(hits, 0)
+    assert.equal(misses, 3)
+    assert.equal(#c:sockets(), 0)
+    s:close()
+    peer:close()
+end
@@ -0,0 +1,112 @@
+local testcase = require('testcase')
+local errno = require('errno')
+local llsocket = require('llsocket')
+local wheel = llsocket.wheel
+local socket = llsocket.socket
+
+function testcase.new()
+    -- test that returns new instance of llsocket.wheel
+    local w = wheel.new(10)
+    assert.match(tostring(w), '^llsocket.wheel:', false)
+    assert.equal(#w, 0)
+
+    -- test that throws an error with invalid arguments
+    local err = assert.throws(function()
+        wheel.new(0)
+    end)
+    assert.match(err, 'msec must be greater than 0')
+    err = assert.throws(function()
+        wheel.new(10, -1)
+    end)
+    assert.match(err, 'maxconn must be greater than or equal to 0')
+end
+
+function testcase.attach_detach()
+    local w = wheel.new(10)
+    local w2 = wheel.new(10)
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+
+    -- test that attach sockets
+    assert.is_true(w:attach(sp[1], 1000))
+    assert.is_true(w:attach(sp[2], 1000, 100, 100))
+    assert.equal(#w, 2)
+
+    -- test that update the timeouts of the attached socket
+    assert.is_true(w:attach(sp[1], 2000))
+    assert.equal(#w, 2)
+
+    -- test that cannot attach to another wheel
+    local ok, err = w2:attach(sp[1], 1000)
+    assert.is_false(ok)
+    assert.equal(err.type, errno.EALREADY)
+
+    -- test that touch the attached socket
+    assert.is_true(w:touch(sp[1]))
+    assert.is_false(w2:touch(sp[1]))
+
+    -- test that detach the socket
+    assert.is_true(w:detach(sp[1]))
+    assert.is_false(w:detach(sp[1]))
+    assert.equal(#w, 1)
+
+    -- test that closed socket is detached
+    sp[2]:close()
+    assert.equal(#w, 0)
+    sp[1]:close()
+end
+
+function testcase.expired()
+    local w = wheel.new(10)
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+    assert(w:attach(sp[1], 60000))
+    assert(w:attach(sp[2], 60000, 100))
+
+    -- test that no sockets are expired before the timeouts
+    local socks, reasons = w:expired()
+    assert.equal(socks, {})
+    assert.equal(reasons, {})
+
+    -- test that returns the timed-out sockets with the reasons
+    local deadline = os.time() + 2
+    repeat
+        socks, reasons = w:expired()
+    until #socks > 0 or os.time() > deadline
+    assert.equal(socks, {
+        sp[2],
+    })
+    assert.equal(reasons, {
+        'read',
+    })
+    assert.equal(#w, 1)
+
+    sp[1]:close()
+    sp[2]:close()
+end
+
+function testcase.evict()
+    local w = wheel.new(10, 2)
+    local sp = assert(socket.pair(llsocket.SOCK_STREAM))
+    local sock = assert(socket.new(llsocket.AF_INET, llsocket.SOCK_DGRAM))
+
+    -- test that evict the least recently active socket at maxconn
+    assert(w:attach(sp[1], 1000))
+    assert(w:attach(sp[2], 1000))
+    assert(sp[2]:send('hello'))
+    assert.equal(sp[1]:recv(), 'hello')
+    local ok, err, evicted = w:attach(sock, 1000)
+    assert.is_true(ok)
+    assert.is_nil(err)
+    assert.equal(evicted, sp[2])
+    assert.equal(#w, 2)
+
+    -- test that evict sockets explicitly
+    assert.equal(w:evict(5), {
+        sp[1],
+        sock,
+    })
+    assert.equal(#w, 0)
+
+    sp[1]:close()
+    sp[2]:close()
+    sock:close()
+end
@@ -33,6 +33,10 @@ LUALIB_API int luaopen_llsocket(lua_State *L)
     lua_errno_loadlib(L);
     // init gc function module
     lls_gcfn_init(L);
+    // init read buffer budget
+    lls_budget_init(L);
+    // publish C API
+    lls_capi_init(L);
 
     // register submodule
     lua_newtable(L);
@@ -66,6 +70,46 @@ LUALIB_API int luaopen_llsocket(lua_State *L)
     luaopen_llsocket_env(L);
     lua_rawset(L, -3);
 
+    lua_pushstring(L, "buffer");
+    luaopen_llsocket_buffer(L);
+    lua_rawset(L, -3);
+
+    lua_pushstring(L, "outq");
+    luaopen_llsocket_outq(L);
+    lua_rawset(L, -3);
+
+    lua_pushstring(L, "wheel");
+    luaopen_llsocket_wheel(L);
+    lua_rawset(L, -3);
+
+    lua_pushstring(L, "ffi");
+    luaopen_llsocket_ffi(L);
+    lua_rawset(L, -3);
+
+    lua_pushstring(L, "peermap");
+    luaopen_llsocket_peermap(L);
+    lua_rawset(L, -3);
+
+    lua_pushstring(L, "resolver");
+    luaopen_llsocket_resolver(L);
+    lua_rawset(L, -3);
+
+    lua_pushstring(L, "dns");
+    luaopen_llsocket_dns(L);
+    lua_rawset(L, -3);
+
+    lua_pushstring(L, "connector");
+    luaopen_llsocket_connector(L);
+    lua_rawset(L, -3);
+
+    lua_pushstring(L, "pool");
+    luaopen_llsocket_pool(L);
+    lua_rawset(L, -3);
+
+    lua_pushstring(L, "udpcache");
+    luaopen_llsocket_udpcache(L);
+    lua_rawset(L, -3);
+
     // for shutdown
     lauxh_pushint2tbl(L, "SHUT_RD", SHUT_RD);
     lauxh_pushint2tbl(L, "SHUT_WR", SHUT_WR);
@@ -85,6 +129,10 @@ LUALIB_API int luaopen_llsocket(lua_State *L)
 #define GEN_NI_FLAG_DECL
     // cmsg_levels
 #define GEN_SOL_LEVELS_DECL
+    // path mtu discovery modes
+#define GEN_PMTUDISC_DECL
+    // origins of the extended error
+#define GEN_EE_ORIGIN_DECL
 
     // cmsg_types
 #if defined(SCM_CREDENTIALS)